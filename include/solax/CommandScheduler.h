@@ -0,0 +1,79 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace solax
+{
+
+// Shares the serial line between inquiry commands of different urgency.
+// Commands with a period of 0 are issued every cycle, periodic commands are interleaved by priority
+// as long as they fit into the cycle's latency budget and are deferred to a later cycle otherwise.
+class CommandScheduler final
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using TimeSource = std::function<Clock::time_point()>;
+
+    struct Config
+    {
+        uint32_t baudRate{2400};
+        std::chrono::milliseconds cycleInterval{1000};   // Latency budget of one poll cycle
+    };
+
+    struct Command
+    {
+        std::string name;
+        std::chrono::milliseconds period{0};             // Target interval between two executions, 0: every cycle
+        int32_t priority{0};                             // Higher priority commands are served first
+        size_t lineBytes{0};                             // Request plus expected response size on the wire
+        std::function<void()> execute;
+    };
+
+    struct Statistics
+    {
+        std::string name;
+        uint64_t executions{0};
+        uint64_t deferrals{0};                           // Cycles in which the command was due but did not fit
+        Clock::duration estimatedDuration{};
+    };
+
+    CommandScheduler(const Config& config, TimeSource timeSource = &Clock::now);
+
+    void add(Command command);
+
+    // Changes the expected size of a command, e.g. when it queries a different number of units. The estimated
+    // duration is scaled along, a measured one converges from there. Unknown names are ignored.
+    void setLineBytes(std::string_view name, size_t lineBytes);
+
+    // Runs one poll cycle. Exceptions thrown by a command propagate to the caller.
+    void runCycle();
+
+    // Share of line time needed to serve every command at its target rate. Above 1 the schedule cannot fit.
+    double lineUtilization() const;
+
+    std::vector<Statistics> statistics() const;
+
+private:
+    struct Entry
+    {
+        Command command;
+        Clock::duration estimatedDuration{};
+        Clock::time_point lastExecution{};
+        uint64_t executions{0};
+        uint64_t deferrals{0};
+    };
+
+    void execute(Entry& entry);
+
+    Config config;
+    TimeSource now;
+    std::vector<Entry> entries;                          // Sorted by descending priority
+    bool overloadReported{false};
+};
+
+}
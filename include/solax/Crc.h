@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace solax
+{
+
+// CRC calibration method of the protocol (section 4.1): CRC-16/XMODEM (polynomial 0x1021, initial value 0)
+// where each resulting byte that collides with a frame delimiter ('(', '\r' or '\n') is incremented by one.
+uint16_t crc16(std::string_view data);
+
+// Appends the CRC and the terminating carriage return to an inquiry command, e.g. "QPGS1" -> "QPGS1<CRC><cr>"
+std::string frameCommand(std::string_view command);
+
+// Checks a response frame from its start byte '(' up to and including its two CRC bytes (without '\r')
+bool hasValidCrc(std::string_view frame);
+
+// CRC-32 (ISO-HDLC, as used by zlib) of the history files, continues from a previous crc to checksum discontiguous data
+uint32_t crc32(uint32_t crc, const std::byte* data, size_t size);
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <solax/FileDescriptor.h>
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace solax
+{
+
+// Watches the directories of the configured device paths via inotify, so a reconnect can be
+// attempted the moment a USB serial adapter reappears instead of after a blind back-off.
+class DeviceWatcher final
+{
+public:
+    explicit DeviceWatcher(std::vector<std::string> devicePaths);
+
+    DeviceWatcher(DeviceWatcher const &) = delete;
+    DeviceWatcher &operator=(DeviceWatcher const &) = delete;
+
+    // Blocks until one of the device paths, or a directory leading to it, got created or changed its
+    // attributes (udev fixing permissions), or until the timeout expires. Returns true on a relevant change,
+    // including one since construction or the last wait, e.g. while a probe of the device failed.
+    bool waitForDevice(std::chrono::milliseconds timeout);
+
+private:
+    void armWatches();
+    bool isRelevant(const std::string& changedPath) const;
+
+    std::vector<std::string> devicePaths;
+    FileDescriptor inotifyFd;
+    std::map<int, std::string> watchedDirectories;
+};
+
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <solax/Telemetry.h>
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace solax
+{
+
+// Integrates the sampled power of every unit into energy counters with the trapezoidal rule and keeps
+// them across restarts. Units are told apart by serial number, so a unit leaving the stack keeps its
+// share in the totals and the totals never decrease.
+class EnergyIntegrator final
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Config
+    {
+        std::string statePath{"energy.state"};
+        std::chrono::seconds persistInterval{300};   // Bounds the energy lost on power failure, also bounds SD card wear
+        std::chrono::seconds maxSampleGap{10};       // Longer gaps are not interpolated, nothing is known about them
+    };
+
+    // Loads the counters persisted by a previous run, throws if the state file exists but cannot be read.
+    // Corrupted lines are logged and skipped, the counters of their units start over.
+    explicit EnergyIntegrator(const Config& config);
+    ~EnergyIntegrator();
+
+    EnergyIntegrator(EnergyIntegrator const &) = delete;
+    EnergyIntegrator &operator=(EnergyIntegrator const &) = delete;
+    EnergyIntegrator(EnergyIntegrator &&) = delete;
+    EnergyIntegrator &operator=(EnergyIntegrator &&) = delete;
+
+    // Adds the sample of one unit, taken when its response arrived
+    void add(Clock::time_point sampleTime, const UnitTelemetry& unitTelemetry);
+
+    // Sum over every unit ever seen
+    EnergyTotals total() const;
+
+    // Counters of the given units, in their order
+    std::vector<EnergyTotals> unitTotals(const std::vector<UnitTelemetry>& unitTelemetries) const;
+
+    // Writes the counters to the state file atomically, throws on failure
+    void persist();
+
+private:
+    struct Unit
+    {
+        EnergyTotals totals;
+        Clock::time_point lastSampleTime{};
+        AggregatedTelemetry lastPower{};
+        bool hasLastSample{false};
+    };
+
+    void load();
+
+    Config config;
+    std::map<std::string, Unit, std::less<>> units;  // By serial number
+    Clock::time_point lastPersistTime;
+};
+
+}
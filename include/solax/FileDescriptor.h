@@ -0,0 +1,44 @@
+#pragma once
+#include <utility>
+#include <unistd.h>
+
+namespace solax
+{
+
+// Owns a POSIX file descriptor and closes it on destruction
+class FileDescriptor final
+{
+public:
+    FileDescriptor() = default;
+    explicit FileDescriptor(int fdParam) : fd{fdParam} {}
+    ~FileDescriptor() { reset(); }
+
+    FileDescriptor(FileDescriptor const &) = delete;
+    FileDescriptor &operator=(FileDescriptor const &) = delete;
+    FileDescriptor(FileDescriptor && other) noexcept : fd{std::exchange(other.fd, -1)} {}
+    FileDescriptor &operator=(FileDescriptor && other) noexcept
+    {
+        if(this != &other)
+        {
+            reset(std::exchange(other.fd, -1));
+        }
+        return *this;
+    }
+
+    int get() const { return fd; }
+    bool valid() const { return fd >= 0; }
+
+    void reset(int newFd = -1)
+    {
+        if(fd >= 0)
+        {
+            ::close(fd);
+        }
+        fd = newFd;
+    }
+
+private:
+    int fd{-1};
+};
+
+}
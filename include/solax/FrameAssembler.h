@@ -0,0 +1,46 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+
+namespace solax
+{
+
+// Assembles response frames '(' ... '\r' from the serial byte stream without heap allocations.
+// Bytes are read straight into a fixed-capacity buffer and only newly arrived bytes get scanned.
+// Anything outside of a frame is skipped, a '(' within a frame restarts it (CRC bytes never collide with delimiters).
+class FrameAssembler final
+{
+public:
+    static constexpr size_t Capacity{512};
+
+    // Free space to read() into. Drops already handed out frames before.
+    std::span<char> writableArea();
+
+    // Takes over numBytes written into the writable area and scans them for frame boundaries
+    void commit(size_t numBytes);
+
+    // Next complete frame from its start byte '(' up to its CRC, without the terminating '\r'.
+    // The view stays valid until the next call to writableArea() or reset().
+    std::optional<std::string_view> nextFrame();
+
+    void reset();
+
+    uint64_t numDiscardedBytes() const { return discardedBytes; }
+
+private:
+    void compact();
+
+    std::array<char, Capacity> buffer{};
+    size_t consumed{0};                     // Bytes at the front that were handed out or discarded
+    size_t scanned{0};                      // Bytes that have already been searched for delimiters
+    size_t size{0};                         // Bytes held in the buffer
+    std::optional<size_t> frameStart;       // Position of the start byte of the frame being assembled
+    uint64_t discardedBytes{0};
+};
+
+}
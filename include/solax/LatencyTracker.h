@@ -0,0 +1,43 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <optional>
+
+namespace solax
+{
+
+// Keeps the most recent response latencies of one command type and derives a response timeout
+// from them, so a lost response is detected after a few hundred milliseconds instead of seconds.
+class LatencyTracker final
+{
+public:
+    struct Config
+    {
+        double safetyFactor{1.5};                              // Timeout is the p99 latency times this factor
+        std::chrono::milliseconds floor{200};
+        std::chrono::milliseconds ceiling{5000};               // Also used until enough samples were collected
+        size_t minSamples{8};
+    };
+
+    static constexpr size_t Capacity{64};
+
+    explicit LatencyTracker(const Config& config);
+
+    void add(std::chrono::microseconds latency);
+
+    std::optional<std::chrono::microseconds> percentile(double p) const;
+
+    std::chrono::milliseconds timeout() const;
+
+    size_t numSamples() const { return count; }
+
+private:
+    Config config;
+    std::array<std::chrono::microseconds, Capacity> samples{};
+    size_t count{0};
+    size_t next{0};
+};
+
+}
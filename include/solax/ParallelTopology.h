@@ -0,0 +1,43 @@
+#pragma once
+
+#include <solax/Telemetry.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace solax
+{
+
+// Remembers which parallel units exist so a poll cycle only queries those instead of sweeping
+// the machine indices until an empty slot answers.
+class ParallelTopology final
+{
+public:
+    using Query = std::function<TelemetryResult<UnitTelemetry>(uint8_t machineIndex)>;
+
+    explicit ParallelTopology(Query query);
+
+    // Queries all known units. Discovers the topology first if it is unknown, and again when a
+    // unit vanished or got replaced by a different one.
+    // Returns the first failed query, unitTelemetries is incomplete then and should be dropped.
+    TelemetryResult<void> poll(std::vector<UnitTelemetry>& unitTelemetries);
+
+    // Checks the slot behind the last known unit and schedules a rediscovery if a unit was added there
+    TelemetryResult<void> checkForNewUnits();
+
+    // Forces a rediscovery on the next poll, e.g. after reconnecting to the device
+    void invalidate() { discovered = false; }
+
+    size_t numUnits() const { return serialNumbers.size(); }
+
+private:
+    TelemetryResult<void> discover(std::vector<UnitTelemetry>& unitTelemetries);
+
+    Query query;
+    bool discovered{false};
+    std::vector<std::string> serialNumbers;
+};
+
+}
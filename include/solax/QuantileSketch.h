@@ -0,0 +1,46 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+namespace solax
+{
+
+// Approximates quantiles of a changing set of values with a bounded relative error, using logarithmically
+// sized buckets. Unlike most streaming sketches it supports removing values again, so it can follow a
+// sliding window. Adding and removing are O(1), a quantile query walks the fixed number of buckets.
+class QuantileSketch final
+{
+public:
+    static constexpr double RelativeAccuracy{0.01};
+    static constexpr double MinMagnitude{0.1};       // Smaller magnitudes count as zero
+    static constexpr double MaxMagnitude{1e6};       // Larger magnitudes end up in the outermost bucket
+
+    void add(float value);
+
+    // The value must have been added before
+    void remove(float value);
+
+    std::optional<float> quantile(double q) const;
+
+    size_t size() const { return count; }
+
+private:
+    static constexpr int32_t MinIndex{-115};         // Bucket of MinMagnitude
+    static constexpr int32_t MaxIndex{691};          // Bucket of MaxMagnitude
+    static constexpr size_t NumBuckets{MaxIndex - MinIndex + 1};
+
+    static size_t bucketOf(float magnitude);
+    static float valueOf(size_t bucket);
+
+    void update(float value, int32_t delta);
+
+    std::array<uint32_t, NumBuckets> positive{};
+    std::array<uint32_t, NumBuckets> negative{};
+    uint32_t zeros{0};
+    size_t count{0};
+};
+
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <solax/QuantileSketch.h>
+#include <solax/Telemetry.h>
+#include <solax/TelemetrySchema.h>
+
+#include <array>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace solax
+{
+
+// Summary of one power channel over a window, NaN while the window holds no sample
+struct ChannelStatistics
+{
+    float min{};
+    float max{};
+    float mean{};
+    float stddev{};
+    float p50{};                                 // Approximate, within QuantileSketch::RelativeAccuracy
+    float p90{};
+    float p99{};
+};
+
+inline constexpr auto channelStatisticsFields{std::make_tuple(
+    SOLAX_FIELD(ChannelStatistics, min, "W"),
+    SOLAX_FIELD(ChannelStatistics, max, "W"),
+    SOLAX_FIELD(ChannelStatistics, mean, "W"),
+    SOLAX_FIELD(ChannelStatistics, stddev, "W"),
+    SOLAX_FIELD(ChannelStatistics, p50, "W"),
+    SOLAX_FIELD(ChannelStatistics, p90, "W"),
+    SOLAX_FIELD(ChannelStatistics, p99, "W")
+)};
+
+struct WindowStatistics
+{
+    std::string_view window;
+    std::chrono::seconds duration{};
+    size_t numSamples{0};
+    std::array<ChannelStatistics, NumPowerChannels> channels{};
+};
+
+// Statistics of the power channels over a sliding time window. Every sample is added and expired in
+// amortized O(1): min and max come from monotonic deques, mean and standard deviation from running sums
+// and the percentiles from a QuantileSketch that forgets the expired samples again.
+class RollingStatistics
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit RollingStatistics(Clock::duration window);
+
+    // Samples have to be added in chronological order
+    void add(Clock::time_point sampleTime, const AggregatedTelemetry& sample);
+
+    // Drops the samples that are older than the window at the given time
+    void expire(Clock::time_point now);
+
+    std::array<ChannelStatistics, NumPowerChannels> summarize() const;
+
+    size_t numSamples() const { return samples.size(); }
+
+private:
+    struct Extremum
+    {
+        Clock::time_point time;
+        float value;
+    };
+
+    struct Channel
+    {
+        std::deque<Extremum> minima;             // Ascending values, the front is the minimum of the window
+        std::deque<Extremum> maxima;             // Descending values, the front is the maximum of the window
+        double sum{0.0};
+        double sumOfSquares{0.0};
+        QuantileSketch sketch;
+    };
+
+    Clock::duration window;
+    std::deque<std::pair<Clock::time_point, AggregatedTelemetry>> samples;
+    std::array<Channel, NumPowerChannels> channels;
+};
+
+// Rolling statistics of the aggregated power and the power of every unit over each supported window,
+// safe to query from the REST threads while the acquisition loop adds samples
+class TelemetryStatistics final
+{
+public:
+    using Clock = RollingStatistics::Clock;
+
+    struct Window
+    {
+        std::string_view name;
+        std::chrono::seconds duration;
+    };
+
+    static constexpr std::array<Window, 3> Windows{{
+        {"1m", std::chrono::minutes{1}},
+        {"5m", std::chrono::minutes{5}},
+        {"1h", std::chrono::hours{1}}
+    }};
+
+    TelemetryStatistics();
+
+    TelemetryStatistics(TelemetryStatistics const &) = delete;
+    TelemetryStatistics &operator=(TelemetryStatistics const &) = delete;
+    TelemetryStatistics(TelemetryStatistics &&) = delete;
+    TelemetryStatistics &operator=(TelemetryStatistics &&) = delete;
+
+    void add(Clock::time_point sampleTime, const AggregatedTelemetry& aggregatedTelemetry);
+
+    // Units are told apart by serial number, their power is derived with unitPower()
+    void add(Clock::time_point sampleTime, const UnitTelemetry& unitTelemetry);
+
+    // Throw std::invalid_argument if the window is not one of Windows
+    WindowStatistics aggregated(std::string_view window, Clock::time_point now);
+    WindowStatistics unit(std::string_view serialNumber, std::string_view window, Clock::time_point now);
+
+private:
+    std::vector<RollingStatistics> makeWindows() const;
+    WindowStatistics summarize(std::vector<RollingStatistics>& windows, std::string_view window, Clock::time_point now) const;
+
+    std::mutex mutex;
+    std::vector<RollingStatistics> aggregatedWindows;
+    std::map<std::string, std::vector<RollingStatistics>, std::less<>> unitWindows;  // By serial number
+};
+
+}
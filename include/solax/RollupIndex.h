@@ -0,0 +1,158 @@
+#pragma once
+
+#include <solax/FileDescriptor.h>
+#include <solax/TelemetryHistory.h>
+#include <solax/TelemetrySchema.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace solax
+{
+
+struct ChannelRollup
+{
+    float min{};
+    float max{};
+    double sum{};
+};
+
+// Summary of the aggregated power over one bucket of time
+struct Rollup
+{
+    std::chrono::system_clock::time_point start{};
+    uint32_t count{0};
+    std::array<ChannelRollup, NumPowerChannels> channels{};
+
+    void add(const AggregatedTelemetry& power);
+    void merge(const Rollup& other);
+};
+
+// Result of a rollup query
+struct RollupSeries
+{
+    std::chrono::seconds step{};
+    std::string_view resolution;                         // Name of the rollup level that was read, "raw" for the samples
+    std::vector<Rollup> rollups;
+};
+
+// Groups the rollups or samples that arrive in chronological order into buckets of the given step,
+// aligned to the epoch. Empty buckets are left out.
+class RollupBuilder
+{
+public:
+    explicit RollupBuilder(std::chrono::seconds step);
+
+    // Start of the bucket of the given step that holds the time
+    static std::chrono::system_clock::time_point bucketStart(std::chrono::system_clock::time_point time, std::chrono::seconds step);
+
+    void add(const Rollup& rollup);
+    void add(const HistorySample& sample);
+
+    std::vector<Rollup> finish();
+
+private:
+    Rollup& bucket(std::chrono::system_clock::time_point time);
+
+    std::chrono::seconds step;
+    std::vector<Rollup> result;
+};
+
+// Rollups of the aggregated power at several resolutions, so a query over months reads a few thousand
+// records instead of millions of samples. Every level keeps its buckets in an append-only file of fixed
+// size records, buckets are aligned to the epoch (days are UTC days).
+//
+// Buckets are only written once they are complete. The TimeSeriesStore owns the index, serializes the
+// access to it and replays the samples from resumeTime() to rebuild the buckets lost on a restart.
+// A LevelSnapshot reads the buckets of a level without that lock.
+class RollupIndex final
+{
+public:
+    using Clock = std::chrono::system_clock;
+
+    struct Level
+    {
+        std::string_view name;
+        std::chrono::seconds duration;
+        std::chrono::hours retention;                    // Zero keeps the buckets forever
+    };
+
+    static constexpr std::array<Level, 5> Levels{{
+        {"10s", std::chrono::seconds{10}, std::chrono::hours{24 * 7}},
+        {"1m", std::chrono::minutes{1}, std::chrono::hours{24 * 90}},
+        {"15m", std::chrono::minutes{15}, std::chrono::hours{0}},
+        {"1h", std::chrono::hours{1}, std::chrono::hours{0}},
+        {"1d", std::chrono::hours{24}, std::chrono::hours{0}}
+    }};
+
+    // Opens the level files in the given directory and drops a torn record at their end, throws if they are not usable
+    explicit RollupIndex(const std::filesystem::path& directory);
+
+    RollupIndex(RollupIndex const &) = delete;
+    RollupIndex &operator=(RollupIndex const &) = delete;
+    RollupIndex(RollupIndex &&) = delete;
+    RollupIndex &operator=(RollupIndex &&) = delete;
+
+    // Samples from this time on have to be added again to complete the buckets that were not written,
+    // the minimum of the clock if a level holds no bucket yet
+    Clock::time_point resumeTime() const;
+
+    // Samples of buckets that are already written are ignored
+    void add(const HistorySample& sample);
+
+    // Appends the completed buckets to the files and applies the retention, throws on failure.
+    // The buckets of a failed write are kept and written by the next flush.
+    void flush();
+
+    // Coarsest level whose duration divides the step, none if there is no such level
+    static std::optional<size_t> levelFor(std::chrono::seconds step);
+
+    // Start of the oldest bucket of the level, none if it holds no bucket yet
+    std::optional<Clock::time_point> oldest(size_t level) const;
+
+    // Buckets of the given step from the level, see TimeSeriesStore::queryRollups(). The step has to be a multiple
+    // of the level duration.
+    std::vector<Rollup> query(size_t level, Clock::time_point since, Clock::time_point until, std::chrono::seconds step) const;
+
+    // State of a level at one point in time, queried while the index goes on. The file is appended to behind
+    // the records seen here, and replaced by rename when trimmed, so the duplicated descriptor keeps them readable.
+    struct LevelSnapshot
+    {
+        std::filesystem::path path;
+        FileDescriptor fd;
+        size_t numRecords{0};
+        int64_t firstStart_ms{0};
+        int64_t lastStart_ms{0};
+        std::vector<Rollup> pending;                     // Completed and open buckets that are not written yet
+
+        std::vector<Rollup> query(Clock::time_point since, Clock::time_point until, std::chrono::seconds step) const;
+    };
+
+    // Cheap, reads no file
+    LevelSnapshot snapshot(size_t level) const;
+
+private:
+    struct LevelState
+    {
+        std::filesystem::path path;
+        FileDescriptor fd;
+        size_t numRecords{0};
+        int64_t firstStart_ms{0};                        // Of the oldest record, if there is one
+        int64_t lastStart_ms{0};                         // Of the newest record, if there is one
+        std::optional<Rollup> open;                      // Still collecting samples
+        std::vector<Rollup> completed;                   // Not written yet
+    };
+
+    void openLevel(size_t level);
+    void trim(size_t level, int64_t now_ms);
+
+    std::filesystem::path directory;
+    std::array<LevelState, Levels.size()> levels;
+};
+
+}
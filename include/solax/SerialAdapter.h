@@ -1,5 +1,13 @@
 #pragma once
 #include <CppLinuxSerial/SerialPort.hpp>
+#include <solax/FileDescriptor.h>
+#include <solax/FrameAssembler.h>
+#include <solax/LatencyTracker.h>
+#include <solax/TelemetryError.h>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string_view>
 
 namespace solax
 {
@@ -16,6 +24,7 @@ public:
         mn::CppLinuxSerial::NumStopBits numStopBits{mn::CppLinuxSerial::NumStopBits::ONE};
         mn::CppLinuxSerial::HardwareFlowControl hardwareFlowControl{mn::CppLinuxSerial::HardwareFlowControl::OFF};
         mn::CppLinuxSerial::SoftwareFlowControl softwareFlowControl{mn::CppLinuxSerial::SoftwareFlowControl::OFF};
+        LatencyTracker::Config responseTimeout{};
     };
 
     SerialAdapter(const Config& config);
@@ -26,11 +35,46 @@ public:
 	SerialAdapter(SerialAdapter &&) = delete;
 	SerialAdapter &operator=(SerialAdapter &&) = delete;
     
-    std::string readRawTelemetry(uint8_t machineIndex);
+    // Sends an inquiry command (without CRC and terminator) and returns the validated response
+    // between start byte and terminator, including its two CRC bytes. Responses that do not fit the
+    // inquiry, e.g. a late one to the previous command or one of the unit another index answered with, are skipped.
+    // The returned view points into the receive buffer and stays valid until the next query.
+    // A response that does not arrive intact after all attempts is reported as error, a failing device throws.
+    TelemetryResult<std::string_view> query(std::string_view inquiry);
+
+    TelemetryResult<std::string_view> readRawTelemetry(uint8_t machineIndex);
+
+    const std::string& devicePath() const { return activeDevicePath; }
+
+    // Current response timeout of a command type, derived from its measured latencies
+    std::chrono::milliseconds responseTimeout(std::string_view inquiry) const;
+
+    // Closes and reopens the device that answered the probe without probing again.
+    // Cheap recovery after a brown-out that left the device node in place. Throws if the device is gone.
+    void reopen();
 
 private:
-    mn::CppLinuxSerial::SerialPort serialPort;
+    LatencyTracker& latencyTrackerOf(std::string_view inquiry);
+    void discardLateResponses();
+    bool answeredByOtherIndex(std::string_view inquiry, std::string_view serialNumber) const;
+    void rememberSerialNumber(std::string_view inquiry, std::string_view serialNumber);
+
+    LatencyTracker::Config responseTimeoutConfig;
+    std::map<std::string, LatencyTracker, std::less<>> latencyTrackers;
+    std::unique_ptr<mn::CppLinuxSerial::SerialPort> serialPort;
     std::string activeDevicePath;
+    FileDescriptor receiveFd;
+    FrameAssembler frameAssembler;
+
+    // Responses to commands sent before that have not arrived yet, they are waited for until
+    // lateResponseDeadline before a different inquiry is sent
+    size_t numResponsesInFlight{0};
+    std::chrono::steady_clock::time_point lateResponseDeadline{};
+    std::string lastInquiry;
+
+    // Serial number each indexed inquiry, e.g. QPGS1, was last answered with. A late response of one unit
+    // is not taken for the answer of another.
+    std::map<std::string, std::string, std::less<>> unitSerialNumbers;
 };
 
 
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace solax
+{
+
+// Gorilla style compression of slowly changing time series (Pelkonen et al., "Gorilla: A Fast, Scalable,
+// In-Memory Time Series Database"). Each series keeps the state of its predictor; a value equal to the
+// previous one takes a single bit.
+
+// Writes bits MSB first into a fixed buffer. Bits beyond the write position may hold garbage, they are
+// overwritten rather than or'ed, so a torn tail can simply be written over.
+class BitWriter final
+{
+public:
+    BitWriter(std::byte* dataParam, size_t capacityBits, size_t positionBits = 0)
+    : data{dataParam}, capacity{capacityBits}, position{positionBits} {}
+
+    // The lowest numBits (<= 64) of value
+    void write(uint64_t value, unsigned numBits);
+
+    size_t bitsWritten() const { return position; }
+    size_t bitsLeft() const { return capacity - position; }
+
+private:
+    std::byte* data;
+    size_t capacity;
+    size_t position;
+};
+
+class BitReader final
+{
+public:
+    BitReader(const std::byte* dataParam, size_t sizeBits) : data{dataParam}, size{sizeBits} {}
+
+    // Reads numBits (<= 64), throws std::out_of_range past the end
+    uint64_t read(unsigned numBits);
+    bool readBit() { return read(1) != 0; }
+
+    size_t bitsRead() const { return position; }
+    bool atEnd() const { return position >= size; }
+
+private:
+    const std::byte* data;
+    size_t size;
+    size_t position{0};
+};
+
+// Delta of delta: samples taken at a steady pace encode in one bit, jitter of up to 64 in 9 bits
+struct TimestampState
+{
+    int64_t previous{0};
+    int64_t previousDelta{0};
+};
+
+inline constexpr unsigned MaxTimestampBits{4 + 64};
+
+void encodeTimestamp(BitWriter& writer, TimestampState& state, int64_t timestamp);
+int64_t decodeTimestamp(BitReader& reader, TimestampState& state);
+
+// XOR with the previous value, only the bits in between the leading and trailing zeros are kept
+struct FloatState
+{
+    uint32_t previous{0};
+    uint8_t leadingZeros{0xff};                  // Window of the last stored bits, none yet
+    uint8_t trailingZeros{0};
+};
+
+inline constexpr unsigned MaxFloatBits{2 + 5 + 5 + 32};
+
+void encodeFloat(BitWriter& writer, FloatState& state, float value);
+float decodeFloat(BitReader& reader, FloatState& state);
+
+// One bit if unchanged, otherwise the zig-zag encoded delta as varint of 7 bit groups
+struct IntegerState
+{
+    int64_t previous{0};
+};
+
+inline constexpr unsigned MaxIntegerBits{1 + 10 * 8};
+
+void encodeInteger(BitWriter& writer, IntegerState& state, int64_t value);
+int64_t decodeInteger(BitReader& reader, IntegerState& state);
+
+}
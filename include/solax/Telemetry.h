@@ -3,37 +3,40 @@
 #include <vector>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <chrono>
+#include <solax/TelemetryError.h>
 
 namespace solax
 {
 
 // QPGSn response structure - Parallel Information inquiry
+// Letters refer to the data description of protocol section 2.11, fields are listed in TelemetrySchema.h
 struct UnitTelemetry {
-    int32_t parallelNum{0};                      // A: Parallel machine number (0: not exist, 1: exist)
-    std::string serialNumber;                    // B: 14-digit serial number
-    char workMode{'P'};                          // C: Work mode (P/S/L/B/F/D)
-    int32_t faultCode{0};                        // D: Fault code (00-86)
-    float gridVoltage_V{0.0f};                   // E: Grid voltage (V)
-    float gridFrequency_Hz{0.0f};                // F: Grid frequency (Hz)
-    float acOutputVoltage_V{0.0f};               // G: AC output voltage (V)
-    float acOutputFrequency_Hz{0.0f};            // H: AC output frequency (Hz)
-    int32_t acOutputApparentPower_VA{0};         // I: AC output apparent power (VA)
-    int32_t acOutputActivePower_W{0};            // J: AC output active power (W)
-    int32_t loadPercent{0};                      // K: Load percentage (%)
-    float batteryVoltage_V{0.0f};                // L: Battery voltage (V)
-    int32_t batteryChargingCurrent_A{0};         // M: Battery charging current (A)
-    int32_t batteryCapacity_pct{0};              // N: Battery capacity (%)
-    float pv1InputVoltage_V{0.0f};               // O: PV1 input voltage (V)
-    int32_t totalChargingCurrent_A{0};           // P: Total charging current (A)
-    int32_t totalAcOutputApparentPower_VA{0};    // Q: Total AC output apparent power (VA)
-    int32_t totalOutputActivePower_W{0};         // R: Total output active power (W)
-    int32_t totalAcOutputPercent{0};             // S: Total AC output percentage (%)
+    int32_t parallelNum{0};                      // B: Parallel machine number (0: not exist, 1: exist)
+    std::string serialNumber;                    // C: 14-digit serial number
+    char workMode{'P'};                          // D: Work mode (P/S/L/B/F/D)
+    int32_t faultCode{0};                        // E: Fault code (00-86)
+    float gridVoltage_V{0.0f};                   // F: Grid voltage (V)
+    float gridFrequency_Hz{0.0f};                // G: Grid frequency (Hz)
+    float acOutputVoltage_V{0.0f};               // H: AC output voltage (V)
+    float acOutputFrequency_Hz{0.0f};            // I: AC output frequency (Hz)
+    int32_t acOutputApparentPower_VA{0};         // J: AC output apparent power (VA)
+    int32_t acOutputActivePower_W{0};            // K: AC output active power (W)
+    int32_t loadPercent{0};                      // L: Load percentage (%)
+    float batteryVoltage_V{0.0f};                // M: Battery voltage (V)
+    int32_t batteryChargingCurrent_A{0};         // N: Battery charging current (A)
+    int32_t batteryCapacity_pct{0};              // O: Battery capacity (%)
+    float pv1InputVoltage_V{0.0f};               // P: PV1 input voltage (V)
+    int32_t totalChargingCurrent_A{0};           // Q: Total charging current (A)
+    int32_t totalAcOutputApparentPower_VA{0};    // R: Total AC output apparent power (VA)
+    int32_t totalOutputActivePower_W{0};         // S: Total output active power (W)
+    int32_t totalAcOutputPercent{0};             // T: Total AC output percentage (%)
     std::string inverterStatus;                  // U: Inverter status bits (b7-b0)
-    int32_t outputMode{0};                       // T: Output mode (0-7)
-    int32_t chargerSourcePriority{0};            // U: Charger source priority (0-3)
-    int32_t maxChargerCurrent_A{0};              // V: Max charger current (A)
-    int32_t maxChargerRange_A{0};                // W: Max charger range (A)
+    int32_t outputMode{0};                       // V: Output mode (0-7)
+    int32_t chargerSourcePriority{0};            // W: Charger source priority (0-3)
+    int32_t maxChargerCurrent_A{0};              // X: Max charger current (A)
+    int32_t maxChargerRange_A{0};                // Y: Max charger range (A)
     int32_t maxAcChargerCurrent_A{0};            // Z: Max AC charger current (A)
     int32_t pv1InputCurrent_A{0};                // a: PV1 input current (A)
     int32_t batteryDischargeCurrent_A{0};        // b: Battery discharge current (A)
@@ -47,9 +50,91 @@ struct AggregatedTelemetry {
     float batteryPower_W{};                      // Total power put into the battery (can be negative while discharing the battery)
 };
 
+// Energy integrated from the sampled power, monotonically increasing
+struct EnergyTotals {
+    double solar_kWh{};                          // Generated by photovoltaik
+    double load_kWh{};                           // Put into the AC
+    double batteryCharge_kWh{};                  // Put into the battery
+    double batteryDischarge_kWh{};               // Taken from the battery
+};
+
+
+// QPIGS response structure - Device general status, letters refer to protocol section 2.9
+struct GeneralStatus {
+    float gridVoltage_V{0.0f};                   // b: Grid voltage (V)
+    float gridFrequency_Hz{0.0f};                // C: Grid frequency (Hz)
+    float acOutputVoltage_V{0.0f};               // D: AC output voltage (V)
+    float acOutputFrequency_Hz{0.0f};            // E: AC output frequency (Hz)
+    int32_t acOutputApparentPower_VA{0};         // F: AC output apparent power (VA)
+    int32_t acOutputActivePower_W{0};            // G: AC output active power (W)
+    int32_t loadPercent{0};                      // H: Output load percentage (%)
+    int32_t busVoltage_V{0};                     // I: DC bus voltage (V)
+    float batteryVoltage_V{0.0f};                // j: Battery voltage (V)
+    int32_t batteryChargingCurrent_A{0};         // k: Battery charging current (A)
+    int32_t batteryCapacity_pct{0};              // o: Battery capacity (%)
+    int32_t heatSinkTemperature_C{0};            // P: Inverter heat sink temperature (°C)
+    float pv1InputCurrent_A{0.0f};               // r: PV1 input current (A)
+    float pv1InputVoltage_V{0.0f};               // t: PV1 input voltage (V)
+    float sccBatteryVoltage_V{0.0f};             // u: Battery voltage measured by the solar charger (V)
+    int32_t batteryDischargeCurrent_A{0};        // w: Battery discharge current (A)
+    std::string deviceStatus;                    // x: Device status bits (b7-b0)
+    int32_t fanBatteryVoltageOffset_10mV{0};     // y: Battery voltage offset for fans on (10 mV)
+    int32_t eepromVersion{0};                    // z: EEPROM version
+    int32_t pv1ChargingPower_W{0};               // PV1 charging power (W)
+    std::string deviceStatus2;                   // Device status bits (b10-b8)
+};
+
+// QPIGS2 response structure - PV2 status (48V models only), letters refer to protocol section 2.10
+struct Pv2Status {
+    float pv2InputCurrent_A{0.0f};               // b: PV2 input current (A)
+    float pv2InputVoltage_V{0.0f};               // c: PV2 input voltage (V)
+    int32_t pv2ChargingPower_W{0};               // d: PV2 charging power (W)
+};
+
+// QPIWS response structure - Warning status, see protocol section 2.13 for the meaning of each bit
+struct WarningStatus {
+    std::string warningBits;                     // a0..a35: '1' if the warning is active
+};
+
+// QMOD response structure - Device mode
+struct DeviceMode {
+    char mode{'P'};                              // Work mode (P/S/L/B/F/D)
+};
+
+// Single unit status gathered from the inquiries above
+struct DeviceStatus {
+    GeneralStatus general;
+    Pv2Status pv2;
+    WarningStatus warnings;
+    DeviceMode mode;
+};
+
+
+
+// Parse responses as returned by SerialAdapter::query, i.e. including the 2-byte CRC.
+// A NAK, a missing or a malformed field is reported as error, naming the first offending field.
+TelemetryResult<UnitTelemetry> parseRawTelemetry(std::string_view rawTelemetry);
+TelemetryResult<GeneralStatus> parseGeneralStatus(std::string_view response);
+TelemetryResult<Pv2Status> parsePv2Status(std::string_view response);
+TelemetryResult<WarningStatus> parseWarningStatus(std::string_view response);
+TelemetryResult<DeviceMode> parseDeviceMode(std::string_view response);
+
+// Hands a successfully received response to one of the parsers above and passes a receive error through.
+// Does what std::expected::and_then does, which not every supported compiler provides yet.
+template<typename Parser>
+auto parseResponse(const TelemetryResult<std::string_view>& response, Parser&& parse) -> decltype(parse(*response))
+{
+    if (!response) {
+        return std::unexpected(response.error());
+    }
+    return parse(*response);
+}
 
+// True if the inverter answered with NAK, e.g. because the model does not support the inquiry
+bool isRejectedInquiry(std::string_view response);
 
-UnitTelemetry parseRawTelemetry(const std::string& rawTelemetry);
+// Power flows of a single unit
+AggregatedTelemetry unitPower(const UnitTelemetry& unitTelemetry);
 
 AggregatedTelemetry aggregateTelemetry(const std::vector<UnitTelemetry>& unitTelemetry);
 
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <string>
+#include <string_view>
+
+namespace solax
+{
+
+enum class TelemetryErrorKind : uint8_t
+{
+    NoResponse,                                  // Nothing received at all, the device is probably gone
+    CorruptedResponse,                           // Only responses with a CRC mismatch or incomplete frames arrived
+    RejectedInquiry,                             // The inverter answered NAK
+    MissingField,                                // The response ended before all fields were read
+    MalformedField                               // A field does not hold a value of the expected type
+};
+
+inline constexpr size_t numTelemetryErrorKinds{5};
+
+// Why a response could not be turned into telemetry. A bad sample is reported instead of thrown,
+// so the acquisition loop can drop it and carry on with the next one.
+struct TelemetryError
+{
+    TelemetryErrorKind kind;
+    size_t fieldIndex{0};                        // Zero based field position, only set for field errors
+    std::string_view fieldName{};                // Name of that field in the telemetry schema
+};
+
+template<typename T>
+using TelemetryResult = std::expected<T, TelemetryError>;
+
+std::string_view toString(TelemetryErrorKind kind);
+
+// E.g. "malformed field 11 (batteryVoltage_V)"
+std::string describe(const TelemetryError& error);
+
+// Counts the errors per kind, safe to read from other threads while the acquisition loop counts
+class TelemetryErrorCounters final
+{
+public:
+    void count(const TelemetryError& error)
+    {
+        counters[static_cast<size_t>(error.kind)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint64_t operator[](TelemetryErrorKind kind) const
+    {
+        return counters[static_cast<size_t>(kind)].load(std::memory_order_relaxed);
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, numTelemetryErrorKinds> counters{};
+};
+
+}
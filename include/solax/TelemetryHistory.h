@@ -0,0 +1,103 @@
+#pragma once
+
+#include <solax/Telemetry.h>
+#include <solax/TelemetrySchema.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace solax
+{
+
+// Power of the stack and of each of its units at one point in time
+struct HistorySample
+{
+    static constexpr size_t MaxUnits{9};                     // Units beyond are not recorded
+
+    std::chrono::system_clock::time_point time{};
+    AggregatedTelemetry aggregated{};
+    uint8_t numUnits{0};
+    std::array<AggregatedTelemetry, MaxUnits> units{};
+};
+
+HistorySample makeHistorySample(std::chrono::system_clock::time_point sampleTime, const AggregatedTelemetry& aggregatedTelemetry,
+                                const std::vector<UnitTelemetry>& unitTelemetries);
+
+// Averages samples given in chronological order over at most maxSamples intervals of equal duration
+// spanning [first, last]. Empty intervals are left out, a unit is averaged over the samples it is part of.
+class Downsampler final
+{
+public:
+    Downsampler(std::chrono::system_clock::time_point first, std::chrono::system_clock::time_point last, size_t maxSamples);
+
+    void add(const HistorySample& sample);
+
+    std::vector<HistorySample> finish();
+
+private:
+    using Sums = std::array<double, NumPowerChannels>;       // One per channel of AggregatedTelemetry
+
+    void emit();
+
+    std::chrono::system_clock::time_point first;
+    std::chrono::system_clock::duration interval;
+    size_t currentInterval{0};
+    std::vector<HistorySample> result;
+
+    // Accumulated in double to keep the rounding errors of long intervals small
+    std::chrono::system_clock::time_point intervalStart{};
+    double timeOffset{0.0};                                  // Sum of the sample times relative to intervalStart, in seconds
+    Sums aggregated{};
+    std::array<Sums, HistorySample::MaxUnits> units{};
+    std::array<size_t, HistorySample::MaxUnits> numUnitSamples{};
+    uint8_t numUnits{0};
+    size_t numSamples{0};
+};
+
+// Keeps the most recent samples in a ring buffer that is allocated once, so consumers can backfill
+// whatever they missed between two polls. Safe to query from the REST threads while the acquisition
+// loop adds samples.
+class TelemetryHistory final
+{
+public:
+    using Clock = std::chrono::system_clock;
+
+    struct Config
+    {
+        size_t capacity{21600};                              // Six hours at one sample per second
+    };
+
+    explicit TelemetryHistory(const Config& config);
+
+    TelemetryHistory(TelemetryHistory const &) = delete;
+    TelemetryHistory &operator=(TelemetryHistory const &) = delete;
+    TelemetryHistory(TelemetryHistory &&) = delete;
+    TelemetryHistory &operator=(TelemetryHistory &&) = delete;
+
+    // The oldest sample is overwritten once the buffer is full. A sample that is not newer than the
+    // last one, e.g. after the wall clock stepped back, is dropped.
+    void add(const HistorySample& sample);
+    void add(Clock::time_point sampleTime, const AggregatedTelemetry& aggregatedTelemetry,
+             const std::vector<UnitTelemetry>& unitTelemetries);
+
+    // Samples within [since, until] in chronological order, downsampled with a Downsampler if there are more
+    // than maxSamples > 0 of them
+    std::vector<HistorySample> query(Clock::time_point since, Clock::time_point until, size_t maxSamples = 0) const;
+
+    // Time of the oldest sample kept, none while empty
+    std::optional<Clock::time_point> oldest() const;
+
+    size_t size() const;
+
+private:
+    mutable std::mutex mutex;
+    std::vector<HistorySample> samples;
+    size_t next{0};
+    size_t count{0};
+};
+
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <solax/RollingStatistics.h>
+#include <solax/RollupIndex.h>
+#include <solax/Telemetry.h>
+#include <solax/TelemetryHistory.h>
+#include <solax/TelemetrySchema.h>
+#include <solax/TelemetrySnapshot.h>
+
+#include <bitset>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace solax
+{
+
+// Renders telemetry as a compact JSON object, generated from the field tables in TelemetrySchema.h
+void appendJson(std::string& out, const UnitTelemetry& telemetry);
+void appendJson(std::string& out, const AggregatedTelemetry& telemetry);
+void appendJson(std::string& out, const EnergyTotals& energy);
+void appendJson(std::string& out, const GeneralStatus& status);
+void appendJson(std::string& out, const Pv2Status& status);
+void appendJson(std::string& out, const WarningStatus& status);
+void appendJson(std::string& out, const DeviceMode& mode);
+
+// Nests the status of each inquiry under "general", "pv2", "warnings" and "mode"
+void appendJson(std::string& out, const DeviceStatus& status);
+
+// Window, its duration in seconds and number of samples, followed by the statistics of each power channel
+void appendJson(std::string& out, const WindowStatistics& statistics);
+
+// Sample time in milliseconds since the epoch, aggregated power and the power of each unit
+void appendJson(std::string& out, const HistorySample& sample);
+
+// Wraps the samples into {"samples":[...]}
+void appendJson(std::string& out, const std::vector<HistorySample>& samples);
+
+// Bucket start in milliseconds since the epoch, number of samples and min, max, mean and sum of each power channel
+void appendJson(std::string& out, const Rollup& rollup);
+
+// Step in seconds and the resolution it was built from, followed by the buckets
+void appendJson(std::string& out, const RollupSeries& series);
+
+// Members of AggregatedTelemetry and UnitTelemetry to render, by their position in the field tables
+struct FieldSelection
+{
+    std::bitset<std::tuple_size_v<std::remove_const_t<decltype(aggregatedTelemetryFields)>>> aggregated;
+    std::bitset<std::tuple_size_v<std::remove_const_t<decltype(unitTelemetryFields)>>> units;
+};
+
+// Selects the fields of a comma separated list of member names, e.g. "solarPower_W,batteryVoltage_V".
+// Throws std::invalid_argument for a name that is no member of either struct.
+FieldSelection parseFieldSelection(std::string_view names);
+
+// Version, aggregate and units of the snapshot like SnapshotJson::all, with the selected fields only
+void appendJson(std::string& out, const TelemetrySnapshot& snapshot, const FieldSelection& fields);
+
+template<typename Telemetry>
+std::string toJson(const Telemetry& telemetry)
+{
+    std::string out;
+    out.reserve(1024);
+    appendJson(out, telemetry);
+    return out;
+}
+
+}
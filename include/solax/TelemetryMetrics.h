@@ -0,0 +1,27 @@
+#pragma once
+
+#include <solax/TelemetryError.h>
+#include <solax/TelemetrySnapshot.h>
+
+#include <string>
+#include <string_view>
+
+namespace solax
+{
+
+// Prometheus text exposition (format 0.0.4), generated from the field tables in TelemetrySchema.h.
+// Member names become snake case metric names with the unit of the schema as suffix,
+// e.g. batteryVoltage_V of UnitTelemetry becomes solax_unit_battery_voltage_volts.
+inline constexpr std::string_view MetricsContentType{"text/plain; version=0.0.4; charset=utf-8"};
+
+// E.g. metricName("batteryCapacity_pct", "%") is "battery_capacity_percent"
+std::string metricName(std::string_view member, std::string_view unit);
+
+// Gauges of the aggregate and of every numeric field of each unit, labelled with its unit number and serial number.
+// Work mode and inverter status are labels of solax_unit_info. The number of published cycles is a counter.
+void appendMetrics(std::string& out, const TelemetrySnapshot& snapshot);
+
+// solax_telemetry_errors_total by kind of error
+void appendMetrics(std::string& out, const TelemetryErrorCounters& errorCounters);
+
+}
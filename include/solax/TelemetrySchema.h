@@ -0,0 +1,123 @@
+#pragma once
+
+#include <solax/Telemetry.h>
+
+#include <string_view>
+#include <tuple>
+
+namespace solax
+{
+
+// Describes one telemetry member. Parser, JSON serializer and tests are generated from these tables,
+// so a field only has to be listed once.
+template<typename Struct, typename Member>
+struct FieldDescriptor
+{
+    using StructType = Struct;
+    using MemberType = Member;
+
+    std::string_view name;
+    std::string_view jsonKey;                    // Pre-rendered object key including quotes and colon
+    Member Struct::* member;
+    std::string_view unit;
+};
+
+#define SOLAX_FIELD(Struct, member, unit) \
+    ::solax::FieldDescriptor<Struct, decltype(Struct::member)>{#member, "\"" #member "\":", &Struct::member, unit}
+
+// QPGSn response fields in protocol order, letters refer to the data description of protocol section 2.11
+inline constexpr auto unitTelemetryFields{std::make_tuple(
+    SOLAX_FIELD(UnitTelemetry, parallelNum, ""),                       // B
+    SOLAX_FIELD(UnitTelemetry, serialNumber, ""),                      // C
+    SOLAX_FIELD(UnitTelemetry, workMode, ""),                          // D
+    SOLAX_FIELD(UnitTelemetry, faultCode, ""),                         // E
+    SOLAX_FIELD(UnitTelemetry, gridVoltage_V, "V"),                    // F
+    SOLAX_FIELD(UnitTelemetry, gridFrequency_Hz, "Hz"),                // G
+    SOLAX_FIELD(UnitTelemetry, acOutputVoltage_V, "V"),                // H
+    SOLAX_FIELD(UnitTelemetry, acOutputFrequency_Hz, "Hz"),            // I
+    SOLAX_FIELD(UnitTelemetry, acOutputApparentPower_VA, "VA"),        // J
+    SOLAX_FIELD(UnitTelemetry, acOutputActivePower_W, "W"),            // K
+    SOLAX_FIELD(UnitTelemetry, loadPercent, "%"),                      // L
+    SOLAX_FIELD(UnitTelemetry, batteryVoltage_V, "V"),                 // M
+    SOLAX_FIELD(UnitTelemetry, batteryChargingCurrent_A, "A"),         // N
+    SOLAX_FIELD(UnitTelemetry, batteryCapacity_pct, "%"),              // O
+    SOLAX_FIELD(UnitTelemetry, pv1InputVoltage_V, "V"),                // P
+    SOLAX_FIELD(UnitTelemetry, totalChargingCurrent_A, "A"),           // Q
+    SOLAX_FIELD(UnitTelemetry, totalAcOutputApparentPower_VA, "VA"),   // R
+    SOLAX_FIELD(UnitTelemetry, totalOutputActivePower_W, "W"),         // S
+    SOLAX_FIELD(UnitTelemetry, totalAcOutputPercent, "%"),             // T
+    SOLAX_FIELD(UnitTelemetry, inverterStatus, ""),                    // U
+    SOLAX_FIELD(UnitTelemetry, outputMode, ""),                        // V
+    SOLAX_FIELD(UnitTelemetry, chargerSourcePriority, ""),             // W
+    SOLAX_FIELD(UnitTelemetry, maxChargerCurrent_A, "A"),              // X
+    SOLAX_FIELD(UnitTelemetry, maxChargerRange_A, "A"),                // Y
+    SOLAX_FIELD(UnitTelemetry, maxAcChargerCurrent_A, "A"),            // Z
+    SOLAX_FIELD(UnitTelemetry, pv1InputCurrent_A, "A"),                // a
+    SOLAX_FIELD(UnitTelemetry, batteryDischargeCurrent_A, "A"),        // b
+    SOLAX_FIELD(UnitTelemetry, pv2InputVoltage_V, "V"),                // c
+    SOLAX_FIELD(UnitTelemetry, pv2InputCurrent_A, "A")                 // d
+)};
+
+inline constexpr auto aggregatedTelemetryFields{std::make_tuple(
+    SOLAX_FIELD(AggregatedTelemetry, solarPower_W, "W"),
+    SOLAX_FIELD(AggregatedTelemetry, acPower_W, "W"),
+    SOLAX_FIELD(AggregatedTelemetry, batteryPower_W, "W")
+)};
+
+// Number of power channels of AggregatedTelemetry, in the order of aggregatedTelemetryFields
+inline constexpr size_t NumPowerChannels{std::tuple_size_v<std::remove_const_t<decltype(aggregatedTelemetryFields)>>};
+
+inline constexpr auto energyTotalsFields{std::make_tuple(
+    SOLAX_FIELD(EnergyTotals, solar_kWh, "kWh"),
+    SOLAX_FIELD(EnergyTotals, load_kWh, "kWh"),
+    SOLAX_FIELD(EnergyTotals, batteryCharge_kWh, "kWh"),
+    SOLAX_FIELD(EnergyTotals, batteryDischarge_kWh, "kWh")
+)};
+
+// QPIGS response fields in protocol order, the reserved solar feed to grid fields at the end are not parsed
+inline constexpr auto generalStatusFields{std::make_tuple(
+    SOLAX_FIELD(GeneralStatus, gridVoltage_V, "V"),
+    SOLAX_FIELD(GeneralStatus, gridFrequency_Hz, "Hz"),
+    SOLAX_FIELD(GeneralStatus, acOutputVoltage_V, "V"),
+    SOLAX_FIELD(GeneralStatus, acOutputFrequency_Hz, "Hz"),
+    SOLAX_FIELD(GeneralStatus, acOutputApparentPower_VA, "VA"),
+    SOLAX_FIELD(GeneralStatus, acOutputActivePower_W, "W"),
+    SOLAX_FIELD(GeneralStatus, loadPercent, "%"),
+    SOLAX_FIELD(GeneralStatus, busVoltage_V, "V"),
+    SOLAX_FIELD(GeneralStatus, batteryVoltage_V, "V"),
+    SOLAX_FIELD(GeneralStatus, batteryChargingCurrent_A, "A"),
+    SOLAX_FIELD(GeneralStatus, batteryCapacity_pct, "%"),
+    SOLAX_FIELD(GeneralStatus, heatSinkTemperature_C, "°C"),
+    SOLAX_FIELD(GeneralStatus, pv1InputCurrent_A, "A"),
+    SOLAX_FIELD(GeneralStatus, pv1InputVoltage_V, "V"),
+    SOLAX_FIELD(GeneralStatus, sccBatteryVoltage_V, "V"),
+    SOLAX_FIELD(GeneralStatus, batteryDischargeCurrent_A, "A"),
+    SOLAX_FIELD(GeneralStatus, deviceStatus, ""),
+    SOLAX_FIELD(GeneralStatus, fanBatteryVoltageOffset_10mV, "10mV"),
+    SOLAX_FIELD(GeneralStatus, eepromVersion, ""),
+    SOLAX_FIELD(GeneralStatus, pv1ChargingPower_W, "W"),
+    SOLAX_FIELD(GeneralStatus, deviceStatus2, "")
+)};
+
+inline constexpr auto pv2StatusFields{std::make_tuple(
+    SOLAX_FIELD(Pv2Status, pv2InputCurrent_A, "A"),
+    SOLAX_FIELD(Pv2Status, pv2InputVoltage_V, "V"),
+    SOLAX_FIELD(Pv2Status, pv2ChargingPower_W, "W")
+)};
+
+inline constexpr auto warningStatusFields{std::make_tuple(
+    SOLAX_FIELD(WarningStatus, warningBits, "")
+)};
+
+inline constexpr auto deviceModeFields{std::make_tuple(
+    SOLAX_FIELD(DeviceMode, mode, "")
+)};
+
+// Calls func for every field descriptor, unrolled at compile time
+template<typename Fields, typename Func>
+constexpr void forEachField(const Fields& fields, Func&& func)
+{
+    std::apply([&](const auto&... field) { (func(field), ...); }, fields);
+}
+
+}
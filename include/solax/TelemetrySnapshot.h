@@ -0,0 +1,79 @@
+#pragma once
+
+#include <solax/Telemetry.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace solax
+{
+
+// JSON of the parts of a snapshot, rendered once when it is published instead of on every request
+struct SnapshotJson
+{
+    std::string all;                                         // Version, aggregate and units: {"version":..,"aggregated":{..},"units":[..]}
+    std::string aggregated;
+    std::vector<std::string> units;
+    std::string deviceStatus;
+    std::string energyTotals;
+    std::vector<std::string> unitEnergyTotals;
+};
+
+// Everything the acquisition loop publishes in one poll cycle. Never modified once published.
+struct TelemetrySnapshot
+{
+    uint64_t version{0};                                     // Increases by one with every published cycle, 0 before the first
+    AggregatedTelemetry aggregated{};
+    std::vector<UnitTelemetry> units;
+    DeviceStatus deviceStatus{};
+    EnergyTotals energyTotals{};
+    std::vector<EnergyTotals> unitEnergyTotals;              // One per entry of units
+    SnapshotJson json;                                       // Filled in by SnapshotPublisher::publish()
+    std::string metrics;                                     // Prometheus text of aggregate and units, filled in by publish() as well
+};
+
+// Hands the latest snapshot from the acquisition loop to the REST threads. Publishing swaps a pointer,
+// readers keep the snapshot they loaded alive for as long as they use it, so neither side waits on the
+// other for longer than the pointer swap and a reader always sees the data of a single cycle.
+//
+// Only one thread may publish, any number may read.
+class SnapshotPublisher final
+{
+public:
+    SnapshotPublisher();
+
+    SnapshotPublisher(SnapshotPublisher const &) = delete;
+    SnapshotPublisher &operator=(SnapshotPublisher const &) = delete;
+    SnapshotPublisher(SnapshotPublisher &&) = delete;
+    SnapshotPublisher &operator=(SnapshotPublisher &&) = delete;
+
+    // Numbers the snapshot with the next version, renders its JSON and metrics and makes it the latest one
+    std::shared_ptr<const TelemetrySnapshot> publish(TelemetrySnapshot snapshot);
+
+    // Never null, an empty snapshot of version 0 until the first one is published
+    std::shared_ptr<const TelemetrySnapshot> latest() const;
+
+    // Blocks until a snapshot newer than the given version is published, the timeout passed or the publisher
+    // is closed, returns the latest snapshot in any case
+    std::shared_ptr<const TelemetrySnapshot> waitForNewer(uint64_t version, std::chrono::steady_clock::duration timeout) const;
+
+    // Wakes up all waiting threads, waitForNewer() returns right away from now on
+    void close();
+
+private:
+    std::atomic<std::shared_ptr<const TelemetrySnapshot>> current;
+    uint64_t nextVersion{1};
+
+    // Only held to check the version while waiting, publish() merely notifies
+    mutable std::mutex waitMutex;
+    mutable std::condition_variable publishCondition;
+    bool closed{false};
+};
+
+}
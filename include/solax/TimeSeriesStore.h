@@ -0,0 +1,129 @@
+#pragma once
+
+#include <solax/RollupIndex.h>
+#include <solax/SeriesCompression.h>
+#include <solax/TelemetryHistory.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace solax
+{
+
+// Keeps the sample history on disk for months, without a database. Samples are appended to segment files
+// of fixed size that are written through mmap. Each segment consists of page aligned blocks, the time range
+// of every block and segment is indexed so a range query only decodes the blocks it needs.
+//
+// Blocks are compressed with SeriesCompression: every column (time, number of units and each power channel)
+// keeps its own predictor, the encoded columns of a sample follow each other so a block can be appended to
+// in place. A sample of a two unit stack typically takes about 12 bytes instead of 130.
+//
+// The aggregated power is also summarized by a RollupIndex, which answers queries over months from
+// precomputed buckets.
+//
+// Samples are collected in memory and written in batches to spare the SD card. A block header is only
+// updated after the samples it covers have reached the disk, so a power cut loses at most the samples of
+// the last flushInterval and recovery drops a torn block instead of serving garbage.
+//
+// Safe to query from the REST threads while the acquisition loop adds samples. Queries decode the sealed
+// blocks and read the rollup files without holding the lock, so a long range does not delay add().
+class TimeSeriesStore final
+{
+public:
+    using Clock = std::chrono::system_clock;
+
+    struct Config
+    {
+        std::string path{"history"};                         // Directory of the segment files
+        size_t segmentSize{16 * 1024 * 1024};                // Bytes, rounded down to whole blocks
+        std::chrono::hours retention{24 * 90};               // Segments holding older samples only are deleted
+        std::chrono::seconds flushInterval{60};
+    };
+
+    static constexpr size_t BlockSize{64 * 1024};
+
+    // Queries without a sample limit are downsampled to this many samples, months of raw samples would not fit into memory
+    static constexpr size_t MaxQuerySamples{100000};
+
+    // Indexes the existing segments and recovers the tail of the last one, throws if the directory is not usable
+    explicit TimeSeriesStore(const Config& config);
+    ~TimeSeriesStore();
+
+    TimeSeriesStore(TimeSeriesStore const &) = delete;
+    TimeSeriesStore &operator=(TimeSeriesStore const &) = delete;
+    TimeSeriesStore(TimeSeriesStore &&) = delete;
+    TimeSeriesStore &operator=(TimeSeriesStore &&) = delete;
+
+    // Samples that are not newer than the last one are ignored, e.g. after the clock was set back.
+    // Write errors are logged, the samples of a failed flush are dropped.
+    void add(const HistorySample& sample);
+
+    // Writes the collected samples to disk, throws on failure
+    void flush();
+
+    // Samples within [since, until] in chronological order, downsampled with a Downsampler if there are more
+    // than maxSamples of them (MaxQuerySamples if 0)
+    std::vector<HistorySample> query(Clock::time_point since, Clock::time_point until, size_t maxSamples = 0) const;
+
+    // Rollups of the aggregated power in buckets of the given step, aligned to the epoch, that overlap
+    // [since, until]. They are built from the coarsest rollup level whose duration divides the step, from the
+    // samples if there is none or if the samples reach further back than the level. Throws std::invalid_argument
+    // if the step is not positive and std::out_of_range if there would be more than MaxQuerySamples buckets.
+    RollupSeries queryRollups(Clock::time_point since, Clock::time_point until, std::chrono::seconds step) const;
+
+    size_t numSegments() const;
+
+private:
+    class MappedFile;
+
+    static constexpr size_t NumValueColumns{3 * (1 + HistorySample::MaxUnits)};
+
+    // Predictor state of every column of a block
+    struct EncoderState
+    {
+        TimestampState time;
+        IntegerState numUnits;
+        std::array<FloatState, NumValueColumns> values;
+    };
+
+    struct Segment
+    {
+        std::filesystem::path path;
+        int64_t minTime_ms;
+        int64_t maxTime_ms;
+        uint32_t numBlocks;                                  // Blocks holding samples, only the last one may be partially filled
+    };
+
+    // Calls func(sample) for the samples within [since, until] in chronological order, including the pending ones.
+    // Takes the lock only to collect what to read, func is called without it.
+    template<typename Func>
+    void forEachSample(int64_t since_ms, int64_t until_ms, Func&& func) const;
+
+    void openSegments();
+    void startSegment(int64_t firstTime_ms);
+    void writeSegmentHeader();
+    void applyRetention(int64_t now_ms);
+    void flushPending();
+    void flushRollups();
+
+    Config config;
+    std::vector<Segment> segments;                           // Chronological, samples are appended to the last one
+    std::unique_ptr<MappedFile> active;                      // Mapping of the last segment
+    uint32_t activeBlock{0};
+    uint32_t activeRows{0};                                  // Samples already in activeBlock
+    size_t activeBits{0};
+    EncoderState activeState{};
+    std::vector<HistorySample> pending;                      // Not written yet
+    std::unique_ptr<RollupIndex> rollups;
+    int64_t lastTime_ms;
+    Clock::time_point lastFlushTime{};
+    mutable std::mutex mutex;
+};
+
+}
@@ -1,6 +1,7 @@
 #include "Config.h"
 #include <libconfig_chained.h>
 #include <filesystem>
+#include <algorithm>
 
 
 namespace solax
@@ -18,6 +19,8 @@ struct RawSerialAdapterConfig
     int32_t numStopBits{1};
     bool hardwareFlowControlEnabled{false};
     bool softwareFlowControlEnabled{false};
+    int32_t responseTimeoutFloor_ms{200};
+    int32_t responseTimeoutCeiling_ms{5000};
 };
 
 mn::CppLinuxSerial::BaudRate selectBaudRate(int32_t baudRate)
@@ -128,8 +131,11 @@ solax::SerialAdapter::Config parseSerialAdapterConfig(const RawSerialAdapterConf
         .parity = selectParity(serialAdapterConfig.parity),
         .numStopBits = selectNumStopBits(serialAdapterConfig.numStopBits),
         .hardwareFlowControl = serialAdapterConfig.hardwareFlowControlEnabled ? mn::CppLinuxSerial::HardwareFlowControl::ON : mn::CppLinuxSerial::HardwareFlowControl::OFF,
-        .softwareFlowControl = serialAdapterConfig.softwareFlowControlEnabled ? mn::CppLinuxSerial::SoftwareFlowControl::ON : mn::CppLinuxSerial::SoftwareFlowControl::OFF
+        .softwareFlowControl = serialAdapterConfig.softwareFlowControlEnabled ? mn::CppLinuxSerial::SoftwareFlowControl::ON : mn::CppLinuxSerial::SoftwareFlowControl::OFF,
+        .responseTimeout = {}
     };
+    result.responseTimeout.floor = std::chrono::milliseconds{serialAdapterConfig.responseTimeoutFloor_ms};
+    result.responseTimeout.ceiling = std::chrono::milliseconds{std::max(serialAdapterConfig.responseTimeoutCeiling_ms, serialAdapterConfig.responseTimeoutFloor_ms)};
     return result;
 }
 
@@ -156,6 +162,8 @@ Config loadConfig(const std::string& configPath)
         auto rest{cs["rest"]};
         std::string address = rest["address"].defaultValue("localhost");
         const int port{rest["port"].min(0).max(65535).defaultValue(7735).isMandatory()};
+        const int maxStreams{rest["max_streams"].min(0).max(1024).defaultValue(8)};
+        const int longPollTimeout_s{rest["long_poll_timeout_s"].min(1).max(3600).defaultValue(30)};
 
         auto serialAdapter = cs["serial_adapter"];
         auto devicePathsCfg = serialAdapter["device_paths"];
@@ -180,9 +188,29 @@ Config loadConfig(const std::string& configPath)
             .parity = serialAdapter["parity"].defaultValue("none").isMandatory(),
             .numStopBits = serialAdapter["num_stop_bits"].min(1).max(2).defaultValue(1).isMandatory(),
             .hardwareFlowControlEnabled = serialAdapter["hardware_flow_control_enabled"].defaultValue(false).isMandatory(),
-            .softwareFlowControlEnabled = serialAdapter["software_flow_control_enabled"].defaultValue(false).isMandatory()
+            .softwareFlowControlEnabled = serialAdapter["software_flow_control_enabled"].defaultValue(false).isMandatory(),
+            .responseTimeoutFloor_ms = serialAdapter["response_timeout_floor_ms"].min(10).max(60000).defaultValue(200),
+            .responseTimeoutCeiling_ms = serialAdapter["response_timeout_ceiling_ms"].min(10).max(60000).defaultValue(5000)
         };
 
+        auto scheduler = cs["scheduler"];
+        const int cycleInterval_ms{scheduler["cycle_interval_ms"].min(0).max(60000).defaultValue(1000)};
+        const int topologyCheckInterval_ms{scheduler["topology_check_interval_ms"].min(1000).max(86400000).defaultValue(60000)};
+        const int statusInterval_ms{scheduler["status_interval_ms"].min(1000).max(86400000).defaultValue(5000)};
+
+        auto energy = cs["energy"];
+        std::string energyStatePath = energy["state_path"].defaultValue("energy.state");
+        const int energyPersistInterval_s{energy["persist_interval_s"].min(1).max(86400).defaultValue(300)};
+
+        auto history = cs["history"];
+        const int historyCapacity{history["capacity"].min(1).max(1000000).defaultValue(21600)};
+
+        auto store = cs["store"];
+        std::string storePath = store["path"].defaultValue("history");
+        const int storeSegmentSize_MB{store["segment_size_mb"].min(1).max(1024).defaultValue(16)};
+        const int storeRetention_days{store["retention_days"].min(1).max(3650).defaultValue(90)};
+        const int storeFlushInterval_s{store["flush_interval_s"].min(1).max(3600).defaultValue(60)};
+
         const auto errStr{errStream.str()};
         if (cs.isAnyMandatorySettingMissing() || not errStr.empty())
         {
@@ -204,7 +232,20 @@ Config loadConfig(const std::string& configPath)
 
         result.rest.address = address;
         result.rest.port = static_cast<uint16_t>(port);
+        result.rest.maxStreams = static_cast<size_t>(maxStreams);
+        result.rest.longPollTimeout = std::chrono::seconds{longPollTimeout_s};
         result.serialAdapter = parseSerialAdapterConfig(serialAdapterConfig);
+        result.scheduler.baudRate = static_cast<uint32_t>(serialAdapterConfig.baudRate);
+        result.scheduler.cycleInterval = std::chrono::milliseconds{cycleInterval_ms};
+        result.topologyCheckInterval = std::chrono::milliseconds{topologyCheckInterval_ms};
+        result.statusInterval = std::chrono::milliseconds{statusInterval_ms};
+        result.energy.statePath = energyStatePath;
+        result.energy.persistInterval = std::chrono::seconds{energyPersistInterval_s};
+        result.history.capacity = static_cast<size_t>(historyCapacity);
+        result.store.path = storePath;
+        result.store.segmentSize = static_cast<size_t>(storeSegmentSize_MB) * 1024 * 1024;
+        result.store.retention = std::chrono::hours{24 * storeRetention_days};
+        result.store.flushInterval = std::chrono::seconds{storeFlushInterval_s};
     }
     catch(const libconfig::FileIOException& fioex)
     {
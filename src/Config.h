@@ -1,6 +1,10 @@
 #pragma once
 #include "RestService.h"
 #include "solax/SerialAdapter.h"
+#include "solax/CommandScheduler.h"
+#include "solax/EnergyIntegrator.h"
+#include "solax/TelemetryHistory.h"
+#include "solax/TimeSeriesStore.h"
 
 namespace solax
 {
@@ -9,6 +13,12 @@ struct Config
 {
     RestService::Config rest;
     solax::SerialAdapter::Config serialAdapter;
+    solax::CommandScheduler::Config scheduler;
+    std::chrono::milliseconds topologyCheckInterval{60000};
+    std::chrono::milliseconds statusInterval{5000};          // Period of the QPIGS, QPIGS2, QPIWS and QMOD inquiries
+    solax::EnergyIntegrator::Config energy;
+    solax::TelemetryHistory::Config history;
+    solax::TimeSeriesStore::Config store;
 };
 
 Config loadConfig(const std::string& configPath);
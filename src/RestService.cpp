@@ -1,5 +1,10 @@
 #include "RestService.h"
 #include "cpprest/uri.h"
+#include <solax/TelemetryJson.h>
+#include <solax/TelemetryMetrics.h>
+#include <algorithm>
+#include <chrono>
+#include <limits>
 
 namespace solax
 {
@@ -9,63 +14,75 @@ using namespace web::http;
 namespace {
 
 utility::string_t BasePath{U("telemetry")};
-utility::string_t SolarPower{U("solarPower_W")};
-utility::string_t AcPower{U("acPower_W")};
-utility::string_t BatteryPower{U("batteryPower_W")};
+utility::string_t MetricsPath{U("metrics")};
+utility::string_t JsonContentType{U("application/json")};
+utility::string_t EventStreamContentType{U("text/event-stream")};
 
-auto asJson(const solax::AggregatedTelemetry& telemetry)
+// The stream thread wakes up at least this often to answer long polls that timed out
+constexpr std::chrono::seconds StreamTick{1};
+
+// Comments sent to idle event streams, keeps proxies from closing them
+constexpr std::chrono::seconds KeepaliveInterval{15};
+
+// Events not yet read by a client, a stream falling further behind is closed
+constexpr size_t MaxStreamBacklog{256 * 1024};
+
+utility::string_t DefaultStatisticsWindow{U("1m")};
+constexpr std::chrono::seconds DefaultRollupStep{std::chrono::hours{1}};
+
+auto asJson(const char* message)
 {
     web::json::value res = web::json::value::object();
-    res[SolarPower] = web::json::value::number(telemetry.solarPower_W);
-    res[AcPower] = web::json::value::number(telemetry.acPower_W);
-    res[BatteryPower] = web::json::value::number(telemetry.batteryPower_W);
+    res[U("error")] = web::json::value::string(message);
     return res;
 }
 
-auto asJson(const solax::UnitTelemetry& unit)
+// Whether an If-None-Match header value, a comma separated list of entity tags or "*", lists the tag
+bool listsEntityTag(const utility::string_t& ifNoneMatch, const utility::string_t& etag)
 {
-    web::json::value res = web::json::value::object();
-    res[U("parallelNum")] = web::json::value::number(unit.parallelNum);
-    res[U("serialNumber")] = web::json::value::string(unit.serialNumber);
-    res[U("workMode")] = web::json::value::string(utility::string_t(1, unit.workMode));
-    res[U("faultCode")] = web::json::value::number(unit.faultCode);
-    res[U("gridVoltage_V")] = web::json::value::number(unit.gridVoltage_V);
-    res[U("gridFrequency_Hz")] = web::json::value::number(unit.gridFrequency_Hz);
-    res[U("acOutputVoltage_V")] = web::json::value::number(unit.acOutputVoltage_V);
-    res[U("acOutputFrequency_Hz")] = web::json::value::number(unit.acOutputFrequency_Hz);
-    res[U("acOutputApparentPower_VA")] = web::json::value::number(unit.acOutputApparentPower_VA);
-    res[U("acOutputActivePower_W")] = web::json::value::number(unit.acOutputActivePower_W);
-    res[U("loadPercent")] = web::json::value::number(unit.loadPercent);
-    res[U("batteryVoltage_V")] = web::json::value::number(unit.batteryVoltage_V);
-    res[U("batteryChargingCurrent_A")] = web::json::value::number(unit.batteryChargingCurrent_A);
-    res[U("batteryCapacity_pct")] = web::json::value::number(unit.batteryCapacity_pct);
-    res[U("pv1InputVoltage_V")] = web::json::value::number(unit.pv1InputVoltage_V);
-    res[U("totalChargingCurrent_A")] = web::json::value::number(unit.totalChargingCurrent_A);
-    res[U("totalAcOutputApparentPower_VA")] = web::json::value::number(unit.totalAcOutputApparentPower_VA);
-    res[U("totalOutputActivePower_W")] = web::json::value::number(unit.totalOutputActivePower_W);
-    res[U("totalAcOutputPercent")] = web::json::value::number(unit.totalAcOutputPercent);
-    res[U("outputMode")] = web::json::value::number(unit.outputMode);
-    res[U("chargerSourcePriority")] = web::json::value::number(unit.chargerSourcePriority);
-    res[U("maxChargerCurrent_A")] = web::json::value::number(unit.maxChargerCurrent_A);
-    res[U("maxChargerRange_A")] = web::json::value::number(unit.maxChargerRange_A);
-    res[U("maxAcChargerCurrent_A")] = web::json::value::number(unit.maxAcChargerCurrent_A);
-    res[U("pv1InputCurrent_A")] = web::json::value::number(unit.pv1InputCurrent_A);
-    res[U("batteryDischargeCurrent_A")] = web::json::value::number(unit.batteryDischargeCurrent_A);
-    res[U("pv2InputVoltage_V")] = web::json::value::number(unit.pv2InputVoltage_V);
-    res[U("pv2InputCurrent_A")] = web::json::value::number(unit.pv2InputCurrent_A);
-    return res;
+    size_t begin{0};
+    while(begin < ifNoneMatch.size())
+    {
+        auto end{ifNoneMatch.find(U(','), begin)};
+        end = end == utility::string_t::npos ? ifNoneMatch.size() : end;
+
+        auto tag{ifNoneMatch.substr(begin, end - begin)};
+        tag.erase(0, tag.find_first_not_of(U(" \t")));
+        tag.erase(tag.find_last_not_of(U(" \t")) + 1);
+        if(tag.starts_with(U("W/")))
+        {
+            // Weak comparison, the representation of a version never changes anyway
+            tag.erase(0, 2);
+        }
+        if(tag == U("*") || tag == etag)
+        {
+            return true;
+        }
+        begin = end + 1;
+    }
+    return false;
 }
 
-auto asJson(const char* message)
+std::string telemetryEvent(const TelemetrySnapshot& snapshot)
 {
-    web::json::value res = web::json::value::object();
-    res[U("error")] = web::json::value::string(message);
-    return res;
+    std::string event{"id: "};
+    event.append(std::to_string(snapshot.version));
+    event.append("\nevent: telemetry\ndata: ");
+    event.append(snapshot.json.all);
+    event.append("\n\n");
+    return event;
 }
 
 }
 
-RestService::RestService(const Config& config)
+RestService::RestService(const Config& configParam, TelemetryStatistics& statisticsParam, const TelemetryHistory& historyParam,
+                         const TimeSeriesStore* storeParam, const TelemetryErrorCounters& errorCountersParam)
+: statistics{statisticsParam}
+, history{historyParam}
+, store{storeParam}
+, errorCounters{errorCountersParam}
+, config{configParam}
+, etagPrefix{std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count())}
 {   
     try
     {
@@ -83,6 +100,15 @@ RestService::RestService(const Config& config)
 
         service = std::make_unique<rest::Service>(fullUriStr, std::bind(&RestService::handleRequest, this, std::placeholders::_1, std::placeholders::_2));
         service->open().wait();
+
+        // Prometheus scrapes /metrics by default, next to the /telemetry endpoints
+        web::uri_builder metricsUri(address);
+        metricsUri.append_path(MetricsPath);
+        metricsListener = std::make_unique<experimental::listener::http_listener>(metricsUri.to_uri().to_string());
+        metricsListener->support(methods::GET, [this](http_request message) { reply(message, respondMetrics()); });
+        metricsListener->open().wait();
+
+        streamThread = std::thread{&RestService::streamLoop, this};
     }
     catch(const boost::wrapexcept<boost::system::system_error>& e)
     {
@@ -92,48 +118,373 @@ RestService::RestService(const Config& config)
 
 RestService::~RestService()
 {
+    // The stream thread ends the event streams and answers the long polls before it returns
+    {
+        std::lock_guard lock{streamMutex};
+        stopping = true;
+    }
+    snapshots.close();
+    streamThread.join();
+
+    metricsListener->close().wait();
     service->close().wait();
 }
 
 void RestService::updateTelemetry(const solax::AggregatedTelemetry& newAggregatedTelemetry,
-                                  const std::vector<solax::UnitTelemetry>& newUnitTelemetries)
+                                  const std::vector<solax::UnitTelemetry>& newUnitTelemetries,
+                                  const solax::DeviceStatus& newDeviceStatus,
+                                  const solax::EnergyTotals& newEnergyTotals,
+                                  const std::vector<solax::EnergyTotals>& newUnitEnergyTotals)
 {
-    const int newLatestTelemetryIndex{(latestTelemetryIndex + 1) & 1};
-    latestAggregatedTelemetry[newLatestTelemetryIndex] = newAggregatedTelemetry;
-    latestUnitTelemetries[newLatestTelemetryIndex] = newUnitTelemetries;
-    latestTelemetryIndex = newLatestTelemetryIndex;
+    snapshots.publish({
+        .aggregated = newAggregatedTelemetry,
+        .units = newUnitTelemetries,
+        .deviceStatus = newDeviceStatus,
+        .energyTotals = newEnergyTotals,
+        .unitEnergyTotals = newUnitEnergyTotals,
+        .json = {},
+        .metrics = {}
+    });
 }
 
-void RestService::handleRequest(const std::vector<utility::string_t>& paths, http_request& message)
+RestService::Response RestService::respond(const std::vector<utility::string_t>& paths, const QueryParameters& queryParameters,
+                                           const utility::string_t& ifNoneMatch) const
 {
+    auto const window{[&]() -> const utility::string_t&
+    {
+        auto const it{queryParameters.find(U("window"))};
+        return it != queryParameters.end() ? it->second : DefaultStatisticsWindow;
+    }};
+
+    // Integer query parameter, std::stoll throws std::invalid_argument or std::out_of_range on garbage
+    auto const integer{[&](const utility::string_t& name, int64_t defaultValue)
+    {
+        auto const it{queryParameters.find(name)};
+        return it != queryParameters.end() ? static_cast<int64_t>(std::stoll(it->second)) : defaultValue;
+    }};
+
+    // All answers of this request come from the same cycle, even if a new one is published meanwhile
+    auto const snapshot{snapshots.latest()};
+
+    // Copies the JSON rendered when the snapshot was published, the tag changes with every cycle
+    auto const fromSnapshot{[&](const std::string& json) -> Response
+    {
+        auto etag{U("\"") + etagPrefix + U("-") + std::to_string(snapshot->version) + U("\"")};
+        if(listsEntityTag(ifNoneMatch, etag))
+        {
+            return {status_codes::NotModified, {}, std::move(etag)};
+        }
+        return {status_codes::OK, json, std::move(etag)};
+    }};
+
     try
     {
+        if(paths[0] == "history")
+        {
+            using namespace std::chrono;
+            auto const now_ms{duration_cast<milliseconds>(TelemetryHistory::Clock::now().time_since_epoch()).count()};
+
+            // Milliseconds since the epoch, limited to keep the conversion to the clock's resolution from overflowing
+            auto const timeParameter{[&](const utility::string_t& name, int64_t defaultValue)
+            {
+                return TelemetryHistory::Clock::time_point{milliseconds{std::clamp<int64_t>(integer(name, defaultValue), 0, 2 * now_ms)}};
+            }};
+            auto const points{integer(U("points"), 0)};
+            if(points < 0)
+            {
+                throw std::out_of_range("points must not be negative");
+            }
+
+            auto const since{timeParameter(U("since"), 0)};
+            auto const until{timeParameter(U("until"), now_ms)};
+
+            if(paths.size() > 1 && paths[1] == "rollups")
+            {
+                if(store == nullptr)
+                {
+                    return {status_codes::NotFound, asJson("Rollups need the history store").serialize()};
+                }
+                auto const step{integer(U("step"), DefaultRollupStep.count())};
+                if(step <= 0 || step > std::numeric_limits<int32_t>::max())
+                {
+                    throw std::out_of_range("step must be between 1 and " + std::to_string(std::numeric_limits<int32_t>::max()) + " seconds");
+                }
+                return {status_codes::OK, toJson(store->queryRollups(since, until, seconds{step}))};
+            }
+
+            // Serve from memory as long as it reaches back far enough, the store holds the same samples.
+            // Only an explicit since reads from the store, the default range is the one kept in memory.
+            auto const oldestInMemory{history.oldest()};
+            if(store != nullptr && queryParameters.contains(U("since")) && (!oldestInMemory || since < *oldestInMemory))
+            {
+                return {status_codes::OK, toJson(store->query(since, until, static_cast<size_t>(points)))};
+            }
+            return {status_codes::OK, toJson(history.query(since, until, static_cast<size_t>(points)))};
+        }
+
+        if(paths[0] == "aggregated" && paths.size() > 1 && paths[1] == "stats")
+        {
+            return {status_codes::OK, toJson(statistics.aggregated(window(), TelemetryStatistics::Clock::now()))};
+        }
+
+        if(paths[0] == "all")
+        {
+            auto const fields{queryParameters.find(U("fields"))};
+            if(fields == queryParameters.end())
+            {
+                return fromSnapshot(snapshot->json.all);
+            }
+
+            // Only the requested members, rendered for this request from the same snapshot
+            auto const selection{parseFieldSelection(fields->second)};
+            std::string json;
+            appendJson(json, *snapshot, selection);
+            return fromSnapshot(json);
+        }
+
         if(paths[0] == "aggregated")
         {
-            message.reply(status_codes::OK, asJson(latestAggregatedTelemetry[latestTelemetryIndex]));
-            return;
+            return fromSnapshot(snapshot->json.aggregated);
+        }
+
+        if(paths[0] == "status")
+        {
+            return fromSnapshot(snapshot->json.deviceStatus);
+        }
+
+        if(paths[0] == "energy")
+        {
+            return fromSnapshot(snapshot->json.energyTotals);
         }
         
         const auto& basePath{paths[0]};
         const int machineNumber{std::stoi(basePath)};
 
-        const auto& unitTelemetries{latestUnitTelemetries[latestTelemetryIndex]};
+        const auto& unitTelemetries{snapshot->units};
 
         if(machineNumber < 1 || machineNumber > static_cast<int>(unitTelemetries.size()))
         {
             throw std::out_of_range("Machine number must be between 1 and " + std::to_string(unitTelemetries.size()));
         }
 
-        message.reply(status_codes::OK, asJson(unitTelemetries[machineNumber - 1]));
+        if(paths.size() > 1 && paths[1] == "energy")
+        {
+            return fromSnapshot(snapshot->json.unitEnergyTotals.at(static_cast<size_t>(machineNumber - 1)));
+        }
+
+        if(paths.size() > 1 && paths[1] == "stats")
+        {
+            const auto& serialNumber{unitTelemetries[machineNumber - 1].serialNumber};
+            return {status_codes::OK, toJson(statistics.unit(serialNumber, window(), TelemetryStatistics::Clock::now()))};
+        }
+
+        return fromSnapshot(snapshot->json.units[static_cast<size_t>(machineNumber - 1)]);
     }
     catch (std::invalid_argument const& ex)
     {
-        message.reply(status_codes::BadRequest, asJson(ex.what()));
+        return {status_codes::BadRequest, asJson(ex.what()).serialize()};
     }
     catch (std::out_of_range const& ex)
     {
-        message.reply(status_codes::BadRequest, asJson(ex.what()));
+        return {status_codes::BadRequest, asJson(ex.what()).serialize()};
+    }
+}
+
+RestService::Response RestService::respondMetrics() const
+{
+    // Everything but the error counters, which keep counting while no cycle is published, was rendered with the snapshot
+    auto const snapshot{snapshots.latest()};
+    Response response{status_codes::OK, {}, {}, utility::string_t{MetricsContentType}};
+    response.body.reserve(snapshot->metrics.size() + 512);
+    response.body.append(snapshot->metrics);
+    appendMetrics(response.body, errorCounters);
+    return response;
+}
+
+void RestService::handleRequest(const std::vector<utility::string_t>& paths, http_request& message)
+{
+    if(paths[0] == "stream")
+    {
+        openStream(message);
+        return;
     }
+
+    auto queryParameters{web::uri::split_query(message.request_uri().query())};
+    utility::string_t ifNoneMatch;
+    message.headers().match(header_names::if_none_match, ifNoneMatch);
+
+    if(auto const wait{queryParameters.find(U("wait_for_version"))}; wait != queryParameters.end())
+    {
+        int64_t version;
+        try
+        {
+            version = static_cast<int64_t>(std::stoll(wait->second));
+            if(version < 0)
+            {
+                throw std::out_of_range("wait_for_version must not be negative");
+            }
+        }
+        catch(const std::logic_error& e)
+        {
+            reply(message, {status_codes::BadRequest, asJson(e.what()).serialize()});
+            return;
+        }
+
+        // Answered right away if the version is already there, by the stream thread otherwise
+        if(snapshots.latest()->version < static_cast<uint64_t>(version))
+        {
+            {
+                std::lock_guard lock{streamMutex};
+                if(!stopping && streams.size() + longPolls.size() < config.maxStreams)
+                {
+                    longPolls.push_back({message, paths, std::move(queryParameters), std::move(ifNoneMatch),
+                                         static_cast<uint64_t>(version), std::chrono::steady_clock::now() + config.longPollTimeout});
+                    return;
+                }
+            }
+            reply(message, {status_codes::ServiceUnavailable, asJson("Too many streams").serialize()});
+            return;
+        }
+    }
+
+    reply(message, respond(paths, queryParameters, ifNoneMatch));
 }
 
-}
\ No newline at end of file
+void RestService::openStream(http_request& message)
+{
+    EventStream stream{.buffer = {}, .finished = std::make_shared<std::atomic_bool>(false), .version = 0};
+    bool accepted{false};
+    {
+        std::lock_guard lock{streamMutex};
+        if(!stopping && streams.size() + longPolls.size() < config.maxStreams)
+        {
+            // Starts with the latest snapshot, the stream thread sends the newer ones
+            auto const snapshot{snapshots.latest()};
+            auto const event{telemetryEvent(*snapshot)};
+            stream.buffer.putn_nocopy(reinterpret_cast<const uint8_t*>(event.data()), event.size()).wait();
+            stream.version = snapshot->version;
+            streams.push_back(stream);
+            accepted = true;
+        }
+    }
+    if(!accepted)
+    {
+        reply(message, {status_codes::ServiceUnavailable, asJson("Too many streams").serialize()});
+        return;
+    }
+
+    http_response response{status_codes::OK};
+    response.headers().add(header_names::cache_control, U("no-cache"));
+    response.set_body(stream.buffer.create_istream(), EventStreamContentType);
+    message.reply(response).then([finished = stream.finished](pplx::task<void> task)
+    {
+        try
+        {
+            task.get();
+        }
+        catch(const std::exception&)
+        {
+            // The client went away
+        }
+        *finished = true;
+    });
+}
+
+void RestService::streamLoop()
+{
+    // Appends to a stream, false if it has to be closed
+    auto const write{[](EventStream& stream, const std::string& data)
+    {
+        if(*stream.finished || !stream.buffer.can_write() || stream.buffer.in_avail() > MaxStreamBacklog)
+        {
+            return false;
+        }
+        try
+        {
+            stream.buffer.putn_nocopy(reinterpret_cast<const uint8_t*>(data.data()), data.size()).wait();
+            return true;
+        }
+        catch(const std::exception&)
+        {
+            return false;
+        }
+    }};
+
+    uint64_t version{snapshots.latest()->version};
+    auto lastKeepalive{std::chrono::steady_clock::now()};
+    bool stop{false};
+    while(!stop)
+    {
+        auto const snapshot{snapshots.waitForNewer(version, StreamTick)};
+        version = snapshot->version;
+        auto const now{std::chrono::steady_clock::now()};
+        bool const keepalive{now - lastKeepalive >= KeepaliveInterval};
+        if(keepalive)
+        {
+            lastKeepalive = now;
+        }
+
+        std::vector<LongPoll> due;
+        {
+            std::lock_guard lock{streamMutex};
+            stop = stopping;
+
+            auto const event{telemetryEvent(*snapshot)};
+            std::erase_if(streams, [&](EventStream& stream)
+            {
+                bool open{!stop};
+                if(open && stream.version < snapshot->version)
+                {
+                    open = write(stream, event);
+                    stream.version = snapshot->version;
+                }
+                else if(open && keepalive)
+                {
+                    open = write(stream, ":\n\n");
+                }
+                if(!open)
+                {
+                    stream.buffer.close(std::ios_base::out);
+                }
+                return !open;
+            });
+
+            for(auto it{longPolls.begin()}; it != longPolls.end();)
+            {
+                if(stop || snapshot->version >= it->version || now >= it->deadline)
+                {
+                    due.push_back(std::move(*it));
+                    it = longPolls.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+        }
+
+        // Timed out polls get the latest snapshot as well, the client tells by its version
+        for(auto& poll : due)
+        {
+            reply(poll.message, respond(poll.paths, poll.queryParameters, poll.ifNoneMatch));
+        }
+    }
+}
+
+void RestService::reply(http_request& message, Response response)
+{
+    http_response httpResponse{response.status};
+    if(!response.etag.empty())
+    {
+        // Caches have to revalidate, the tag changes with every poll cycle
+        httpResponse.headers().add(header_names::etag, response.etag);
+        httpResponse.headers().add(header_names::cache_control, U("no-cache"));
+    }
+    if(response.status != status_codes::NotModified)
+    {
+        httpResponse.set_body(std::move(response.body), response.contentType.empty() ? JsonContentType : response.contentType);
+    }
+    message.reply(httpResponse);
+}
+
+}
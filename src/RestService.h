@@ -1,7 +1,16 @@
 #pragma once
 #include <rest/Service.h>
+#include <solax/RollingStatistics.h>
 #include <solax/Telemetry.h>
+#include <solax/TelemetryHistory.h>
+#include <solax/TelemetrySnapshot.h>
+#include <solax/TimeSeriesStore.h>
+#include <cpprest/producerconsumerstream.h>
 #include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 namespace solax
@@ -14,24 +23,85 @@ public:
     {
         std::string address{};
         uint16_t port{};
+        size_t maxStreams{8};                            // Event streams and long polls open at the same time
+        std::chrono::seconds longPollTimeout{30};
     };
 
     static Config loadConfig(const std::string& configPath);
 
-    RestService(const Config& config);
+    using QueryParameters = std::map<utility::string_t, utility::string_t>;
+
+    // Statistics, history, store and error counters are owned by the acquisition loop, which feeds them from every sample.
+    // Without a store the history endpoint serves the samples kept in memory only.
+    RestService(const Config& config, TelemetryStatistics& statistics, const TelemetryHistory& history, const TimeSeriesStore* store,
+                const TelemetryErrorCounters& errorCounters);
     ~RestService();
 
+    // Publishes the telemetry of a poll cycle, requests that are being answered keep the snapshot they started with
     void updateTelemetry(const solax::AggregatedTelemetry& newAggregatedTelemetry,
-                         const std::vector<solax::UnitTelemetry>& newUnitTelemetries);
+                         const std::vector<solax::UnitTelemetry>& newUnitTelemetries,
+                         const solax::DeviceStatus& newDeviceStatus,
+                         const solax::EnergyTotals& newEnergyTotals,
+                         const std::vector<solax::EnergyTotals>& newUnitEnergyTotals);
+
+    struct Response
+    {
+        web::http::status_code status;
+        std::string body;                                // JSON, empty for 304 Not Modified
+        utility::string_t etag{};                        // Only for answers that depend on the latest snapshot alone
+        utility::string_t contentType{};                 // JSON if empty
+    };
+
+    // Renders the answer to a GET request below /telemetry without sending it, handleRequest replies with it.
+    // Answers taken from the latest snapshot are tagged with its version and come back as 304 Not Modified
+    // if ifNoneMatch (the If-None-Match header) lists that tag.
+    Response respond(const std::vector<utility::string_t>& paths, const QueryParameters& queryParameters = {},
+                     const utility::string_t& ifNoneMatch = {}) const;
+
+    // Prometheus text of /metrics, the part taken from the latest snapshot was rendered when it was published
+    Response respondMetrics() const;
 
 private:
+    // Server-sent events of /telemetry/stream, written while the client reads them
+    struct EventStream
+    {
+        concurrency::streams::producer_consumer_buffer<uint8_t> buffer;
+        std::shared_ptr<std::atomic_bool> finished;      // Set once the response ended, e.g. the client went away
+        uint64_t version;                                // Of the last snapshot sent
+    };
+
+    // Request waiting for ?wait_for_version, answered by the stream thread
+    struct LongPoll
+    {
+        web::http::http_request message;
+        std::vector<utility::string_t> paths;
+        QueryParameters queryParameters;
+        utility::string_t ifNoneMatch;
+        uint64_t version;
+        std::chrono::steady_clock::time_point deadline;
+    };
+
     std::unique_ptr<rest::Service> service;
+    std::unique_ptr<web::http::experimental::listener::http_listener> metricsListener;
+    TelemetryStatistics& statistics;
+    const TelemetryHistory& history;
+    const TimeSeriesStore* store;
+    const TelemetryErrorCounters& errorCounters;
+    Config config;
+
+    SnapshotPublisher snapshots;
+    utility::string_t etagPrefix;                        // Tells the versions of different daemon runs apart
 
-    std::atomic_int latestTelemetryIndex{0};
-    std::array<solax::AggregatedTelemetry, 2> latestAggregatedTelemetry;
-    std::array<std::vector<solax::UnitTelemetry>, 2> latestUnitTelemetries;
+    std::mutex streamMutex;                              // Guards streams, longPolls and stopping
+    std::vector<EventStream> streams;
+    std::vector<LongPoll> longPolls;
+    bool stopping{false};
+    std::thread streamThread;
 
     void handleRequest(const std::vector<utility::string_t>& paths, web::http::http_request& message);
+    void openStream(web::http::http_request& message);
+    void streamLoop();
+    static void reply(web::http::http_request& message, Response response);
 };
 
 
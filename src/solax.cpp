@@ -5,10 +5,19 @@
 #include <optional>
 #include <chrono>
 #include <thread>
+#include <csignal>
+#include <algorithm>
 #include "backward.hpp"
 
 #include <solax/SerialAdapter.h>
 #include <solax/Telemetry.h>
+#include <solax/CommandScheduler.h>
+#include <solax/ParallelTopology.h>
+#include <solax/DeviceWatcher.h>
+#include <solax/EnergyIntegrator.h>
+#include <solax/RollingStatistics.h>
+#include <solax/TelemetryHistory.h>
+#include <solax/TimeSeriesStore.h>
 #include "RestService.h"
 #include "Config.h"
 
@@ -29,17 +38,44 @@ std::ostream& operator<<(std::ostream& os, const std::optional<std::string>& opt
     return os;
 }
 
+namespace
+{
+
+volatile std::sig_atomic_t stopRequested{0};
+
+}
+
 int main()
 {
     backward::SignalHandling sh;
 
+    // Leave the acquisition loop on SIGTERM, so state like the energy counters gets persisted on the way out
+    auto const requestStop{[](int) { stopRequested = 1; }};
+    std::signal(SIGTERM, requestStop);
+    std::signal(SIGINT, requestStop);
+
     const auto config{loadConfig("solax.cfg")};
 
+    TelemetryStatistics telemetryStatistics;
+    TelemetryHistory telemetryHistory{config.history};
+    std::optional<TimeSeriesStore> timeSeriesStore;
+
+    try
+    {
+        timeSeriesStore.emplace(config.store);
+    }
+    catch(const std::exception& e)
+    {
+        // Not fatal, the history is kept in memory only
+        std::cerr << "Unable to open history store: "  << e.what() << std::endl;
+    }
+
+    TelemetryErrorCounters errorCounters;
     std::optional<RestService> restService;
 
     try
     {
-        restService.emplace(config.rest);
+        restService.emplace(config.rest, telemetryStatistics, telemetryHistory, timeSeriesStore ? &*timeSeriesStore : nullptr, errorCounters);
     }
     catch(const std::exception& e)
     {
@@ -47,12 +83,122 @@ int main()
         return 1;
     }
 
+    std::optional<EnergyIntegrator> energyIntegrator;
+
+    try
+    {
+        energyIntegrator.emplace(config.energy);
+    }
+    catch(const std::exception& e)
+    {
+        std::cerr << "Unable to restore energy counters: "  << e.what() << std::endl;
+        return 1;
+    }
+
     const bool debugLogEnabled{false};
     std::optional<SerialAdapter> serialAdapter{};
+    DeviceWatcher deviceWatcher{config.serialAdapter.devicePaths};
+    int numFailedCycles{0};
     std::vector<UnitTelemetry> unitTelemetries;
     unitTelemetries.reserve(8);
+    std::vector<EnergyIntegrator::Clock::time_point> sampleTimes;
+    DeviceStatus deviceStatus;
+
+    bool unitTelemetriesValid{false};
+
+    // A bad sample is dropped and counted, only silence on the line fails the cycle and leads to a reconnect
+    auto const handleError{[&](std::string_view inquiry, const TelemetryError& error)
+    {
+        errorCounters.count(error);
+        if(error.kind == TelemetryErrorKind::NoResponse)
+        {
+            throw std::runtime_error("Timeout occured! Did not receive data from the serial device.");
+        }
+        if(error.kind != TelemetryErrorKind::RejectedInquiry)
+        {
+            std::cerr << "Dropped " << inquiry << " sample: " << describe(error) << " ("
+                      << errorCounters[error.kind] << " so far)" << std::endl;
+        }
+    }};
+
+    ParallelTopology topology{[&](uint8_t machineIndex)
+    {
+        auto unitTelemetry{parseResponse(serialAdapter->readRawTelemetry(machineIndex), parseRawTelemetry)};
+
+        // Units are queried one after another, each sample is integrated at the time it was taken
+        sampleTimes.resize(std::max<size_t>(sampleTimes.size(), machineIndex));
+        sampleTimes[machineIndex - 1u] = EnergyIntegrator::Clock::now();
+        return unitTelemetry;
+    }};
+
+    // One QPGSn inquiry and response per unit, the budget follows the units the topology knows about
+    constexpr size_t qpgsLineBytes{145};
+    CommandScheduler scheduler{config.scheduler};
+    auto const updateQpgsLineBytes{[&]()
+    {
+        scheduler.setLineBytes("QPGSn", std::max<size_t>(topology.numUnits(), 1) * qpgsLineBytes);
+    }};
+    scheduler.add({
+        .name = "QPGSn",
+        .period = 0ms,
+        .priority = 100,
+        .lineBytes = qpgsLineBytes,
+        .execute = [&]()
+        {
+            auto const result{topology.poll(unitTelemetries)};
+            updateQpgsLineBytes();
+            unitTelemetriesValid = result.has_value();
+            if(!result)
+            {
+                handleError("QPGSn", result.error());
+            }
+        }
+    });
+    scheduler.add({
+        .name = "QPGSn topology",
+        .period = config.topologyCheckInterval,
+        .priority = 0,
+        .lineBytes = qpgsLineBytes,
+        .execute = [&]()
+        {
+            auto const result{topology.checkForNewUnits()};
+            updateQpgsLineBytes();
+            if(!result)
+            {
+                handleError("QPGSn topology", result.error());
+            }
+        }
+    });
+
+    // Single unit status of the unit the adapter is connected to. Models without PV2 reject QPIGS2,
+    // which leaves its status at the defaults instead of failing the cycle.
+    auto const addStatusInquiry{[&](std::string inquiry, int32_t priority, size_t lineBytes, auto parse, auto& status)
+    {
+        scheduler.add({
+            .name = inquiry,
+            .period = config.statusInterval,
+            .priority = priority,
+            .lineBytes = lineBytes,
+            .execute = [&serialAdapter, &handleError, &status, inquiry, parse]()
+            {
+                auto result{parseResponse(serialAdapter->query(inquiry), parse)};
+                if(result)
+                {
+                    status = std::move(*result);
+                }
+                else
+                {
+                    handleError(inquiry, result.error());
+                }
+            }
+        });
+    }};
+    addStatusInquiry("QPIWS", 60, 8 + 40, &parseWarningStatus, deviceStatus.warnings);
+    addStatusInquiry("QMOD", 50, 7 + 5, &parseDeviceMode, deviceStatus.mode);
+    addStatusInquiry("QPIGS", 40, 8 + 110, &parseGeneralStatus, deviceStatus.general);
+    addStatusInquiry("QPIGS2", 30, 9 + 22, &parsePv2Status, deviceStatus.pv2);
     
-    while(true)
+    while(!stopRequested)
     {
         try
         {
@@ -60,12 +206,14 @@ int main()
             {
                 std::cout << "Connecting to Solax serial adapter" << std::endl;
                 serialAdapter.emplace(config.serialAdapter);
+                topology.invalidate();
             }
         }
         catch(const std::exception& e)
         {
             std::cerr << e.what() << std::endl;
-            std::this_thread::sleep_for(10s);
+            // Retry right away when a device (re)appears, the timeout only guards against missed events
+            deviceWatcher.waitForDevice(10s);
             continue;
         }
 
@@ -73,24 +221,29 @@ int main()
 
         try
         {
-            unitTelemetries.clear();
-            uint8_t machineIndex = 1;
-            while(machineIndex > 0)
-            {
-                auto const rawTelemetry{serialAdapter->readRawTelemetry(machineIndex)};
-                auto const unitTelemetry{parseRawTelemetry(rawTelemetry)};
-                
-                if(unitTelemetry.parallelNum == 0)
-                {
-                    // No more machines available
-                    break;
-                }
+            scheduler.runCycle();
+            numFailedCycles = 0;
 
-                machineIndex++;
-                unitTelemetries.push_back(unitTelemetry);
+            if(!unitTelemetriesValid)
+            {
+                // Keep publishing the last complete sample
+                continue;
             }
 
             auto const aggregatedTelemetry{aggregateTelemetry(unitTelemetries)};
+            telemetryStatistics.add(TelemetryStatistics::Clock::now(), aggregatedTelemetry);
+            auto const historySample{makeHistorySample(TelemetryHistory::Clock::now(), aggregatedTelemetry, unitTelemetries)};
+            telemetryHistory.add(historySample);
+            if(timeSeriesStore)
+            {
+                timeSeriesStore->add(historySample);
+            }
+
+            for(size_t i = 0; i < unitTelemetries.size(); ++i)
+            {
+                energyIntegrator->add(sampleTimes[i], unitTelemetries[i]);
+                telemetryStatistics.add(sampleTimes[i], unitTelemetries[i]);
+            }
 
             if(debugLogEnabled)
             {
@@ -101,13 +254,30 @@ int main()
                           << std::endl;
             }
 
-            restService->updateTelemetry(aggregatedTelemetry, unitTelemetries);
-
+            restService->updateTelemetry(aggregatedTelemetry, unitTelemetries, deviceStatus,
+                                         energyIntegrator->total(), energyIntegrator->unitTotals(unitTelemetries));
         }
         catch(const std::exception& e)
         {
             std::cerr << e.what() << std::endl;
-            serialAdapter.reset();
+
+            // Reopening the last working device is much cheaper than a full probe, but give up on it
+            // if it did not help, the device might have been replaced
+            numFailedCycles++;
+            try
+            {
+                if(numFailedCycles > 2)
+                {
+                    throw std::runtime_error("Reopening " + serialAdapter->devicePath() + " did not help");
+                }
+                serialAdapter->reopen();
+            }
+            catch(const std::exception& reopenError)
+            {
+                std::cerr << reopenError.what() << std::endl;
+                serialAdapter.reset();
+                numFailedCycles = 0;
+            }
         }
     }
 }
@@ -0,0 +1,144 @@
+#include <solax/CommandScheduler.h>
+#include <algorithm>
+#include <iostream>
+
+namespace solax
+{
+
+CommandScheduler::CommandScheduler(const Config& configParam, TimeSource timeSource)
+: config{configParam}
+, now{std::move(timeSource)}
+{
+}
+
+namespace
+{
+
+// Start bit, 8 data bits and stop bit per byte
+std::chrono::microseconds lineTime(size_t lineBytes, uint32_t baudRate)
+{
+    return std::chrono::microseconds{lineBytes * 10'000'000 / std::max(baudRate, 1u)};
+}
+
+}
+
+void CommandScheduler::add(Command command)
+{
+    // Derived from the line time until the command has been measured for real
+    auto const estimatedDuration{lineTime(command.lineBytes, config.baudRate)};
+
+    Entry entry{
+        .command = std::move(command),
+        .estimatedDuration = estimatedDuration,
+        .lastExecution = {},
+        .executions = 0,
+        .deferrals = 0
+    };
+
+    auto const position{std::upper_bound(entries.begin(), entries.end(), entry.command.priority,
+        [](int32_t priority, const Entry& other) { return priority > other.command.priority; })};
+    entries.insert(position, std::move(entry));
+}
+
+void CommandScheduler::setLineBytes(std::string_view name, size_t lineBytes)
+{
+    auto const entry{std::ranges::find(entries, name, [](const Entry& entry) -> std::string_view { return entry.command.name; })};
+    if(entry == entries.end() || entry->command.lineBytes == lineBytes)
+    {
+        return;
+    }
+
+    if(entry->executions == 0 || entry->command.lineBytes == 0)
+    {
+        entry->estimatedDuration = lineTime(lineBytes, config.baudRate);
+    }
+    else
+    {
+        entry->estimatedDuration = entry->estimatedDuration * lineBytes / entry->command.lineBytes;
+    }
+    entry->command.lineBytes = lineBytes;
+}
+
+void CommandScheduler::runCycle()
+{
+    auto const cycleStart{now()};
+
+    for(auto& entry : entries)
+    {
+        if(entry.command.period.count() == 0)
+        {
+            execute(entry);
+        }
+    }
+
+    for(auto& entry : entries)
+    {
+        if(entry.command.period.count() == 0)
+        {
+            continue;
+        }
+
+        auto const currentTime{now()};
+        auto const sinceLastExecution{currentTime - entry.lastExecution};
+        if(entry.executions > 0 && sinceLastExecution < entry.command.period)
+        {
+            continue;
+        }
+
+        // A command that already missed a whole period gets served even if it exceeds the budget, so it cannot starve
+        bool const fitsIntoCycle{currentTime - cycleStart + entry.estimatedDuration <= config.cycleInterval};
+        bool const starving{entry.executions == 0 ? entry.deferrals > 0 : sinceLastExecution >= 2 * entry.command.period};
+        if(fitsIntoCycle || starving)
+        {
+            execute(entry);
+        }
+        else
+        {
+            entry.deferrals++;
+        }
+    }
+
+    auto const utilization{lineUtilization()};
+    if(utilization > 1.0 && !overloadReported)
+    {
+        std::cerr << "Command schedule does not fit into the serial line's bandwidth (" 
+                  << static_cast<int>(utilization * 100.0) << "% of line time needed), periodic commands will lag behind" << std::endl;
+    }
+    overloadReported = utilization > 1.0;
+}
+
+double CommandScheduler::lineUtilization() const
+{
+    double utilization{0.0};
+    for(const auto& entry : entries)
+    {
+        auto const period{entry.command.period.count() == 0 ? config.cycleInterval : entry.command.period};
+        utilization += std::chrono::duration<double>(entry.estimatedDuration).count() / std::chrono::duration<double>(period).count();
+    }
+    return utilization;
+}
+
+std::vector<CommandScheduler::Statistics> CommandScheduler::statistics() const
+{
+    std::vector<Statistics> result;
+    result.reserve(entries.size());
+    for(const auto& entry : entries)
+    {
+        result.push_back({entry.command.name, entry.executions, entry.deferrals, entry.estimatedDuration});
+    }
+    return result;
+}
+
+void CommandScheduler::execute(Entry& entry)
+{
+    auto const start{now()};
+    entry.command.execute();
+    auto const duration{now() - start};
+
+    // Exponential moving average smooths out single slow responses
+    entry.estimatedDuration = entry.executions == 0 ? duration : (entry.estimatedDuration * 7 + duration) / 8;
+    entry.lastExecution = start;
+    entry.executions++;
+}
+
+}
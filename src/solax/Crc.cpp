@@ -0,0 +1,88 @@
+#include <solax/Crc.h>
+#include <array>
+
+namespace solax
+{
+
+namespace
+{
+
+uint8_t escapeDelimiter(uint8_t crcByte)
+{
+    if(crcByte == '(' || crcByte == '\r' || crcByte == '\n')
+    {
+        return static_cast<uint8_t>(crcByte + 1);
+    }
+    return crcByte;
+}
+
+}
+
+uint16_t crc16(std::string_view data)
+{
+    uint16_t crc{0};
+    for(const auto c : data)
+    {
+        crc ^= static_cast<uint16_t>(static_cast<uint8_t>(c) << 8);
+        for(int bit = 0; bit < 8; ++bit)
+        {
+            crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x1021) : static_cast<uint16_t>(crc << 1);
+        }
+    }
+
+    auto const high{escapeDelimiter(static_cast<uint8_t>(crc >> 8))};
+    auto const low{escapeDelimiter(static_cast<uint8_t>(crc & 0xff))};
+    return static_cast<uint16_t>((high << 8) | low);
+}
+
+std::string frameCommand(std::string_view command)
+{
+    auto const crc{crc16(command)};
+
+    std::string frame;
+    frame.reserve(command.size() + 3);
+    frame.append(command);
+    frame.push_back(static_cast<char>(crc >> 8));
+    frame.push_back(static_cast<char>(crc & 0xff));
+    frame.push_back('\r');
+    return frame;
+}
+
+bool hasValidCrc(std::string_view frame)
+{
+    if(frame.size() < 3)
+    {
+        return false;
+    }
+
+    auto const crc{crc16(frame.substr(0, frame.size() - 2))};
+    return static_cast<uint8_t>(frame[frame.size() - 2]) == (crc >> 8)
+        && static_cast<uint8_t>(frame[frame.size() - 1]) == (crc & 0xff);
+}
+
+uint32_t crc32(uint32_t crc, const std::byte* data, size_t size)
+{
+    static const auto table{[]()
+    {
+        std::array<uint32_t, 256> result;
+        for(uint32_t i = 0; i < 256; ++i)
+        {
+            uint32_t value{i};
+            for(int bit = 0; bit < 8; ++bit)
+            {
+                value = (value & 1) ? (value >> 1) ^ 0xedb88320u : value >> 1;
+            }
+            result[i] = value;
+        }
+        return result;
+    }()};
+
+    crc = ~crc;
+    for(size_t i = 0; i < size; ++i)
+    {
+        crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+}
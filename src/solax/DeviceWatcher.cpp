@@ -0,0 +1,135 @@
+#include <solax/DeviceWatcher.h>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <poll.h>
+#include <sys/inotify.h>
+
+namespace solax
+{
+
+DeviceWatcher::DeviceWatcher(std::vector<std::string> devicePathsParam)
+: devicePaths{std::move(devicePathsParam)}
+, inotifyFd{::inotify_init1(IN_NONBLOCK | IN_CLOEXEC)}
+{
+    if(!inotifyFd.valid())
+    {
+        // Not fatal, waitForDevice() degrades to a plain timeout
+        std::cerr << "Unable to watch for serial devices: " << std::strerror(errno) << std::endl;
+    }
+
+    // Watching from the start catches a device that appears between a failed probe and the next wait
+    armWatches();
+}
+
+bool DeviceWatcher::waitForDevice(std::chrono::milliseconds timeout)
+{
+    auto const deadline{std::chrono::steady_clock::now() + timeout};
+
+    armWatches();
+
+    while(true)
+    {
+        auto const remaining{std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now())};
+        if(remaining.count() <= 0)
+        {
+            return false;
+        }
+
+        pollfd pfd{.fd = inotifyFd.get(), .events = POLLIN, .revents = 0};
+        auto const result{::poll(&pfd, inotifyFd.valid() ? 1 : 0, static_cast<int>(remaining.count()))};
+        if(result < 0 && errno != EINTR)
+        {
+            return false;
+        }
+        if(result <= 0)
+        {
+            continue;
+        }
+
+        alignas(inotify_event) std::array<char, 4096> buffer;
+        bool relevant{false};
+        while(true)
+        {
+            auto const numBytesRead{::read(inotifyFd.get(), buffer.data(), buffer.size())};
+            if(numBytesRead <= 0)
+            {
+                break;
+            }
+
+            for(ssize_t offset = 0; offset < numBytesRead;)
+            {
+                auto const* event{reinterpret_cast<const inotify_event*>(buffer.data() + offset)};
+                offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+
+                auto const directory{watchedDirectories.find(event->wd)};
+                if(directory == watchedDirectories.end())
+                {
+                    continue;
+                }
+                if(event->mask & IN_IGNORED)
+                {
+                    // The directory is gone, it is watched again once it reappears
+                    watchedDirectories.erase(directory);
+                }
+                else if(event->len > 0)
+                {
+                    relevant = relevant || isRelevant(directory->second + "/" + event->name);
+                }
+            }
+        }
+
+        if(relevant)
+        {
+            return true;
+        }
+
+        // A directory on the way to a device path might have appeared meanwhile
+        armWatches();
+    }
+}
+
+void DeviceWatcher::armWatches()
+{
+    if(!inotifyFd.valid())
+    {
+        return;
+    }
+
+    // Watch the parent directory of every device path and its parent, which catches the
+    // creation of directories like /dev/serial/by-id that only exist while a device is plugged in
+    for(const auto& devicePath : devicePaths)
+    {
+        auto const parent{std::filesystem::path{devicePath}.parent_path()};
+        for(const auto& directory : {parent, parent.parent_path()})
+        {
+            if(directory.empty() || !std::filesystem::is_directory(directory))
+            {
+                continue;
+            }
+
+            auto const wd{::inotify_add_watch(inotifyFd.get(), directory.c_str(), IN_CREATE | IN_ATTRIB | IN_MOVED_TO)};
+            if(wd >= 0)
+            {
+                watchedDirectories[wd] = directory.string();
+            }
+        }
+    }
+}
+
+bool DeviceWatcher::isRelevant(const std::string& changedPath) const
+{
+    for(const auto& devicePath : devicePaths)
+    {
+        // Either the device itself or a directory leading to it
+        if(devicePath == changedPath || devicePath.starts_with(changedPath + "/"))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+}
@@ -0,0 +1,220 @@
+#include <solax/EnergyIntegrator.h>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace solax
+{
+
+namespace
+{
+
+// Integrates a power that changes linearly from p0 to p1 over the given hours. The positive and the
+// negative share are accumulated separately, splitting the trapezoid at the zero crossing.
+void integrate(float p0_W, float p1_W, double hours, double& positive_kWh, double& negative_kWh)
+{
+    auto const p0{static_cast<double>(p0_W)};
+    auto const p1{static_cast<double>(p1_W)};
+
+    if((p0 >= 0.0) == (p1 >= 0.0))
+    {
+        auto const energy_kWh{(p0 + p1) / 2.0 * hours / 1000.0};
+        (energy_kWh >= 0.0 ? positive_kWh : negative_kWh) += std::abs(energy_kWh);
+        return;
+    }
+
+    auto const crossing{p0 / (p0 - p1)};
+    auto const before_kWh{p0 / 2.0 * crossing * hours / 1000.0};
+    auto const after_kWh{p1 / 2.0 * (1.0 - crossing) * hours / 1000.0};
+    (before_kWh >= 0.0 ? positive_kWh : negative_kWh) += std::abs(before_kWh);
+    (after_kWh >= 0.0 ? positive_kWh : negative_kWh) += std::abs(after_kWh);
+}
+
+std::runtime_error stateError(const std::string& what, const std::string& path)
+{
+    return std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+}
+
+// Makes a rename in the directory of the file survive a power cut
+void syncDirectoryOf(const std::string& path)
+{
+    auto directory{std::filesystem::path{path}.parent_path()};
+    if(directory.empty())
+    {
+        directory = ".";
+    }
+    auto const fd{::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)};
+    if(fd < 0)
+    {
+        throw stateError("Cannot open directory of", path);
+    }
+    bool const synced{::fsync(fd) == 0};
+    ::close(fd);
+    if(!synced)
+    {
+        throw stateError("Cannot sync directory of", path);
+    }
+}
+
+}
+
+EnergyIntegrator::EnergyIntegrator(const Config& configParam)
+: config{configParam}
+, lastPersistTime{Clock::now()}
+{
+    load();
+}
+
+EnergyIntegrator::~EnergyIntegrator()
+{
+    try
+    {
+        persist();
+    }
+    catch(const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+    }
+}
+
+void EnergyIntegrator::add(Clock::time_point sampleTime, const UnitTelemetry& unitTelemetry)
+{
+    auto unit{units.find(unitTelemetry.serialNumber)};
+    if(unit == units.end())
+    {
+        unit = units.emplace(unitTelemetry.serialNumber, Unit{}).first;
+    }
+
+    auto& state{unit->second};
+    auto const power{unitPower(unitTelemetry)};
+    auto const gap{sampleTime - state.lastSampleTime};
+
+    if(state.hasLastSample && gap > Clock::duration::zero() && gap <= config.maxSampleGap)
+    {
+        auto const hours{std::chrono::duration<double, std::ratio<3600>>{gap}.count()};
+        double unused_kWh{0.0};
+        integrate(state.lastPower.solarPower_W, power.solarPower_W, hours, state.totals.solar_kWh, unused_kWh);
+        integrate(state.lastPower.acPower_W, power.acPower_W, hours, state.totals.load_kWh, unused_kWh);
+        integrate(state.lastPower.batteryPower_W, power.batteryPower_W, hours,
+                  state.totals.batteryCharge_kWh, state.totals.batteryDischarge_kWh);
+    }
+
+    state.lastSampleTime = sampleTime;
+    state.lastPower = power;
+    state.hasLastSample = true;
+
+    if(sampleTime - lastPersistTime >= config.persistInterval)
+    {
+        lastPersistTime = sampleTime;
+        try
+        {
+            persist();
+        }
+        catch(const std::exception& e)
+        {
+            // The counters stay in memory, the next interval tries again
+            std::cerr << e.what() << std::endl;
+        }
+    }
+}
+
+EnergyTotals EnergyIntegrator::total() const
+{
+    EnergyTotals result;
+    for(const auto& [serialNumber, unit] : units)
+    {
+        result.solar_kWh += unit.totals.solar_kWh;
+        result.load_kWh += unit.totals.load_kWh;
+        result.batteryCharge_kWh += unit.totals.batteryCharge_kWh;
+        result.batteryDischarge_kWh += unit.totals.batteryDischarge_kWh;
+    }
+    return result;
+}
+
+std::vector<EnergyTotals> EnergyIntegrator::unitTotals(const std::vector<UnitTelemetry>& unitTelemetries) const
+{
+    std::vector<EnergyTotals> result;
+    result.reserve(unitTelemetries.size());
+    for(const auto& unitTelemetry : unitTelemetries)
+    {
+        auto const unit{units.find(unitTelemetry.serialNumber)};
+        result.push_back(unit != units.end() ? unit->second.totals : EnergyTotals{});
+    }
+    return result;
+}
+
+void EnergyIntegrator::persist()
+{
+    // Write a temporary file and rename it, so a power cut leaves either the old or the new state behind
+    auto const tempPath{config.statePath + ".tmp"};
+    auto* file{std::fopen(tempPath.c_str(), "w")};
+    if(file == nullptr)
+    {
+        throw stateError("Cannot write energy counters to", tempPath);
+    }
+
+    for(const auto& [serialNumber, unit] : units)
+    {
+        // The counters of a unit are only found again by a serial number that is a single word
+        if(serialNumber.empty() || serialNumber.find_first_of(" \t\n") != std::string::npos)
+        {
+            continue;
+        }
+        std::fprintf(file, "%s %.9f %.9f %.9f %.9f\n", serialNumber.c_str(),
+            unit.totals.solar_kWh, unit.totals.load_kWh, unit.totals.batteryCharge_kWh, unit.totals.batteryDischarge_kWh);
+    }
+
+    bool const written{std::fflush(file) == 0 && ::fsync(::fileno(file)) == 0};
+    if(std::fclose(file) != 0 || !written)
+    {
+        throw stateError("Cannot write energy counters to", tempPath);
+    }
+    if(std::rename(tempPath.c_str(), config.statePath.c_str()) != 0)
+    {
+        throw stateError("Cannot replace energy counters", config.statePath);
+    }
+    syncDirectoryOf(config.statePath);
+}
+
+void EnergyIntegrator::load()
+{
+    auto* file{std::fopen(config.statePath.c_str(), "r")};
+    if(file == nullptr)
+    {
+        if(errno == ENOENT)
+        {
+            // First run
+            return;
+        }
+        throw stateError("Cannot read energy counters from", config.statePath);
+    }
+
+    // A corrupted line only loses the counters of its unit, they start over from zero
+    char line[256];
+    size_t lineNumber{0};
+    while(std::fgets(line, sizeof(line), file) != nullptr)
+    {
+        lineNumber++;
+        char serialNumber[64];
+        char trailing;
+        EnergyTotals totals;
+        if(std::sscanf(line, "%63s %lf %lf %lf %lf %c", serialNumber,
+            &totals.solar_kWh, &totals.load_kWh, &totals.batteryCharge_kWh, &totals.batteryDischarge_kWh, &trailing) != 5)
+        {
+            std::cerr << "Ignoring corrupted energy counters in line " << lineNumber << " of " << config.statePath << std::endl;
+            continue;
+        }
+        units[serialNumber].totals = totals;
+    }
+    std::fclose(file);
+
+    std::cout << "Loaded energy counters of " << units.size() << " unit(s)" << std::endl;
+}
+
+}
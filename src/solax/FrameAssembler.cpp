@@ -0,0 +1,92 @@
+#include <solax/FrameAssembler.h>
+#include <cstring>
+
+namespace solax
+{
+
+namespace
+{
+
+char const messageStartToken{'('};
+char const messageEndToken{'\r'};
+
+}
+
+std::span<char> FrameAssembler::writableArea()
+{
+    compact();
+
+    if(size == Capacity)
+    {
+        // No terminator within a whole buffer, this cannot be a frame anymore
+        discardedBytes += size;
+        reset();
+    }
+
+    return std::span<char>{buffer.data() + size, Capacity - size};
+}
+
+void FrameAssembler::commit(size_t numBytes)
+{
+    size += numBytes;
+}
+
+std::optional<std::string_view> FrameAssembler::nextFrame()
+{
+    for(; scanned < size; ++scanned)
+    {
+        auto const c{buffer[scanned]};
+        if(c == messageStartToken)
+        {
+            // Drops garbage before the frame as well as a previous frame that lost its terminator
+            discardedBytes += scanned - consumed;
+            frameStart = scanned;
+            consumed = scanned;
+        }
+        else if(c == messageEndToken && frameStart)
+        {
+            std::string_view const frame{buffer.data() + *frameStart, scanned - *frameStart};
+            frameStart.reset();
+            ++scanned;
+            consumed = scanned;
+            return frame;
+        }
+    }
+
+    if(!frameStart)
+    {
+        // Garbage between frames
+        discardedBytes += size - consumed;
+        consumed = size;
+    }
+
+    return std::nullopt;
+}
+
+void FrameAssembler::reset()
+{
+    consumed = 0;
+    scanned = 0;
+    size = 0;
+    frameStart.reset();
+}
+
+void FrameAssembler::compact()
+{
+    if(consumed == 0)
+    {
+        return;
+    }
+
+    // Usually nothing follows a frame, so this rarely moves more than a partial frame
+    std::memmove(buffer.data(), buffer.data() + consumed, size - consumed);
+    size -= consumed;
+    scanned -= consumed;
+    if(frameStart)
+    {
+        *frameStart -= consumed;
+    }
+    consumed = 0;
+}
+
+}
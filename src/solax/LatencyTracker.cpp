@@ -0,0 +1,47 @@
+#include <solax/LatencyTracker.h>
+#include <algorithm>
+#include <cmath>
+
+namespace solax
+{
+
+LatencyTracker::LatencyTracker(const Config& configParam)
+: config{configParam}
+{
+}
+
+void LatencyTracker::add(std::chrono::microseconds latency)
+{
+    samples[next] = latency;
+    next = (next + 1) % Capacity;
+    count = std::min(count + 1, Capacity);
+}
+
+std::optional<std::chrono::microseconds> LatencyTracker::percentile(double p) const
+{
+    if(count == 0)
+    {
+        return std::nullopt;
+    }
+
+    // Works on a copy on the stack, the ring of samples keeps its order
+    std::array<std::chrono::microseconds, Capacity> sorted{samples};
+    auto const rank{static_cast<size_t>(std::ceil(p * static_cast<double>(count))) };
+    auto const nth{sorted.begin() + static_cast<std::ptrdiff_t>(std::clamp<size_t>(rank, 1, count) - 1)};
+    std::nth_element(sorted.begin(), nth, sorted.begin() + static_cast<std::ptrdiff_t>(count));
+    return *nth;
+}
+
+std::chrono::milliseconds LatencyTracker::timeout() const
+{
+    if(count < config.minSamples)
+    {
+        return config.ceiling;
+    }
+
+    auto const p99{std::chrono::duration<double>(*percentile(0.99))};
+    auto const timeout{std::chrono::ceil<std::chrono::milliseconds>(p99 * config.safetyFactor)};
+    return std::clamp(timeout, config.floor, config.ceiling);
+}
+
+}
@@ -8,11 +8,13 @@
 namespace solax
 {
 
-std::optional<int32_t> to_int(std::string_view sv)
+// Parses sv as a number, locale independent and without allocations. Trailing characters make it fail.
+template<typename T>
+inline std::optional<T> to_number(std::string_view sv)
 {
-    int32_t result{};
+    T result{};
     auto [ptr, ec]{std::from_chars(sv.data(), sv.data() + sv.size(), result)};
-    if (ec == std::errc())
+    if (ec == std::errc() && ptr == sv.data() + sv.size())
     {
         return result;
     }
@@ -20,8 +22,18 @@ std::optional<int32_t> to_int(std::string_view sv)
     return std::nullopt;
 }
 
+inline std::optional<int32_t> to_int(std::string_view sv)
+{
+    return to_number<int32_t>(sv);
+}
+
+inline std::optional<float> to_float(std::string_view sv)
+{
+    return to_number<float>(sv);
+}
+
 
-std::istream& operator>> (std::istream& is, std::optional<int32_t>& optInt)
+inline std::istream& operator>> (std::istream& is, std::optional<int32_t>& optInt)
 {
     std::string str;
     is >> str; 
@@ -29,7 +41,7 @@ std::istream& operator>> (std::istream& is, std::optional<int32_t>& optInt)
     return is;
 }
 
-std::istream& operator>> (std::istream& is, std::optional<std::string>& optStr)
+inline std::istream& operator>> (std::istream& is, std::optional<std::string>& optStr)
 {
     std::string str;
     is >> str; 
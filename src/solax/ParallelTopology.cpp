@@ -0,0 +1,97 @@
+#include <solax/ParallelTopology.h>
+#include <iostream>
+#include <limits>
+
+namespace solax
+{
+
+ParallelTopology::ParallelTopology(Query queryParam)
+: query{std::move(queryParam)}
+{
+}
+
+TelemetryResult<void> ParallelTopology::poll(std::vector<UnitTelemetry>& unitTelemetries)
+{
+    unitTelemetries.clear();
+
+    if(!discovered)
+    {
+        return discover(unitTelemetries);
+    }
+
+    for(size_t i = 0; i < serialNumbers.size(); ++i)
+    {
+        auto unitTelemetry{query(static_cast<uint8_t>(i + 1))};
+        if(!unitTelemetry)
+        {
+            // A bad sample says nothing about the topology, keep it
+            return std::unexpected(unitTelemetry.error());
+        }
+        if(unitTelemetry->parallelNum == 0 || unitTelemetry->serialNumber != serialNumbers[i])
+        {
+            std::cout << "Parallel unit " << i + 1 << " changed, rediscovering units" << std::endl;
+            return discover(unitTelemetries);
+        }
+        unitTelemetries.push_back(std::move(*unitTelemetry));
+    }
+    return {};
+}
+
+TelemetryResult<void> ParallelTopology::checkForNewUnits()
+{
+    if(!discovered)
+    {
+        return {};
+    }
+
+    auto const unitTelemetry{query(static_cast<uint8_t>(serialNumbers.size() + 1))};
+    if(!unitTelemetry)
+    {
+        return std::unexpected(unitTelemetry.error());
+    }
+    if(unitTelemetry->parallelNum != 0)
+    {
+        std::cout << "Parallel unit " << serialNumbers.size() + 1 << " appeared, rediscovering units" << std::endl;
+        discovered = false;
+    }
+    return {};
+}
+
+TelemetryResult<void> ParallelTopology::discover(std::vector<UnitTelemetry>& unitTelemetries)
+{
+    unitTelemetries.clear();
+    serialNumbers.clear();
+
+    uint8_t machineIndex = 1;
+    while(machineIndex < std::numeric_limits<uint8_t>::max())
+    {
+        auto unitTelemetry{query(machineIndex)};
+        if(!unitTelemetry)
+        {
+            // Sweep again next time instead of taking a partial topology for granted
+            unitTelemetries.clear();
+            serialNumbers.clear();
+            discovered = false;
+            return std::unexpected(unitTelemetry.error());
+        }
+        if(unitTelemetry->parallelNum == 0)
+        {
+            // No more machines available
+            break;
+        }
+
+        machineIndex++;
+        serialNumbers.push_back(unitTelemetry->serialNumber);
+        unitTelemetries.push_back(std::move(*unitTelemetry));
+    }
+
+    // Without any unit answering there is nothing to remember, so the next poll sweeps again
+    discovered = !serialNumbers.empty();
+    if(discovered)
+    {
+        std::cout << "Discovered " << serialNumbers.size() << " parallel unit(s)" << std::endl;
+    }
+    return {};
+}
+
+}
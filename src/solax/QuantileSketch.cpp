@@ -0,0 +1,86 @@
+#include <solax/QuantileSketch.h>
+#include <algorithm>
+#include <cmath>
+
+namespace solax
+{
+
+namespace
+{
+
+// Every value in a bucket is within RelativeAccuracy of the bucket's representative value
+const double gamma{(1.0 + QuantileSketch::RelativeAccuracy) / (1.0 - QuantileSketch::RelativeAccuracy)};
+const double logGamma{std::log(gamma)};
+
+}
+
+size_t QuantileSketch::bucketOf(float magnitude)
+{
+    auto const index{static_cast<int32_t>(std::ceil(std::log(static_cast<double>(magnitude)) / logGamma))};
+    return static_cast<size_t>(std::clamp(index, MinIndex, MaxIndex) - MinIndex);
+}
+
+float QuantileSketch::valueOf(size_t bucket)
+{
+    auto const index{static_cast<int32_t>(bucket) + MinIndex};
+    return static_cast<float>(2.0 * std::pow(gamma, index) / (gamma + 1.0));
+}
+
+void QuantileSketch::add(float value)
+{
+    update(value, 1);
+    count++;
+}
+
+void QuantileSketch::remove(float value)
+{
+    update(value, -1);
+    count--;
+}
+
+void QuantileSketch::update(float value, int32_t delta)
+{
+    auto const magnitude{std::abs(value)};
+    auto& counter{magnitude < MinMagnitude ? zeros : (value > 0.0f ? positive : negative)[bucketOf(magnitude)]};
+    counter = static_cast<uint32_t>(static_cast<int64_t>(counter) + delta);
+}
+
+std::optional<float> QuantileSketch::quantile(double q) const
+{
+    if(count == 0)
+    {
+        return std::nullopt;
+    }
+
+    // Walk the buckets in ascending value order: negative values from large to small magnitude, zero, positive values
+    auto const rank{static_cast<size_t>(std::clamp(q, 0.0, 1.0) * static_cast<double>(count - 1))};
+    size_t seen{0};
+
+    for(size_t bucket = NumBuckets; bucket-- > 0;)
+    {
+        seen += negative[bucket];
+        if(seen > rank)
+        {
+            return -valueOf(bucket);
+        }
+    }
+
+    seen += zeros;
+    if(seen > rank)
+    {
+        return 0.0f;
+    }
+
+    for(size_t bucket = 0; bucket < NumBuckets; ++bucket)
+    {
+        seen += positive[bucket];
+        if(seen > rank)
+        {
+            return valueOf(bucket);
+        }
+    }
+
+    return valueOf(NumBuckets - 1);
+}
+
+}
@@ -0,0 +1,202 @@
+#include <solax/RollingStatistics.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace solax
+{
+
+namespace
+{
+
+template<typename Func>
+void forEachChannel(const AggregatedTelemetry& sample, Func&& func)
+{
+    size_t index{0};
+    forEachField(aggregatedTelemetryFields, [&](const auto& field)
+    {
+        func(index++, sample.*field.member);
+    });
+}
+
+}
+
+RollingStatistics::RollingStatistics(Clock::duration windowParam)
+: window{windowParam}
+{
+}
+
+void RollingStatistics::add(Clock::time_point sampleTime, const AggregatedTelemetry& sample)
+{
+    expire(sampleTime);
+    samples.emplace_back(sampleTime, sample);
+
+    forEachChannel(sample, [&](size_t index, float value)
+    {
+        auto& channel{channels[index]};
+
+        // A new sample outlives every older one, older samples that are not smaller (larger) can never
+        // become the minimum (maximum) of the window again
+        while(!channel.minima.empty() && channel.minima.back().value >= value)
+        {
+            channel.minima.pop_back();
+        }
+        channel.minima.push_back({sampleTime, value});
+
+        while(!channel.maxima.empty() && channel.maxima.back().value <= value)
+        {
+            channel.maxima.pop_back();
+        }
+        channel.maxima.push_back({sampleTime, value});
+
+        channel.sum += value;
+        channel.sumOfSquares += static_cast<double>(value) * value;
+        channel.sketch.add(value);
+    });
+}
+
+void RollingStatistics::expire(Clock::time_point now)
+{
+    auto const oldest{now - window};
+    while(!samples.empty() && samples.front().first <= oldest)
+    {
+        auto const& [sampleTime, sample]{samples.front()};
+        forEachChannel(sample, [&](size_t index, float value)
+        {
+            auto& channel{channels[index]};
+            if(!channel.minima.empty() && channel.minima.front().time <= sampleTime)
+            {
+                channel.minima.pop_front();
+            }
+            if(!channel.maxima.empty() && channel.maxima.front().time <= sampleTime)
+            {
+                channel.maxima.pop_front();
+            }
+            channel.sum -= value;
+            channel.sumOfSquares -= static_cast<double>(value) * value;
+            channel.sketch.remove(value);
+        });
+        samples.pop_front();
+    }
+
+    if(samples.empty())
+    {
+        // Start over without the rounding errors the running sums picked up
+        for(auto& channel : channels)
+        {
+            channel.sum = 0.0;
+            channel.sumOfSquares = 0.0;
+        }
+    }
+}
+
+std::array<ChannelStatistics, NumPowerChannels> RollingStatistics::summarize() const
+{
+    std::array<ChannelStatistics, NumPowerChannels> statistics;
+    if(samples.empty())
+    {
+        auto const nan{std::numeric_limits<float>::quiet_NaN()};
+        statistics.fill({nan, nan, nan, nan, nan, nan, nan});
+        return statistics;
+    }
+
+    auto const n{static_cast<double>(samples.size())};
+    for(size_t i = 0; i < NumPowerChannels; ++i)
+    {
+        auto const& channel{channels[i]};
+        auto const mean{channel.sum / n};
+        auto const variance{std::max(channel.sumOfSquares / n - mean * mean, 0.0)};
+
+        statistics[i] = {
+            .min = channel.minima.front().value,
+            .max = channel.maxima.front().value,
+            .mean = static_cast<float>(mean),
+            .stddev = static_cast<float>(std::sqrt(variance)),
+            .p50 = *channel.sketch.quantile(0.5),
+            .p90 = *channel.sketch.quantile(0.9),
+            .p99 = *channel.sketch.quantile(0.99)
+        };
+    }
+    return statistics;
+}
+
+TelemetryStatistics::TelemetryStatistics()
+: aggregatedWindows{makeWindows()}
+{
+}
+
+std::vector<RollingStatistics> TelemetryStatistics::makeWindows() const
+{
+    std::vector<RollingStatistics> windows;
+    windows.reserve(Windows.size());
+    for(const auto& window : Windows)
+    {
+        windows.emplace_back(window.duration);
+    }
+    return windows;
+}
+
+void TelemetryStatistics::add(Clock::time_point sampleTime, const AggregatedTelemetry& aggregatedTelemetry)
+{
+    std::lock_guard lock{mutex};
+    for(auto& window : aggregatedWindows)
+    {
+        window.add(sampleTime, aggregatedTelemetry);
+    }
+}
+
+void TelemetryStatistics::add(Clock::time_point sampleTime, const UnitTelemetry& unitTelemetry)
+{
+    auto const power{unitPower(unitTelemetry)};
+
+    std::lock_guard lock{mutex};
+    auto it{unitWindows.find(unitTelemetry.serialNumber)};
+    if(it == unitWindows.end())
+    {
+        it = unitWindows.emplace(unitTelemetry.serialNumber, makeWindows()).first;
+    }
+    for(auto& window : it->second)
+    {
+        window.add(sampleTime, power);
+    }
+}
+
+WindowStatistics TelemetryStatistics::aggregated(std::string_view window, Clock::time_point now)
+{
+    std::lock_guard lock{mutex};
+    return summarize(aggregatedWindows, window, now);
+}
+
+WindowStatistics TelemetryStatistics::unit(std::string_view serialNumber, std::string_view window, Clock::time_point now)
+{
+    std::lock_guard lock{mutex};
+    auto const it{unitWindows.find(serialNumber)};
+    if(it == unitWindows.end())
+    {
+        // Not sampled yet, summarize an empty window
+        auto windows{makeWindows()};
+        return summarize(windows, window, now);
+    }
+    return summarize(it->second, window, now);
+}
+
+WindowStatistics TelemetryStatistics::summarize(std::vector<RollingStatistics>& windows, std::string_view window, Clock::time_point now) const
+{
+    auto const it{std::ranges::find(Windows, window, &Window::name)};
+    if(it == Windows.end())
+    {
+        throw std::invalid_argument("Window must be one of 1m, 5m or 1h");
+    }
+
+    auto& statistics{windows[static_cast<size_t>(it - Windows.begin())]};
+    statistics.expire(now);
+    return {
+        .window = it->name,
+        .duration = it->duration,
+        .numSamples = statistics.numSamples(),
+        .channels = statistics.summarize()
+    };
+}
+
+}
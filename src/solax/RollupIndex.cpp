@@ -0,0 +1,464 @@
+#include <solax/RollupIndex.h>
+#include <solax/Crc.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <stdexcept>
+#include <sys/stat.h>
+
+namespace solax
+{
+
+namespace
+{
+
+// On-disk form of a Rollup, the level files are arrays of these in chronological order
+struct RollupRecord
+{
+    int64_t start_ms;
+    uint32_t count;
+    uint32_t crc;                                            // Over the whole record with crc = 0
+    std::array<ChannelRollup, NumPowerChannels> channels;
+};
+
+static_assert(sizeof(RollupRecord) == 64);
+
+int64_t toMilliseconds(std::chrono::system_clock::time_point time)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+}
+
+std::chrono::system_clock::time_point fromMilliseconds(int64_t time_ms)
+{
+    return std::chrono::system_clock::time_point{std::chrono::milliseconds{time_ms}};
+}
+
+int64_t alignDown(int64_t time_ms, int64_t step_ms)
+{
+    return time_ms - ((time_ms % step_ms) + step_ms) % step_ms;
+}
+
+uint32_t recordCrc(RollupRecord record)
+{
+    record.crc = 0;
+    return crc32(0, reinterpret_cast<const std::byte*>(&record), sizeof(record));
+}
+
+RollupRecord toRecord(const Rollup& rollup)
+{
+    RollupRecord record{
+        .start_ms = toMilliseconds(rollup.start),
+        .count = rollup.count,
+        .crc = 0,
+        .channels = rollup.channels
+    };
+    record.crc = recordCrc(record);
+    return record;
+}
+
+Rollup fromRecord(const RollupRecord& record)
+{
+    return {.start = fromMilliseconds(record.start_ms), .count = record.count, .channels = record.channels};
+}
+
+std::runtime_error rollupError(const std::string& what, const std::filesystem::path& path)
+{
+    return std::runtime_error(what + " " + path.string() + ": " + std::strerror(errno));
+}
+
+std::vector<RollupRecord> readRecords(int fd, const std::filesystem::path& path, size_t first, size_t count)
+{
+    std::vector<RollupRecord> records(count);
+    auto const size{count * sizeof(RollupRecord)};
+    auto* data{reinterpret_cast<char*>(records.data())};
+    size_t done{0};
+    while(done < size)
+    {
+        auto const result{::pread(fd, data + done, size - done, static_cast<off_t>(first * sizeof(RollupRecord) + done))};
+        if(result <= 0)
+        {
+            if(result < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            throw rollupError("Cannot read rollups from", path);
+        }
+        done += static_cast<size_t>(result);
+    }
+    return records;
+}
+
+void writeRecords(int fd, const std::filesystem::path& path, size_t first, const std::vector<RollupRecord>& records)
+{
+    auto const size{records.size() * sizeof(RollupRecord)};
+    auto const* data{reinterpret_cast<const char*>(records.data())};
+    size_t done{0};
+    while(done < size)
+    {
+        auto const result{::pwrite(fd, data + done, size - done, static_cast<off_t>(first * sizeof(RollupRecord) + done))};
+        if(result < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            throw rollupError("Cannot write rollups to", path);
+        }
+        done += static_cast<size_t>(result);
+    }
+    if(::fdatasync(fd) != 0)
+    {
+        throw rollupError("Cannot write rollups to", path);
+    }
+}
+
+// Index of the first of numRecords records that starts at or after start_ms
+size_t lowerBound(int fd, const std::filesystem::path& path, size_t numRecords, int64_t start_ms)
+{
+    size_t low{0};
+    size_t high{numRecords};
+    while(low < high)
+    {
+        auto const middle{low + (high - low) / 2};
+        if(readRecords(fd, path, middle, 1).front().start_ms < start_ms)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+}
+
+void Rollup::add(const AggregatedTelemetry& power)
+{
+    size_t index{0};
+    forEachField(aggregatedTelemetryFields, [&](const auto& field)
+    {
+        auto const value{power.*field.member};
+        auto& channel{channels[index++]};
+        channel.min = count > 0 ? std::min(channel.min, value) : value;
+        channel.max = count > 0 ? std::max(channel.max, value) : value;
+        channel.sum = (count > 0 ? channel.sum : 0.0) + static_cast<double>(value);
+    });
+    count++;
+}
+
+void Rollup::merge(const Rollup& other)
+{
+    if(other.count == 0)
+    {
+        return;
+    }
+    if(count == 0)
+    {
+        count = other.count;
+        channels = other.channels;
+        return;
+    }
+
+    for(size_t i = 0; i < channels.size(); ++i)
+    {
+        channels[i].min = std::min(channels[i].min, other.channels[i].min);
+        channels[i].max = std::max(channels[i].max, other.channels[i].max);
+        channels[i].sum += other.channels[i].sum;
+    }
+    count += other.count;
+}
+
+RollupBuilder::RollupBuilder(std::chrono::seconds stepParam)
+: step{stepParam}
+{
+}
+
+std::chrono::system_clock::time_point RollupBuilder::bucketStart(std::chrono::system_clock::time_point time, std::chrono::seconds step)
+{
+    return fromMilliseconds(alignDown(toMilliseconds(time), std::chrono::milliseconds{step}.count()));
+}
+
+void RollupBuilder::add(const Rollup& rollup)
+{
+    bucket(rollup.start).merge(rollup);
+}
+
+void RollupBuilder::add(const HistorySample& sample)
+{
+    bucket(sample.time).add(sample.aggregated);
+}
+
+std::vector<Rollup> RollupBuilder::finish()
+{
+    return std::move(result);
+}
+
+Rollup& RollupBuilder::bucket(std::chrono::system_clock::time_point time)
+{
+    auto const start{bucketStart(time, step)};
+    if(result.empty() || result.back().start != start)
+    {
+        result.push_back({.start = start});
+    }
+    return result.back();
+}
+
+RollupIndex::RollupIndex(const std::filesystem::path& directoryParam)
+: directory{directoryParam}
+{
+    for(size_t level = 0; level < Levels.size(); ++level)
+    {
+        openLevel(level);
+    }
+}
+
+void RollupIndex::openLevel(size_t level)
+{
+    auto& state{levels[level]};
+    state.path = directory / ("rollup_" + std::string{Levels[level].name} + ".bin");
+    state.fd.reset(::open(state.path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644));
+    if(!state.fd.valid())
+    {
+        throw rollupError("Cannot open rollups", state.path);
+    }
+
+    struct stat status;
+    if(::fstat(state.fd.get(), &status) != 0)
+    {
+        throw rollupError("Cannot stat rollups", state.path);
+    }
+
+    // Drop a record torn by a power cut, the samples it covered are replayed from the store
+    auto const size{static_cast<size_t>(status.st_size)};
+    state.numRecords = size / sizeof(RollupRecord);
+    while(state.numRecords > 0)
+    {
+        auto const last{readRecords(state.fd.get(), state.path, state.numRecords - 1, 1).front()};
+        if(last.crc == recordCrc(last))
+        {
+            break;
+        }
+        state.numRecords--;
+    }
+    if(state.numRecords * sizeof(RollupRecord) != size)
+    {
+        std::cerr << "Dropping torn rollups at the end of " << state.path.string() << std::endl;
+        if(::ftruncate(state.fd.get(), static_cast<off_t>(state.numRecords * sizeof(RollupRecord))) != 0)
+        {
+            throw rollupError("Cannot truncate rollups", state.path);
+        }
+    }
+
+    if(state.numRecords > 0)
+    {
+        state.firstStart_ms = readRecords(state.fd.get(), state.path, 0, 1).front().start_ms;
+        state.lastStart_ms = readRecords(state.fd.get(), state.path, state.numRecords - 1, 1).front().start_ms;
+    }
+}
+
+RollupIndex::Clock::time_point RollupIndex::resumeTime() const
+{
+    auto result{Clock::time_point::max()};
+    for(size_t level = 0; level < Levels.size(); ++level)
+    {
+        const auto& state{levels[level]};
+        if(state.numRecords == 0)
+        {
+            return Clock::time_point::min();
+        }
+        result = std::min(result, fromMilliseconds(state.lastStart_ms) + Levels[level].duration);
+    }
+    return result;
+}
+
+void RollupIndex::add(const HistorySample& sample)
+{
+    auto const time_ms{toMilliseconds(sample.time)};
+    for(size_t level = 0; level < Levels.size(); ++level)
+    {
+        auto& state{levels[level]};
+        auto const start_ms{alignDown(time_ms, std::chrono::milliseconds{Levels[level].duration}.count())};
+        if(state.numRecords > 0 && start_ms <= state.lastStart_ms)
+        {
+            continue;
+        }
+
+        if(state.open)
+        {
+            auto const openStart_ms{toMilliseconds(state.open->start)};
+            if(start_ms < openStart_ms)
+            {
+                continue;
+            }
+            if(start_ms > openStart_ms)
+            {
+                state.completed.push_back(*state.open);
+                state.open.reset();
+            }
+        }
+        if(!state.open)
+        {
+            state.open = Rollup{.start = fromMilliseconds(start_ms)};
+        }
+        state.open->add(sample.aggregated);
+    }
+}
+
+void RollupIndex::flush()
+{
+    for(size_t level = 0; level < Levels.size(); ++level)
+    {
+        auto& state{levels[level]};
+        if(state.completed.empty())
+        {
+            continue;
+        }
+
+        std::vector<RollupRecord> records;
+        records.reserve(state.completed.size());
+        for(const auto& rollup : state.completed)
+        {
+            records.push_back(toRecord(rollup));
+        }
+
+        // Written behind the last record. A failed write is overwritten by the next one, the buckets stay
+        // completed until then, so a transient write error is retried on the next flush.
+        writeRecords(state.fd.get(), state.path, state.numRecords, records);
+        state.completed.clear();
+        if(state.numRecords == 0)
+        {
+            state.firstStart_ms = records.front().start_ms;
+        }
+        state.numRecords += records.size();
+        state.lastStart_ms = records.back().start_ms;
+
+        trim(level, state.lastStart_ms);
+    }
+}
+
+void RollupIndex::trim(size_t level, int64_t now_ms)
+{
+    auto const retention_ms{std::chrono::duration_cast<std::chrono::milliseconds>(Levels[level].retention).count()};
+    auto& state{levels[level]};
+    // Rewriting the file is only worth it once a quarter of the retention has expired
+    if(retention_ms == 0 || state.numRecords == 0 || state.firstStart_ms >= now_ms - retention_ms - retention_ms / 4)
+    {
+        return;
+    }
+
+    auto const first{lowerBound(state.fd.get(), state.path, state.numRecords, now_ms - retention_ms)};
+    auto const records{readRecords(state.fd.get(), state.path, first, state.numRecords - first)};
+
+    // Write a temporary file and rename it, so a power cut leaves either the old or the new file behind
+    auto tempPath{state.path};
+    tempPath += ".tmp";
+    FileDescriptor temp{::open(tempPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)};
+    if(!temp.valid())
+    {
+        throw rollupError("Cannot open rollups", tempPath);
+    }
+    writeRecords(temp.get(), tempPath, 0, records);
+    if(std::rename(tempPath.c_str(), state.path.c_str()) != 0)
+    {
+        throw rollupError("Cannot replace rollups", state.path);
+    }
+
+    state.fd = std::move(temp);
+    state.numRecords = records.size();
+    state.firstStart_ms = records.empty() ? 0 : records.front().start_ms;
+}
+
+std::optional<size_t> RollupIndex::levelFor(std::chrono::seconds step)
+{
+    for(size_t level = Levels.size(); level > 0; --level)
+    {
+        if(step >= Levels[level - 1].duration && step % Levels[level - 1].duration == std::chrono::seconds::zero())
+        {
+            return level - 1;
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<RollupIndex::Clock::time_point> RollupIndex::oldest(size_t level) const
+{
+    const auto& state{levels.at(level)};
+    if(state.numRecords > 0)
+    {
+        return fromMilliseconds(state.firstStart_ms);
+    }
+    if(!state.completed.empty())
+    {
+        return state.completed.front().start;
+    }
+    if(state.open)
+    {
+        return state.open->start;
+    }
+    return std::nullopt;
+}
+
+std::vector<Rollup> RollupIndex::query(size_t level, Clock::time_point since, Clock::time_point until, std::chrono::seconds step) const
+{
+    return snapshot(level).query(since, until, step);
+}
+
+RollupIndex::LevelSnapshot RollupIndex::snapshot(size_t level) const
+{
+    const auto& state{levels.at(level)};
+    LevelSnapshot snapshot{
+        .path = state.path,
+        .fd = FileDescriptor{::fcntl(state.fd.get(), F_DUPFD_CLOEXEC, 0)},
+        .numRecords = state.numRecords,
+        .firstStart_ms = state.firstStart_ms,
+        .lastStart_ms = state.lastStart_ms,
+        .pending = state.completed
+    };
+    if(!snapshot.fd.valid())
+    {
+        throw rollupError("Cannot duplicate descriptor of", state.path);
+    }
+    if(state.open)
+    {
+        snapshot.pending.push_back(*state.open);
+    }
+    return snapshot;
+}
+
+std::vector<Rollup> RollupIndex::LevelSnapshot::query(Clock::time_point since, Clock::time_point until, std::chrono::seconds step) const
+{
+    auto const since_ms{alignDown(toMilliseconds(since), std::chrono::milliseconds{step}.count())};
+    auto const until_ms{toMilliseconds(until)};
+
+    RollupBuilder builder{step};
+    auto const add{[&](const Rollup& rollup)
+    {
+        auto const start_ms{toMilliseconds(rollup.start)};
+        if(start_ms >= since_ms && start_ms <= until_ms)
+        {
+            builder.add(rollup);
+        }
+    }};
+
+    if(numRecords > 0 && lastStart_ms >= since_ms && firstStart_ms <= until_ms)
+    {
+        auto const first{lowerBound(fd.get(), path, numRecords, since_ms)};
+        auto const end{lowerBound(fd.get(), path, numRecords, until_ms + 1)};
+        for(const auto& record : readRecords(fd.get(), path, first, end - first))
+        {
+            add(fromRecord(record));
+        }
+    }
+    for(const auto& rollup : pending)
+    {
+        add(rollup);
+    }
+    return builder.finish();
+}
+
+}
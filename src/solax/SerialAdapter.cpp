@@ -1,6 +1,22 @@
 #include <solax/SerialAdapter.h>
+#include <solax/Crc.h>
+#include <solax/Telemetry.h>
+#include <solax/TelemetrySchema.h>
+#include <algorithm>
+#include <limits>
 #include <thread>
 #include <chrono>
+#include <mutex>
+#include <optional>
+#include <array>
+#include <charconv>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <termios.h>
+#include <unistd.h>
 
 using namespace std::chrono_literals;
 using namespace mn::CppLinuxSerial;
@@ -8,80 +24,265 @@ using namespace mn::CppLinuxSerial;
 namespace solax
 {
 
-SerialAdapter::SerialAdapter(const Config& config)
-: serialPort("", config.baudRate, config.numDataBits, config.parity, config.numStopBits, config.hardwareFlowControl, config.softwareFlowControl)
+namespace
 {
-    bool found = false;
-    for(const auto& path : config.devicePaths) 
-    {
-        std::cout << "Checking device: "  << path << std::endl;
 
-        try 
+auto const probeTimeout{2500ms};
+
+// A response that did not arrive is waited for this many response timeouts after it was asked for
+constexpr int LateResponseTimeouts{2};
+
+std::runtime_error systemError(const std::string& what)
+{
+    return std::runtime_error("Serial Device Error: " + what + ": " + std::strerror(errno));
+}
+
+// Blocks until the descriptor becomes readable or the deadline passes.
+// Returns false on timeout or when cancelFd got signaled, throws if the device went away.
+bool waitForData(int fd, std::chrono::steady_clock::time_point deadline, int cancelFd = -1)
+{
+    while(true)
+    {
+        auto const remaining{std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now())};
+        if(remaining <= 0ms)
         {
-            serialPort.SetDevice(path);
-            serialPort.SetTimeout(100); // Block for up to 100ms to receive data
-            serialPort.Open();
+            return false;
+        }
 
-            if(serialPort.GetState() != mn::CppLinuxSerial::State::OPEN) 
+        std::array<pollfd, 2> fds{{
+            {.fd = fd, .events = POLLIN, .revents = 0},
+            {.fd = cancelFd, .events = POLLIN, .revents = 0}
+        }};
+        auto const result{::poll(fds.data(), cancelFd >= 0 ? 2 : 1, static_cast<int>(remaining.count()))};
+        if(result < 0)
+        {
+            if(errno == EINTR)
             {
-                std::cout << "Cannot open device: "  << path << std::endl;
                 continue;
             }
+            throw systemError("poll");
+        }
+        if(result == 0 || fds[1].revents != 0)
+        {
+            return false;
+        }
+        if(fds[0].revents & POLLIN)
+        {
+            return true;
+        }
+        if(fds[0].revents & (POLLERR | POLLHUP | POLLNVAL))
+        {
+            throw std::runtime_error("Serial Device Error: device hung up");
+        }
+    }
+}
 
-            // Send a empty query to test if device responds
-            serialPort.Write("\n\r");
-            std::this_thread::sleep_for(500ms);
-            
-            std::string readData;
-            auto const timeout{2000ms};
-            auto const stepDuration{100ms};
-            auto waitedFor{0ms};
-            
-            while(waitedFor < timeout) 
+// CppLinuxSerial does not expose its file descriptor, so a second non-blocking descriptor on the
+// same tty is used for readiness notification and reads. The termios setup is shared by the device.
+FileDescriptor openReceiveChannel(const std::string& path)
+{
+    FileDescriptor fd{::open(path.c_str(), O_RDONLY | O_NOCTTY | O_NONBLOCK | O_CLOEXEC)};
+    if(!fd.valid())
+    {
+        throw systemError("open " + path);
+    }
+    return fd;
+}
+
+struct Connection
+{
+    std::unique_ptr<SerialPort> serialPort;
+    FileDescriptor receiveFd;
+};
+
+// Commands taking a unit index as argument, all other commands are told apart by their full inquiry
+constexpr std::array<std::string_view, 1> IndexedCommands{"QPGS"};
+
+// Commands addressing different units, like QPGS1 and QPGS2, share their latency statistics.
+// A trailing digit of another command is part of its name, QPIGS2 answers differently than QPIGS.
+std::string_view commandType(std::string_view inquiry)
+{
+    auto const type{inquiry.substr(0, inquiry.find_last_not_of("0123456789") + 1)};
+    return std::ranges::find(IndexedCommands, type) != IndexedCommands.end() ? type : inquiry;
+}
+
+// Number of space separated fields and length of the response to an inquiry, tells a late response to
+// another command apart from the one asked for
+struct ResponseShape
+{
+    std::string_view inquiry;                    // Matches the inquiry itself or its command type
+    size_t minFields;
+    size_t maxFields;
+    size_t minLength{0};
+    size_t maxLength{std::numeric_limits<size_t>::max()};
+};
+
+template<typename Fields>
+constexpr size_t numFields(const Fields&)
+{
+    return std::tuple_size_v<Fields>;
+}
+
+// QPIGS carries reserved fields after the parsed ones, but fewer than the fields of QPGSn
+constexpr std::array ResponseShapes{
+    ResponseShape{.inquiry = "QPGS", .minFields = numFields(unitTelemetryFields), .maxFields = numFields(unitTelemetryFields) + 8},
+    ResponseShape{.inquiry = "QPIGS", .minFields = numFields(generalStatusFields), .maxFields = numFields(unitTelemetryFields) - 1},
+    ResponseShape{.inquiry = "QPIGS2", .minFields = numFields(pv2StatusFields), .maxFields = numFields(pv2StatusFields) + 4},
+    ResponseShape{.inquiry = "QPIWS", .minFields = 1, .maxFields = 1, .minLength = 32},
+    ResponseShape{.inquiry = "QMOD", .minFields = 1, .maxFields = 1, .maxLength = 1}
+};
+
+// Whether the response (without start byte, with CRC) can be the answer to the inquiry. Rejections and
+// responses to inquiries without a known shape always fit.
+bool fitsInquiry(std::string_view inquiry, std::string_view response)
+{
+    if(isRejectedInquiry(response))
+    {
+        return true;
+    }
+
+    auto shape{std::ranges::find(ResponseShapes, inquiry, &ResponseShape::inquiry)};
+    if(shape == ResponseShapes.end())
+    {
+        shape = std::ranges::find(ResponseShapes, commandType(inquiry), &ResponseShape::inquiry);
+    }
+    if(shape == ResponseShapes.end())
+    {
+        return true;
+    }
+
+    response.remove_suffix(std::min<size_t>(2, response.size()));
+    size_t fields{0};
+    for(size_t begin = response.find_first_not_of(' '); begin != std::string_view::npos; begin = response.find_first_not_of(' ', begin))
+    {
+        fields++;
+        begin = std::min(response.find(' ', begin), response.size());
+    }
+    return fields >= shape->minFields && fields <= shape->maxFields
+        && response.size() >= shape->minLength && response.size() <= shape->maxLength;
+}
+
+// Serial number in a response to an indexed command like QPGS2. Empty for other commands and for
+// unit indices without a unit, which answer with zeros.
+std::string_view unitSerialNumber(std::string_view inquiry, std::string_view response)
+{
+    if(commandType(inquiry).size() == inquiry.size())
+    {
+        return {};
+    }
+    auto const begin{response.find(' ')};
+    if(begin == std::string_view::npos)
+    {
+        return {};
+    }
+    auto const serialNumber{response.substr(begin + 1, response.find(' ', begin + 1) - begin - 1)};
+    return serialNumber.find_first_not_of('0') != std::string_view::npos ? serialNumber : std::string_view{};
+}
+
+// Opens the device and checks whether a CDP SOLAX answers the probe. Gives up early once cancelFd gets signaled.
+std::optional<Connection> probeDevice(const SerialAdapter::Config& config, const std::string& path, int cancelFd)
+{
+    try 
+    {
+        Connection connection{
+            .serialPort = std::make_unique<SerialPort>(path, config.baudRate, config.numDataBits, config.parity, config.numStopBits, config.hardwareFlowControl, config.softwareFlowControl),
+            .receiveFd = {}
+        };
+        connection.serialPort->SetTimeout(100); // Block for up to 100ms to receive data
+        connection.serialPort->Open();
+
+        if(connection.serialPort->GetState() != mn::CppLinuxSerial::State::OPEN) 
+        {
+            return std::nullopt;
+        }
+
+        connection.receiveFd = openReceiveChannel(path);
+        ::tcflush(connection.receiveFd.get(), TCIFLUSH);
+
+        // Send a empty query to test if device responds
+        connection.serialPort->Write("\n\r");
+
+        std::string readData;
+        auto const deadline{std::chrono::steady_clock::now() + probeTimeout};
+        while(waitForData(connection.receiveFd.get(), deadline, cancelFd))
+        {
+            char readBuffer[64];
+            auto const numBytesRead{::read(connection.receiveFd.get(), readBuffer, sizeof(readBuffer))};
+            if(numBytesRead > 0)
             {
-                if(serialPort.Available()) 
-                {
-                    serialPort.Read(readData);
-                    
-                    // Check if response contains '(' which indicates proper protocol response
-                    if(readData.find("(NAKss") != std::string::npos) 
-                    {
-                        found = true;
-                        activeDevicePath = path;
-                        break;
-                    }
-                }
-                std::this_thread::sleep_for(stepDuration);
-                waitedFor += stepDuration;
+                readData.append(readBuffer, static_cast<size_t>(numBytesRead));
             }
-            serialPort.Close();
-            if(found) 
+
+            // Check if response contains '(' which indicates proper protocol response
+            if(readData.find("(NAKss") != std::string::npos) 
             {
-                std::cout << "Found CDP SOLAX device at: "  << path << std::endl;
-                std::this_thread::sleep_for(200ms); // Give device time to settle
-                serialPort.SetDevice(path);
-                serialPort.SetTimeout(100);
-                serialPort.Open();
-                break;
+                return connection;
             }
         }
-        catch(const mn::CppLinuxSerial::Exception&) 
+    }
+    catch(const std::exception&) 
+    {
+        // Not our device, or it is not accessible
+    }
+    return std::nullopt;
+}
+
+}
+
+SerialAdapter::SerialAdapter(const Config& config)
+: responseTimeoutConfig{config.responseTimeout}
+{
+    FileDescriptor cancelFd{::eventfd(0, EFD_CLOEXEC)};
+    if(!cancelFd.valid())
+    {
+        throw systemError("eventfd");
+    }
+
+    // All candidates are probed in parallel, the first device that answers wins and cancels the others
+    std::mutex winnerMutex;
+    std::optional<Connection> winner;
+    {
+        std::vector<std::jthread> probes;
+        probes.reserve(config.devicePaths.size());
+        for(const auto& path : config.devicePaths) 
         {
-            // Try next device
-            try { serialPort.Close(); } catch(...) {}
+            std::cout << "Checking device: "  << path << std::endl;
+
+            probes.emplace_back([&, path]()
+            {
+                auto connection{probeDevice(config, path, cancelFd.get())};
+                if(!connection)
+                {
+                    return;
+                }
+
+                std::lock_guard lock{winnerMutex};
+                if(!winner)
+                {
+                    winner = std::move(connection);
+                    activeDevicePath = path;
+                    uint64_t const signal{1};
+                    [[maybe_unused]] auto const written{::write(cancelFd.get(), &signal, sizeof(signal))};
+                }
+            });
         }
     }
-    if(!found) 
+
+    if(!winner) 
     {
         throw std::runtime_error("No serial device responded with the expected protocol format (no '(NAKss' found in response)");
     }
+
+    std::cout << "Found CDP SOLAX device at: "  << activeDevicePath << std::endl;
+    serialPort = std::move(winner->serialPort);
+    receiveFd = std::move(winner->receiveFd);
 }
 
 SerialAdapter::~SerialAdapter()
 {
     try
     {
-        serialPort.Close();
+        serialPort->Close();
     }
     catch(const mn::CppLinuxSerial::Exception& e)
     {
@@ -89,58 +290,141 @@ SerialAdapter::~SerialAdapter()
     }
 }
 
-std::string SerialAdapter::readRawTelemetry(uint8_t machineIndex)
+void SerialAdapter::reopen()
 {
-    std::string_view const randomCrc{"34"};
-    char const messageStartToken{'('};
-    char const messageEndToken{'\r'};
-    auto const timeout{5000ms};
-    auto const stepDuration{100ms};
-    auto waitedFor{0ms};
+    receiveFd.reset();
+    frameAssembler.reset();
+    numResponsesInFlight = 0;
+    lastInquiry.clear();
 
     try
     {
-        // Flush any pending data from the serial port
-        while(serialPort.Available())
-        {
-            std::string discardData;
-            serialPort.Read(discardData);
-        }
-        
-        serialPort.Write("QPGS");
-        serialPort.Write(std::to_string(machineIndex));
-        serialPort.Write(randomCrc.data());
-        serialPort.Write("\r");
-
-        std::string totalReadData;
-        auto startTime = std::chrono::steady_clock::now();
-        
-        while(std::chrono::steady_clock::now() - startTime < timeout)
+        serialPort->Close();
+        serialPort->Open();
+    }
+    catch(const mn::CppLinuxSerial::Exception& e)
+    {
+        throw std::runtime_error(std::string("Serial Device Error: ") + e.what());
+    }
+
+    if(serialPort->GetState() != mn::CppLinuxSerial::State::OPEN)
+    {
+        throw std::runtime_error("Cannot reopen device: " + activeDevicePath);
+    }
+    receiveFd = openReceiveChannel(activeDevicePath);
+}
+
+TelemetryResult<std::string_view> SerialAdapter::readRawTelemetry(uint8_t machineIndex)
+{
+    char inquiry[8]{"QPGS"};
+    auto const [end, ec]{std::to_chars(inquiry + 4, inquiry + sizeof(inquiry), machineIndex)};
+    return query(std::string_view{inquiry, end});
+}
+
+TelemetryResult<std::string_view> SerialAdapter::query(std::string_view inquiry)
+{
+    int const maxAttempts{3};
+
+    auto const command{frameCommand(inquiry)};
+    auto& latencyTracker{latencyTrackerOf(inquiry)};
+    std::string_view failure;
+    bool anyDataReceived{false};
+
+    if(inquiry != lastInquiry)
+    {
+        discardLateResponses();
+        lastInquiry = inquiry;
+    }
+
+    // Each attempt waits only as long as this command type usually takes, the overall budget stays the ceiling
+    auto const queryDeadline{std::chrono::steady_clock::now() + responseTimeoutConfig.ceiling};
+
+    try
+    {
+        for(int attempt = 1; attempt <= maxAttempts; ++attempt)
         {
-            if(serialPort.Available())
+            // Drop any pending data of a previous, possibly aborted exchange
+            ::tcflush(receiveFd.get(), TCIFLUSH);
+            frameAssembler.reset();
+            
+            serialPort->Write(command);
+            numResponsesInFlight++;
+
+            bool corruptedFrame{false};
+            bool unexpectedFrame{false};
+            size_t numBytesReceived{0};
+            size_t numFrameBytes{0};
+            auto const sendTime{std::chrono::steady_clock::now()};
+            auto const deadline{std::min(sendTime + latencyTracker.timeout(), queryDeadline)};
+            
+            while(!corruptedFrame && waitForData(receiveFd.get(), deadline))
             {
-                std::string readData;
-                serialPort.Read(readData);
-                totalReadData.append(readData);
-                
-                // Check if we have a complete message
-                auto const start{totalReadData.find(messageStartToken)};
-                auto const end{totalReadData.find(messageEndToken, start)};
+                auto const area{frameAssembler.writableArea()};
+                auto const numBytesRead{::read(receiveFd.get(), area.data(), area.size())};
+                if(numBytesRead < 0)
+                {
+                    if(errno == EAGAIN || errno == EINTR)
+                    {
+                        continue;
+                    }
+                    throw systemError("read");
+                }
+                frameAssembler.commit(static_cast<size_t>(numBytesRead));
+                numBytesReceived += static_cast<size_t>(numBytesRead);
+                anyDataReceived = anyDataReceived || numBytesRead > 0;
                 
-                if(start != std::string::npos && end != std::string::npos && end > start)
+                while(auto const frame{frameAssembler.nextFrame()})
                 {
-                    // Extract message between '(' and '\r'
-                    return totalReadData.substr(start + 1, end - start - 1);
+                    numResponsesInFlight -= std::min<size_t>(numResponsesInFlight, 1);
+                    numFrameBytes += frame->size() + 1;
+                    if(!hasValidCrc(*frame))
+                    {
+                        // A line error corrupted the frame, ask again right away instead of publishing garbage
+                        corruptedFrame = true;
+                        break;
+                    }
+
+                    // Message between '(' and '\r'
+                    auto const response{frame->substr(1)};
+                    auto const serialNumber{unitSerialNumber(inquiry, response)};
+                    if(!fitsInquiry(inquiry, response) || answeredByOtherIndex(inquiry, serialNumber))
+                    {
+                        // Late response to an earlier command, the one asked for may still follow
+                        unexpectedFrame = true;
+                        continue;
+                    }
+
+                    latencyTracker.add(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - sendTime));
+                    rememberSerialNumber(inquiry, serialNumber);
+
+                    // Responses of earlier attempts that are still on their way answer the same inquiry,
+                    // the next one tells them apart by shape and serial number
+                    numResponsesInFlight = 0;
+                    return response;
                 }
             }
-            
-            std::this_thread::sleep_for(stepDuration);
-        }
-        
-        // Timeout - check if we got any data at all
-        if(!totalReadData.empty())
-        {
-            throw std::runtime_error("Incomplete response from device: " + totalReadData);
+
+            // Ask again right away instead of stalling the whole cycle
+            failure = corruptedFrame ? "corrupted response (CRC mismatch)"
+                    : unexpectedFrame ? "unexpected response"
+                    : numBytesReceived > 0 ? "incomplete response" : "no response";
+            if(!corruptedFrame && numBytesReceived > numFrameBytes)
+            {
+                // Part of the response arrived, the rest gets dropped
+                numResponsesInFlight -= std::min<size_t>(numResponsesInFlight, 1);
+            }
+            else if(!corruptedFrame)
+            {
+                // Nothing of it arrived, it might still be on its way when the next command is sent. It is waited
+                // for as long as a few usual responses take, a lost response must not stall the next inquiry.
+                lateResponseDeadline = sendTime + std::min(LateResponseTimeouts * latencyTracker.timeout(), responseTimeoutConfig.ceiling);
+            }
+            std::cerr << "Attempt " << attempt << " of " << inquiry << " failed: " << failure << std::endl;
+
+            if(std::chrono::steady_clock::now() >= queryDeadline)
+            {
+                break;
+            }
         }
     }
     catch(const mn::CppLinuxSerial::Exception& e)
@@ -148,7 +432,73 @@ std::string SerialAdapter::readRawTelemetry(uint8_t machineIndex)
         throw std::runtime_error(std::string("Serial Device Error: ") + e.what());
     }
 
-    throw std::runtime_error("Timeout occured! Did not receive data from the serial device.");
+    return std::unexpected(TelemetryError{.kind = anyDataReceived ? TelemetryErrorKind::CorruptedResponse : TelemetryErrorKind::NoResponse});
+}
+
+void SerialAdapter::discardLateResponses()
+{
+    // A late response of a unit not seen before, or to a command without a known shape, cannot be told apart
+    // from the answer to the next command, so it has to be gone before another command is sent.
+    // Waits until the responses that did not arrive in time came in or cannot be expected anymore.
+    while(numResponsesInFlight > 0 && frameAssembler.nextFrame())
+    {
+        numResponsesInFlight--;
+    }
+    while(numResponsesInFlight > 0 && waitForData(receiveFd.get(), lateResponseDeadline))
+    {
+        auto const area{frameAssembler.writableArea()};
+        auto const numBytesRead{::read(receiveFd.get(), area.data(), area.size())};
+        if(numBytesRead < 0)
+        {
+            if(errno == EAGAIN || errno == EINTR)
+            {
+                continue;
+            }
+            throw systemError("read");
+        }
+        frameAssembler.commit(static_cast<size_t>(numBytesRead));
+        while(numResponsesInFlight > 0 && frameAssembler.nextFrame())
+        {
+            numResponsesInFlight--;
+        }
+    }
+    numResponsesInFlight = 0;
+}
+
+bool SerialAdapter::answeredByOtherIndex(std::string_view inquiry, std::string_view serialNumber) const
+{
+    return !serialNumber.empty() && std::ranges::any_of(unitSerialNumbers, [&](const auto& entry)
+    {
+        return entry.first != inquiry && entry.second == serialNumber;
+    });
+}
+
+void SerialAdapter::rememberSerialNumber(std::string_view inquiry, std::string_view serialNumber)
+{
+    if(serialNumber.empty())
+    {
+        return;
+    }
+    // A unit that moved to another index is no longer expected at its old one
+    std::erase_if(unitSerialNumbers, [&](const auto& entry) { return entry.second == serialNumber; });
+    unitSerialNumbers.emplace(inquiry, serialNumber);
+}
+
+std::chrono::milliseconds SerialAdapter::responseTimeout(std::string_view inquiry) const
+{
+    auto const tracker{latencyTrackers.find(commandType(inquiry))};
+    return tracker != latencyTrackers.end() ? tracker->second.timeout() : responseTimeoutConfig.ceiling;
+}
+
+LatencyTracker& SerialAdapter::latencyTrackerOf(std::string_view inquiry)
+{
+    auto const type{commandType(inquiry)};
+    auto tracker{latencyTrackers.find(type)};
+    if(tracker == latencyTrackers.end())
+    {
+        tracker = latencyTrackers.emplace(std::string{type}, LatencyTracker{responseTimeoutConfig}).first;
+    }
+    return tracker->second;
 }
 
 }
\ No newline at end of file
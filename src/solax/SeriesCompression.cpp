@@ -0,0 +1,248 @@
+#include <solax/SeriesCompression.h>
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+namespace solax
+{
+
+namespace
+{
+
+uint64_t lowBits(unsigned numBits)
+{
+    return numBits >= 64 ? ~uint64_t{0} : (uint64_t{1} << numBits) - 1;
+}
+
+uint64_t zigZag(int64_t value)
+{
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t unZigZag(uint64_t value)
+{
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+// Sign extends the lowest numBits of value
+int64_t signExtend(uint64_t value, unsigned numBits)
+{
+    auto const shift{64 - numBits};
+    return static_cast<int64_t>(value << shift) >> shift;
+}
+
+}
+
+void BitWriter::write(uint64_t value, unsigned numBits)
+{
+    if(numBits > bitsLeft())
+    {
+        throw std::out_of_range("Bit buffer is full");
+    }
+
+    while(numBits > 0)
+    {
+        auto const bitOffset{static_cast<unsigned>(position % 8)};
+        auto const numChunkBits{std::min(8 - bitOffset, numBits)};
+        auto const shift{8 - bitOffset - numChunkBits};
+        auto const mask{static_cast<uint8_t>(lowBits(numChunkBits) << shift)};
+        auto const chunk{static_cast<uint8_t>(((value >> (numBits - numChunkBits)) & lowBits(numChunkBits)) << shift)};
+
+        auto& byte{data[position / 8]};
+        byte = static_cast<std::byte>((static_cast<uint8_t>(byte) & ~mask) | chunk);
+        position += numChunkBits;
+        numBits -= numChunkBits;
+    }
+}
+
+uint64_t BitReader::read(unsigned numBits)
+{
+    if(numBits > size - position)
+    {
+        throw std::out_of_range("Read past the end of the bit buffer");
+    }
+
+    // Fast path: one unaligned big endian load covers up to 57 bits
+    auto const byteIndex{position / 8};
+    if(numBits <= 57 && byteIndex + 8 <= (size + 7) / 8)
+    {
+        uint64_t word{0};
+        for(size_t i = 0; i < 8; ++i)
+        {
+            word = (word << 8) | static_cast<uint8_t>(data[byteIndex + i]);
+        }
+        auto const bitOffset{static_cast<unsigned>(position % 8)};
+        position += numBits;
+        return (word << bitOffset) >> (64 - numBits);
+    }
+
+    uint64_t value{0};
+    while(numBits > 0)
+    {
+        auto const bitOffset{static_cast<unsigned>(position % 8)};
+        auto const numChunkBits{std::min(8 - bitOffset, numBits)};
+        auto const byte{static_cast<uint8_t>(data[position / 8])};
+        value = (value << numChunkBits) | ((byte >> (8 - bitOffset - numChunkBits)) & lowBits(numChunkBits));
+        position += numChunkBits;
+        numBits -= numChunkBits;
+    }
+    return value;
+}
+
+void encodeTimestamp(BitWriter& writer, TimestampState& state, int64_t timestamp)
+{
+    auto const delta{timestamp - state.previous};
+    auto const deltaOfDelta{delta - state.previousDelta};
+    state.previous = timestamp;
+    state.previousDelta = delta;
+
+    auto const u{static_cast<uint64_t>(deltaOfDelta)};
+    if(deltaOfDelta == 0)
+    {
+        writer.write(0b0, 1);
+    }
+    else if(deltaOfDelta >= -64 && deltaOfDelta <= 63)
+    {
+        writer.write(0b10, 2);
+        writer.write(u, 7);
+    }
+    else if(deltaOfDelta >= -256 && deltaOfDelta <= 255)
+    {
+        writer.write(0b110, 3);
+        writer.write(u, 9);
+    }
+    else if(deltaOfDelta >= -2048 && deltaOfDelta <= 2047)
+    {
+        writer.write(0b1110, 4);
+        writer.write(u, 12);
+    }
+    else
+    {
+        writer.write(0b1111, 4);
+        writer.write(u, 64);
+    }
+}
+
+int64_t decodeTimestamp(BitReader& reader, TimestampState& state)
+{
+    int64_t deltaOfDelta{0};
+    if(reader.readBit())
+    {
+        unsigned numBits{64};
+        if(!reader.readBit())
+        {
+            numBits = 7;
+        }
+        else if(!reader.readBit())
+        {
+            numBits = 9;
+        }
+        else if(!reader.readBit())
+        {
+            numBits = 12;
+        }
+        deltaOfDelta = signExtend(reader.read(numBits), numBits);
+    }
+
+    state.previousDelta += deltaOfDelta;
+    state.previous += state.previousDelta;
+    return state.previous;
+}
+
+void encodeFloat(BitWriter& writer, FloatState& state, float value)
+{
+    auto const bits{std::bit_cast<uint32_t>(value)};
+    auto const xored{bits ^ state.previous};
+    state.previous = bits;
+
+    if(xored == 0)
+    {
+        writer.write(0b0, 1);
+        return;
+    }
+
+    auto const leadingZeros{static_cast<uint8_t>(std::countl_zero(xored))};
+    auto const trailingZeros{static_cast<uint8_t>(std::countr_zero(xored))};
+
+    if(state.leadingZeros != 0xff && leadingZeros >= state.leadingZeros && trailingZeros >= state.trailingZeros)
+    {
+        // Fits into the window of the previous value
+        auto const numBits{32u - state.leadingZeros - state.trailingZeros};
+        writer.write(0b10, 2);
+        writer.write(xored >> state.trailingZeros, numBits);
+        return;
+    }
+
+    auto const numBits{32u - leadingZeros - trailingZeros};
+    writer.write(0b11, 2);
+    writer.write(leadingZeros, 5);
+    writer.write(numBits - 1, 5);
+    writer.write(xored >> trailingZeros, numBits);
+    state.leadingZeros = leadingZeros;
+    state.trailingZeros = trailingZeros;
+}
+
+float decodeFloat(BitReader& reader, FloatState& state)
+{
+    if(reader.readBit())
+    {
+        if(reader.readBit())
+        {
+            state.leadingZeros = static_cast<uint8_t>(reader.read(5));
+            auto const numBits{static_cast<unsigned>(reader.read(5)) + 1};
+            state.trailingZeros = static_cast<uint8_t>(32 - state.leadingZeros - numBits);
+        }
+        if(state.leadingZeros == 0xff)
+        {
+            throw std::out_of_range("Float window used before it was set");
+        }
+        auto const numBits{32u - state.leadingZeros - state.trailingZeros};
+        state.previous ^= static_cast<uint32_t>(reader.read(numBits)) << state.trailingZeros;
+    }
+    return std::bit_cast<float>(state.previous);
+}
+
+void encodeInteger(BitWriter& writer, IntegerState& state, int64_t value)
+{
+    auto remaining{zigZag(value - state.previous)};
+    state.previous = value;
+
+    if(remaining == 0)
+    {
+        writer.write(0b0, 1);
+        return;
+    }
+
+    writer.write(0b1, 1);
+    do
+    {
+        auto const group{remaining & 0x7f};
+        remaining >>= 7;
+        writer.write((remaining != 0 ? 0x80 : 0x00) | group, 8);
+    }
+    while(remaining != 0);
+}
+
+int64_t decodeInteger(BitReader& reader, IntegerState& state)
+{
+    if(reader.readBit())
+    {
+        uint64_t value{0};
+        unsigned shift{0};
+        uint64_t group;
+        do
+        {
+            group = reader.read(8);
+            if(shift < 64)
+            {
+                value |= (group & 0x7f) << shift;
+            }
+            shift += 7;
+        }
+        while((group & 0x80) != 0);
+        state.previous += unZigZag(value);
+    }
+    return state.previous;
+}
+
+}
@@ -1,7 +1,7 @@
 #include <solax/Telemetry.h>
+#include <solax/TelemetrySchema.h>
 #include <CppLinuxSerial/SerialPort.hpp>
 #include "OptionalValue.h"
-#include <sstream>
 #include <thread>
 #include <chrono>
 #include <ranges>
@@ -15,50 +15,148 @@ using namespace mn::CppLinuxSerial;
 namespace solax
 {
 
-UnitTelemetry parseRawTelemetry(const std::string& rawTelemetry)
+namespace
 {
-    UnitTelemetry ut;
-    
+
+// Splits a response into its space separated fields in a single pass, without copying
+class FieldTokenizer
+{
+public:
+    explicit FieldTokenizer(std::string_view dataParam) : data{dataParam} {}
+
+    std::string_view next()
+    {
+        auto const start{data.find_first_not_of(' ')};
+        if (start == std::string_view::npos) {
+            data = {};
+            return {};
+        }
+        data.remove_prefix(start);
+
+        auto const end{std::min(data.find(' '), data.size())};
+        auto const field{data.substr(0, end)};
+        data.remove_prefix(end);
+        return field;
+    }
+
+private:
+    std::string_view data;
+};
+
+// Returns false if the field does not hold a value of the member's type
+bool parseField(std::string_view field, int32_t& value)
+{
+    auto const parsed{to_int(field)};
+    value = parsed.value_or(value);
+    return parsed.has_value();
+}
+
+bool parseField(std::string_view field, float& value)
+{
+    auto const parsed{to_float(field)};
+    value = parsed.value_or(value);
+    return parsed.has_value();
+}
+
+bool parseField(std::string_view field, char& value)
+{
+    value = field.front();
+    return field.size() == 1;
+}
+
+bool parseField(std::string_view field, std::string& value)
+{
+    value.assign(field);
+    return true;
+}
+
+template<typename Telemetry, typename Fields>
+TelemetryResult<Telemetry> parseFields(std::string_view response, const Fields& schema)
+{
+    if (isRejectedInquiry(response)) {
+        return std::unexpected(TelemetryError{.kind = TelemetryErrorKind::RejectedInquiry});
+    }
+
     // Strip the 2-byte CRC from the end of the response
-    std::string data = rawTelemetry;
-    if (data.size() >= 2) {
-        data = data.substr(0, data.size() - 2);
+    if (response.size() >= 2) {
+        response.remove_suffix(2);
     }
-    
-    std::istringstream iss{data};
-
-    // Parse all fields according to QPGSn protocol
-    iss >> ut.parallelNum;                      // A: Parallel num
-    iss >> ut.serialNumber;                     // B: Serial number
-    iss >> ut.workMode;                         // C: Work mode
-    iss >> ut.faultCode;                        // D: Fault code
-    iss >> ut.gridVoltage_V;                    // E: Grid voltage
-    iss >> ut.gridFrequency_Hz;                 // F: Grid frequency
-    iss >> ut.acOutputVoltage_V;                // G: AC output voltage
-    iss >> ut.acOutputFrequency_Hz;             // H: AC output frequency
-    iss >> ut.acOutputApparentPower_VA;         // I: AC output apparent power
-    iss >> ut.acOutputActivePower_W;            // J: AC output active power
-    iss >> ut.loadPercent;                      // K: Load percentage
-    iss >> ut.batteryVoltage_V;                 // L: Battery voltage
-    iss >> ut.batteryChargingCurrent_A;         // M: Battery charging current
-    iss >> ut.batteryCapacity_pct;              // N: Battery capacity
-    iss >> ut.pv1InputVoltage_V;                // O: PV1 input voltage
-    iss >> ut.totalChargingCurrent_A;           // P: Total charging current
-    iss >> ut.totalAcOutputApparentPower_VA;    // Q: Total AC output apparent power
-    iss >> ut.totalOutputActivePower_W;         // R: Total output active power
-    iss >> ut.totalAcOutputPercent;             // S: Total AC output percentage
-    iss >> ut.inverterStatus;                   // U: Inverter status (8 bits)
-    iss >> ut.outputMode;                       // T: Output mode
-    iss >> ut.chargerSourcePriority;            // U: Charger source priority
-    iss >> ut.maxChargerCurrent_A;              // V: Max charger current
-    iss >> ut.maxChargerRange_A;                // W: Max charger range
-    iss >> ut.maxAcChargerCurrent_A;            // Z: Max AC charger current
-    iss >> ut.pv1InputCurrent_A;                // a: PV1 input current
-    iss >> ut.batteryDischargeCurrent_A;        // b: Battery discharge current
-    iss >> ut.pv2InputVoltage_V;                // c: PV2 input voltage
-    iss >> ut.pv2InputCurrent_A;                // d: PV2 input current
-
-    return ut;
+
+    Telemetry telemetry;
+    FieldTokenizer fields{response};
+    size_t fieldIndex{0};
+    std::optional<TelemetryError> error;
+
+    // Parse all fields in the order of the schema, stop at the first bad one
+    forEachField(schema, [&](const auto& field)
+    {
+        if (error) {
+            return;
+        }
+
+        auto const token{fields.next()};
+        if (token.empty()) {
+            error = TelemetryError{.kind = TelemetryErrorKind::MissingField, .fieldIndex = fieldIndex, .fieldName = field.name};
+        }
+        else if (!parseField(token, telemetry.*field.member)) {
+            error = TelemetryError{.kind = TelemetryErrorKind::MalformedField, .fieldIndex = fieldIndex, .fieldName = field.name};
+        }
+        fieldIndex++;
+    });
+
+    if (error) {
+        return std::unexpected(*error);
+    }
+    return telemetry;
+}
+
+}
+
+TelemetryResult<UnitTelemetry> parseRawTelemetry(std::string_view rawTelemetry)
+{
+    return parseFields<UnitTelemetry>(rawTelemetry, unitTelemetryFields);
+}
+
+TelemetryResult<GeneralStatus> parseGeneralStatus(std::string_view response)
+{
+    return parseFields<GeneralStatus>(response, generalStatusFields);
+}
+
+TelemetryResult<Pv2Status> parsePv2Status(std::string_view response)
+{
+    return parseFields<Pv2Status>(response, pv2StatusFields);
+}
+
+TelemetryResult<WarningStatus> parseWarningStatus(std::string_view response)
+{
+    return parseFields<WarningStatus>(response, warningStatusFields);
+}
+
+TelemetryResult<DeviceMode> parseDeviceMode(std::string_view response)
+{
+    return parseFields<DeviceMode>(response, deviceModeFields);
+}
+
+bool isRejectedInquiry(std::string_view response)
+{
+    return response.starts_with("NAK");
+}
+
+AggregatedTelemetry unitPower(const UnitTelemetry& ut)
+{
+    // Solar power: PV1 + PV2 (voltage * current)
+    float pv1Power = ut.pv1InputVoltage_V * static_cast<float>(ut.pv1InputCurrent_A);
+    float pv2Power = ut.pv2InputVoltage_V * static_cast<float>(ut.pv2InputCurrent_A);
+
+    // Battery power: charging current - discharge current (positive = charging)
+    float batteryPower = ut.batteryVoltage_V * 
+        (static_cast<float>(ut.batteryChargingCurrent_A) - static_cast<float>(ut.batteryDischargeCurrent_A));
+
+    return {
+        .solarPower_W = pv1Power + pv2Power,
+        .acPower_W = static_cast<float>(ut.acOutputActivePower_W),
+        .batteryPower_W = batteryPower
+    };
 }
 
 AggregatedTelemetry aggregateTelemetry(const std::vector<UnitTelemetry>& unitTelemetry)
@@ -66,18 +164,10 @@ AggregatedTelemetry aggregateTelemetry(const std::vector<UnitTelemetry>& unitTel
     AggregatedTelemetry agg{0.0f, 0.0f, 0.0f};
     
     for (const auto& ut : unitTelemetry) {
-        // Solar power: PV1 + PV2 (voltage * current)
-        float pv1Power = ut.pv1InputVoltage_V * static_cast<float>(ut.pv1InputCurrent_A);
-        float pv2Power = ut.pv2InputVoltage_V * static_cast<float>(ut.pv2InputCurrent_A);
-        agg.solarPower_W += pv1Power + pv2Power;
-        
-        // AC output active power
-        agg.acPower_W += static_cast<float>(ut.acOutputActivePower_W);
-        
-        // Battery power: charging current - discharge current (positive = charging)
-        float batteryPower = ut.batteryVoltage_V * 
-            (static_cast<float>(ut.batteryChargingCurrent_A) - static_cast<float>(ut.batteryDischargeCurrent_A));
-        agg.batteryPower_W += batteryPower;
+        auto const power{unitPower(ut)};
+        agg.solarPower_W += power.solarPower_W;
+        agg.acPower_W += power.acPower_W;
+        agg.batteryPower_W += power.batteryPower_W;
     }
     
     return agg;
@@ -0,0 +1,34 @@
+#include <solax/TelemetryError.h>
+
+namespace solax
+{
+
+std::string_view toString(TelemetryErrorKind kind)
+{
+    switch (kind)
+    {
+    case TelemetryErrorKind::NoResponse:
+        return "no response";
+    case TelemetryErrorKind::CorruptedResponse:
+        return "corrupted response";
+    case TelemetryErrorKind::RejectedInquiry:
+        return "rejected inquiry";
+    case TelemetryErrorKind::MissingField:
+        return "missing field";
+    case TelemetryErrorKind::MalformedField:
+        return "malformed field";
+    }
+    return "unknown error";
+}
+
+std::string describe(const TelemetryError& error)
+{
+    std::string description{toString(error.kind)};
+    if (error.kind == TelemetryErrorKind::MissingField || error.kind == TelemetryErrorKind::MalformedField)
+    {
+        description += " " + std::to_string(error.fieldIndex) + " (" + std::string{error.fieldName} + ")";
+    }
+    return description;
+}
+
+}
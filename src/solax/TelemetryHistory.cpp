@@ -0,0 +1,204 @@
+#include <solax/TelemetryHistory.h>
+#include <solax/TelemetrySchema.h>
+#include <algorithm>
+#include <stdexcept>
+
+namespace solax
+{
+
+namespace
+{
+
+template<typename Sums>
+void accumulate(Sums& sums, const AggregatedTelemetry& power)
+{
+    size_t index{0};
+    forEachField(aggregatedTelemetryFields, [&](const auto& field) { sums[index++] += power.*field.member; });
+}
+
+template<typename Sums>
+AggregatedTelemetry divide(const Sums& sums, size_t n)
+{
+    AggregatedTelemetry power;
+    size_t index{0};
+    forEachField(aggregatedTelemetryFields, [&](const auto& field)
+    {
+        power.*field.member = static_cast<float>(sums[index++] / static_cast<double>(n));
+    });
+    return power;
+}
+
+}
+
+HistorySample makeHistorySample(std::chrono::system_clock::time_point sampleTime, const AggregatedTelemetry& aggregatedTelemetry,
+                                const std::vector<UnitTelemetry>& unitTelemetries)
+{
+    HistorySample sample;
+    sample.time = sampleTime;
+    sample.aggregated = aggregatedTelemetry;
+    sample.numUnits = static_cast<uint8_t>(std::min(unitTelemetries.size(), HistorySample::MaxUnits));
+    for(size_t i = 0; i < sample.numUnits; ++i)
+    {
+        sample.units[i] = unitPower(unitTelemetries[i]);
+    }
+    return sample;
+}
+
+Downsampler::Downsampler(std::chrono::system_clock::time_point firstParam, std::chrono::system_clock::time_point last, size_t maxSamples)
+: first{firstParam}
+, interval{(last - first) / static_cast<std::chrono::system_clock::rep>(std::max<size_t>(maxSamples, 1)) + std::chrono::system_clock::duration{1}}
+{
+    result.reserve(maxSamples);
+}
+
+void Downsampler::add(const HistorySample& sample)
+{
+    auto const sampleInterval{static_cast<size_t>((sample.time - first) / interval)};
+    if(sampleInterval != currentInterval && numSamples > 0)
+    {
+        emit();
+    }
+    currentInterval = sampleInterval;
+
+    if(numSamples == 0)
+    {
+        intervalStart = sample.time;
+    }
+    timeOffset += std::chrono::duration<double>(sample.time - intervalStart).count();
+    accumulate(aggregated, sample.aggregated);
+    for(size_t i = 0; i < sample.numUnits; ++i)
+    {
+        accumulate(units[i], sample.units[i]);
+        numUnitSamples[i]++;
+    }
+    numUnits = std::max(numUnits, sample.numUnits);
+    numSamples++;
+}
+
+std::vector<HistorySample> Downsampler::finish()
+{
+    if(numSamples > 0)
+    {
+        emit();
+    }
+    return std::move(result);
+}
+
+void Downsampler::emit()
+{
+    auto& sample{result.emplace_back()};
+    sample.time = intervalStart + std::chrono::duration_cast<std::chrono::system_clock::duration>(
+        std::chrono::duration<double>(timeOffset / static_cast<double>(numSamples)));
+    sample.aggregated = divide(aggregated, numSamples);
+    sample.numUnits = numUnits;
+    for(size_t i = 0; i < numUnits; ++i)
+    {
+        sample.units[i] = divide(units[i], numUnitSamples[i]);
+    }
+
+    timeOffset = 0.0;
+    aggregated = {};
+    units = {};
+    numUnitSamples = {};
+    numUnits = 0;
+    numSamples = 0;
+}
+
+TelemetryHistory::TelemetryHistory(const Config& config)
+: samples(config.capacity)
+{
+    if(config.capacity == 0)
+    {
+        throw std::invalid_argument("History capacity must not be 0");
+    }
+}
+
+void TelemetryHistory::add(const HistorySample& sample)
+{
+    std::lock_guard lock{mutex};
+
+    // Like the TimeSeriesStore, samples of a clock that stepped back are dropped to keep the ring sorted
+    if(count > 0 && sample.time <= samples[(next + samples.size() - 1) % samples.size()].time)
+    {
+        return;
+    }
+    samples[next] = sample;
+    next = (next + 1) % samples.size();
+    count = std::min(count + 1, samples.size());
+}
+
+void TelemetryHistory::add(Clock::time_point sampleTime, const AggregatedTelemetry& aggregatedTelemetry,
+                           const std::vector<UnitTelemetry>& unitTelemetries)
+{
+    add(makeHistorySample(sampleTime, aggregatedTelemetry, unitTelemetries));
+}
+
+std::vector<HistorySample> TelemetryHistory::query(Clock::time_point since, Clock::time_point until, size_t maxSamples) const
+{
+    std::vector<HistorySample> result;
+    if(until < since)
+    {
+        return result;
+    }
+
+    std::lock_guard lock{mutex};
+
+    // The ring is sorted by time starting at the oldest sample, binary search the range
+    auto const oldest{(next + samples.size() - count) % samples.size()};
+    auto const at{[&](size_t i) -> const HistorySample& { return samples[(oldest + i) % samples.size()]; }};
+    auto const partitionPoint{[&](auto&& isBefore)
+    {
+        size_t low{0};
+        size_t high{count};
+        while(low < high)
+        {
+            auto const mid{low + (high - low) / 2};
+            if(isBefore(at(mid)))
+            {
+                low = mid + 1;
+            }
+            else
+            {
+                high = mid;
+            }
+        }
+        return low;
+    }};
+    auto const begin{partitionPoint([&](const HistorySample& sample) { return sample.time < since; })};
+    auto const end{partitionPoint([&](const HistorySample& sample) { return sample.time <= until; })};
+
+    if(maxSamples == 0 || end - begin <= maxSamples)
+    {
+        result.reserve(end - begin);
+        for(size_t i = begin; i < end; ++i)
+        {
+            result.push_back(at(i));
+        }
+        return result;
+    }
+
+    Downsampler downsampler{at(begin).time, at(end - 1).time, maxSamples};
+    for(size_t i = begin; i < end; ++i)
+    {
+        downsampler.add(at(i));
+    }
+    return downsampler.finish();
+}
+
+std::optional<TelemetryHistory::Clock::time_point> TelemetryHistory::oldest() const
+{
+    std::lock_guard lock{mutex};
+    if(count == 0)
+    {
+        return std::nullopt;
+    }
+    return samples[(next + samples.size() - count) % samples.size()].time;
+}
+
+size_t TelemetryHistory::size() const
+{
+    std::lock_guard lock{mutex};
+    return count;
+}
+
+}
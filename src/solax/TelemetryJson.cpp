@@ -0,0 +1,316 @@
+#include <solax/TelemetryJson.h>
+#include <solax/TelemetrySchema.h>
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <stdexcept>
+
+namespace solax
+{
+
+namespace
+{
+
+template<typename Number>
+void appendNumber(std::string& out, Number value)
+{
+    if constexpr (std::is_floating_point_v<Number>)
+    {
+        if (!std::isfinite(value))
+        {
+            // JSON knows no NaN or infinity
+            out.append("null");
+            return;
+        }
+    }
+
+    std::array<char, 32> buffer;
+    auto const [end, ec]{std::to_chars(buffer.data(), buffer.data() + buffer.size(), value)};
+    out.append(buffer.data(), end);
+}
+
+void appendString(std::string& out, std::string_view value)
+{
+    out.push_back('"');
+    for (const auto c : value)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out.push_back('\\');
+            out.push_back(c);
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            // Control characters cannot show up in a valid response, drop them instead of escaping
+            continue;
+        }
+        else
+        {
+            out.push_back(c);
+        }
+    }
+    out.push_back('"');
+}
+
+void appendValue(std::string& out, int32_t value) { appendNumber(out, value); }
+void appendValue(std::string& out, float value) { appendNumber(out, value); }
+void appendValue(std::string& out, double value) { appendNumber(out, value); }
+void appendValue(std::string& out, char value) { appendString(out, std::string_view{&value, 1}); }
+void appendValue(std::string& out, const std::string& value) { appendString(out, value); }
+
+template<typename Telemetry, typename Fields>
+void appendObject(std::string& out, const Telemetry& telemetry, const Fields& fields)
+{
+    char separator{'{'};
+    forEachField(fields, [&](const auto& field)
+    {
+        out.push_back(separator);
+        out.append(field.jsonKey);
+        appendValue(out, telemetry.*field.member);
+        separator = ',';
+    });
+    out.push_back('}');
+}
+
+// Only the fields whose bit is set in the selection
+template<typename Telemetry, typename Fields, size_t NumFields>
+void appendObject(std::string& out, const Telemetry& telemetry, const Fields& fields, const std::bitset<NumFields>& selection)
+{
+    out.push_back('{');
+    size_t index{0};
+    bool first{true};
+    forEachField(fields, [&](const auto& field)
+    {
+        if(selection.test(index++))
+        {
+            if(!first)
+            {
+                out.push_back(',');
+            }
+            out.append(field.jsonKey);
+            appendValue(out, telemetry.*field.member);
+            first = false;
+        }
+    });
+    out.push_back('}');
+}
+
+// Sets the bit of the field with the given name, false if there is none
+template<typename Fields, size_t NumFields>
+bool selectField(const Fields& fields, std::string_view name, std::bitset<NumFields>& selection)
+{
+    size_t index{0};
+    bool found{false};
+    forEachField(fields, [&](const auto& field)
+    {
+        if(field.name == name)
+        {
+            selection.set(index);
+            found = true;
+        }
+        index++;
+    });
+    return found;
+}
+
+}
+
+void appendJson(std::string& out, const UnitTelemetry& telemetry)
+{
+    appendObject(out, telemetry, unitTelemetryFields);
+}
+
+void appendJson(std::string& out, const AggregatedTelemetry& telemetry)
+{
+    appendObject(out, telemetry, aggregatedTelemetryFields);
+}
+
+void appendJson(std::string& out, const EnergyTotals& energy)
+{
+    appendObject(out, energy, energyTotalsFields);
+}
+
+void appendJson(std::string& out, const GeneralStatus& status)
+{
+    appendObject(out, status, generalStatusFields);
+}
+
+void appendJson(std::string& out, const Pv2Status& status)
+{
+    appendObject(out, status, pv2StatusFields);
+}
+
+void appendJson(std::string& out, const WarningStatus& status)
+{
+    appendObject(out, status, warningStatusFields);
+}
+
+void appendJson(std::string& out, const DeviceMode& mode)
+{
+    appendObject(out, mode, deviceModeFields);
+}
+
+void appendJson(std::string& out, const DeviceStatus& status)
+{
+    out.append("{\"general\":");
+    appendJson(out, status.general);
+    out.append(",\"pv2\":");
+    appendJson(out, status.pv2);
+    out.append(",\"warnings\":");
+    appendJson(out, status.warnings);
+    out.append(",\"mode\":");
+    appendJson(out, status.mode);
+    out.push_back('}');
+}
+
+void appendJson(std::string& out, const WindowStatistics& statistics)
+{
+    out.append("{\"window\":");
+    appendString(out, statistics.window);
+    out.append(",\"window_s\":");
+    appendNumber(out, statistics.duration.count());
+    out.append(",\"samples\":");
+    appendNumber(out, statistics.numSamples);
+
+    size_t index{0};
+    forEachField(aggregatedTelemetryFields, [&](const auto& field)
+    {
+        out.push_back(',');
+        out.append(field.jsonKey);
+        appendObject(out, statistics.channels[index++], channelStatisticsFields);
+    });
+    out.push_back('}');
+}
+
+void appendJson(std::string& out, const HistorySample& sample)
+{
+    out.append("{\"time_ms\":");
+    appendNumber(out, std::chrono::duration_cast<std::chrono::milliseconds>(sample.time.time_since_epoch()).count());
+    out.append(",\"aggregated\":");
+    appendJson(out, sample.aggregated);
+    out.append(",\"units\":[");
+    for(size_t i = 0; i < sample.numUnits; ++i)
+    {
+        if(i > 0)
+        {
+            out.push_back(',');
+        }
+        appendJson(out, sample.units[i]);
+    }
+    out.append("]}");
+}
+
+void appendJson(std::string& out, const std::vector<HistorySample>& samples)
+{
+    // Roughly the size of a sample of a two unit stack
+    out.reserve(out.size() + 32 + samples.size() * 220);
+    out.append("{\"samples\":[");
+    for(size_t i = 0; i < samples.size(); ++i)
+    {
+        if(i > 0)
+        {
+            out.push_back(',');
+        }
+        appendJson(out, samples[i]);
+    }
+    out.append("]}");
+}
+
+void appendJson(std::string& out, const Rollup& rollup)
+{
+    out.append("{\"time_ms\":");
+    appendNumber(out, std::chrono::duration_cast<std::chrono::milliseconds>(rollup.start.time_since_epoch()).count());
+    out.append(",\"samples\":");
+    appendNumber(out, rollup.count);
+
+    size_t index{0};
+    forEachField(aggregatedTelemetryFields, [&](const auto& field)
+    {
+        const auto& channel{rollup.channels[index++]};
+        out.push_back(',');
+        out.append(field.jsonKey);
+        out.append("{\"min\":");
+        appendNumber(out, channel.min);
+        out.append(",\"max\":");
+        appendNumber(out, channel.max);
+        out.append(",\"mean\":");
+        appendNumber(out, rollup.count > 0 ? channel.sum / rollup.count : std::nan(""));
+        out.append(",\"sum\":");
+        appendNumber(out, channel.sum);
+        out.push_back('}');
+    });
+    out.push_back('}');
+}
+
+void appendJson(std::string& out, const RollupSeries& series)
+{
+    out.reserve(out.size() + 64 + series.rollups.size() * 220);
+    out.append("{\"step_s\":");
+    appendNumber(out, series.step.count());
+    out.append(",\"resolution\":");
+    appendString(out, series.resolution);
+    out.append(",\"buckets\":[");
+    for(size_t i = 0; i < series.rollups.size(); ++i)
+    {
+        if(i > 0)
+        {
+            out.push_back(',');
+        }
+        appendJson(out, series.rollups[i]);
+    }
+    out.append("]}");
+}
+
+FieldSelection parseFieldSelection(std::string_view names)
+{
+    FieldSelection selection;
+    while(!names.empty())
+    {
+        auto const end{std::min(names.find(','), names.size())};
+        auto name{names.substr(0, end)};
+        names.remove_prefix(std::min(end + 1, names.size()));
+
+        while(!name.empty() && name.front() == ' ')
+        {
+            name.remove_prefix(1);
+        }
+        while(!name.empty() && name.back() == ' ')
+        {
+            name.remove_suffix(1);
+        }
+        if(name.empty())
+        {
+            continue;
+        }
+
+        // Both structs may have a member of that name, then it is selected in both
+        auto const inAggregated{selectField(aggregatedTelemetryFields, name, selection.aggregated)};
+        auto const inUnits{selectField(unitTelemetryFields, name, selection.units)};
+        if(!inAggregated && !inUnits)
+        {
+            throw std::invalid_argument("Unknown field " + std::string{name});
+        }
+    }
+    return selection;
+}
+
+void appendJson(std::string& out, const TelemetrySnapshot& snapshot, const FieldSelection& fields)
+{
+    out.append("{\"version\":");
+    appendNumber(out, snapshot.version);
+    out.append(",\"aggregated\":");
+    appendObject(out, snapshot.aggregated, aggregatedTelemetryFields, fields.aggregated);
+    out.append(",\"units\":[");
+    for(size_t i = 0; i < snapshot.units.size(); ++i)
+    {
+        if(i > 0)
+        {
+            out.push_back(',');
+        }
+        appendObject(out, snapshot.units[i], unitTelemetryFields, fields.units);
+    }
+    out.append("]}");
+}
+
+}
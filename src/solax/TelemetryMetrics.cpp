@@ -0,0 +1,233 @@
+#include <solax/TelemetryMetrics.h>
+#include <solax/TelemetrySchema.h>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace solax
+{
+
+namespace
+{
+
+template<typename Number>
+void appendNumber(std::string& out, Number value)
+{
+    if constexpr (std::is_floating_point_v<Number>)
+    {
+        if (std::isnan(value))
+        {
+            out.append("NaN");
+            return;
+        }
+        if (std::isinf(value))
+        {
+            out.append(value > 0 ? "+Inf" : "-Inf");
+            return;
+        }
+    }
+
+    std::array<char, 32> buffer;
+    auto const [end, ec]{std::to_chars(buffer.data(), buffer.data() + buffer.size(), value)};
+    out.append(buffer.data(), end);
+}
+
+// Label values escape backslash, double quote and line feed, other control characters cannot show up in a valid response
+void appendLabelValue(std::string& out, std::string_view value)
+{
+    out.push_back('"');
+    for (const auto c : value)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out.push_back('\\');
+            out.push_back(c);
+        }
+        else if (c == '\n')
+        {
+            out.append("\\n");
+        }
+        else if (static_cast<unsigned char>(c) >= 0x20)
+        {
+            out.push_back(c);
+        }
+    }
+    out.push_back('"');
+}
+
+void appendHeader(std::string& out, std::string_view name, std::string_view type, std::string_view help)
+{
+    out.append("# HELP ");
+    out.append(name);
+    out.push_back(' ');
+    out.append(help);
+    out.append("\n# TYPE ");
+    out.append(name);
+    out.push_back(' ');
+    out.append(type);
+    out.push_back('\n');
+}
+
+template<typename Value>
+constexpr bool isNumeric{std::is_arithmetic_v<Value> && !std::is_same_v<Value, char>};
+
+// Name and pre-rendered HELP and TYPE lines of the gauge of one field
+struct MetricFamily
+{
+    std::string name;
+    std::string header;
+};
+
+template<typename Fields>
+std::vector<MetricFamily> metricFamilies(const Fields& fields, std::string_view prefix, std::string_view help)
+{
+    std::vector<MetricFamily> families;
+    forEachField(fields, [&](const auto& field)
+    {
+        MetricFamily family{std::string{prefix} + metricName(field.name, field.unit), {}};
+        std::string fieldHelp{help};
+        fieldHelp.append(field.name);
+        if (!field.unit.empty())
+        {
+            fieldHelp.append(" in ");
+            fieldHelp.append(field.unit);
+        }
+        appendHeader(family.header, family.name, "gauge", fieldHelp);
+        families.push_back(std::move(family));
+    });
+    return families;
+}
+
+}
+
+std::string metricName(std::string_view member, std::string_view unit)
+{
+    // The unit suffix of the member name is replaced by the base unit spelled out, as Prometheus names it
+    if (auto const suffix{member.rfind('_')}; suffix != std::string_view::npos)
+    {
+        member = member.substr(0, suffix);
+    }
+
+    std::string name;
+    for (const auto c : member)
+    {
+        if (c >= 'A' && c <= 'Z')
+        {
+            if (!name.empty())
+            {
+                name.push_back('_');
+            }
+            name.push_back(static_cast<char>(c - 'A' + 'a'));
+        }
+        else
+        {
+            name.push_back(c);
+        }
+    }
+
+    static constexpr std::array<std::pair<std::string_view, std::string_view>, 6> BaseUnits{{
+        {"V", "volts"}, {"A", "amperes"}, {"W", "watts"}, {"VA", "voltamperes"}, {"Hz", "hertz"}, {"%", "percent"}
+    }};
+    for (const auto& [symbol, baseUnit] : BaseUnits)
+    {
+        if (unit == symbol && !name.ends_with(baseUnit))
+        {
+            name.push_back('_');
+            name.append(baseUnit);
+        }
+    }
+    return name;
+}
+
+void appendMetrics(std::string& out, const TelemetrySnapshot& snapshot)
+{
+    static const auto aggregatedFamilies{metricFamilies(aggregatedTelemetryFields, "solax_", "Summed over all parallel units: ")};
+    static const auto unitFamilies{metricFamilies(unitTelemetryFields, "solax_unit_", "QPGSn field ")};
+
+    appendHeader(out, "solax_telemetry_cycles_total", "counter", "Poll cycles published since the daemon started");
+    out.append("solax_telemetry_cycles_total ");
+    appendNumber(out, snapshot.version);
+    out.push_back('\n');
+
+    size_t index{0};
+    forEachField(aggregatedTelemetryFields, [&](const auto& field)
+    {
+        const auto& family{aggregatedFamilies[index++]};
+        out.append(family.header);
+        out.append(family.name);
+        out.push_back(' ');
+        appendNumber(out, snapshot.aggregated.*field.member);
+        out.push_back('\n');
+    });
+
+    appendHeader(out, "solax_units", "gauge", "Parallel units that answered in the last poll cycle");
+    out.append("solax_units ");
+    appendNumber(out, snapshot.units.size());
+    out.push_back('\n');
+
+    // Unit number as in the REST paths and serial number, shared by all samples of a unit
+    std::vector<std::string> labels;
+    labels.reserve(snapshot.units.size());
+    for (size_t i = 0; i < snapshot.units.size(); ++i)
+    {
+        std::string label{"{unit=\""};
+        appendNumber(label, i + 1);
+        label.append("\",serial_number=");
+        appendLabelValue(label, snapshot.units[i].serialNumber);
+        label.push_back('}');
+        labels.push_back(std::move(label));
+    }
+
+    // Fields that are no numbers are labels of a constant gauge
+    appendHeader(out, "solax_unit_info", "gauge", "Work mode and inverter status bits of a parallel unit");
+    for (size_t i = 0; i < snapshot.units.size(); ++i)
+    {
+        out.append("solax_unit_info");
+        out.append(labels[i], 0, labels[i].size() - 1);
+        out.append(",work_mode=");
+        appendLabelValue(out, std::string_view{&snapshot.units[i].workMode, 1});
+        out.append(",inverter_status=");
+        appendLabelValue(out, snapshot.units[i].inverterStatus);
+        out.append("} 1\n");
+    }
+
+    index = 0;
+    forEachField(unitTelemetryFields, [&](const auto& field)
+    {
+        const auto& family{unitFamilies[index++]};
+        if constexpr (isNumeric<typename std::remove_cvref_t<decltype(field)>::MemberType>)
+        {
+            out.append(family.header);
+            for (size_t i = 0; i < snapshot.units.size(); ++i)
+            {
+                out.append(family.name);
+                out.append(labels[i]);
+                out.push_back(' ');
+                appendNumber(out, snapshot.units[i].*field.member);
+                out.push_back('\n');
+            }
+        }
+    });
+}
+
+void appendMetrics(std::string& out, const TelemetryErrorCounters& errorCounters)
+{
+    appendHeader(out, "solax_telemetry_errors_total", "counter", "Failed inquiries since the daemon started, by kind of error");
+    for (size_t i = 0; i < numTelemetryErrorKinds; ++i)
+    {
+        auto const kind{static_cast<TelemetryErrorKind>(i)};
+        out.append("solax_telemetry_errors_total{kind=\"");
+        for (const auto c : toString(kind))
+        {
+            out.push_back(c == ' ' ? '_' : c);
+        }
+        out.append("\"} ");
+        appendNumber(out, errorCounters[kind]);
+        out.push_back('\n');
+    }
+}
+
+}
@@ -0,0 +1,113 @@
+#include <solax/TelemetrySnapshot.h>
+#include <solax/TelemetryJson.h>
+#include <solax/TelemetryMetrics.h>
+
+namespace solax
+{
+
+namespace
+{
+
+template<typename Telemetry>
+std::vector<std::string> renderEach(const std::vector<Telemetry>& telemetries)
+{
+    std::vector<std::string> result;
+    result.reserve(telemetries.size());
+    for(const auto& telemetry : telemetries)
+    {
+        result.push_back(toJson(telemetry));
+    }
+    return result;
+}
+
+std::string renderAll(const TelemetrySnapshot& snapshot, const SnapshotJson& json)
+{
+    std::string out;
+    out.reserve(64 + json.aggregated.size() + json.units.size() * (json.units.empty() ? 0 : json.units.front().size() + 1));
+    out.append("{\"version\":");
+    out.append(std::to_string(snapshot.version));
+    out.append(",\"aggregated\":");
+    out.append(json.aggregated);
+    out.append(",\"units\":[");
+    for(size_t i = 0; i < json.units.size(); ++i)
+    {
+        if(i > 0)
+        {
+            out.push_back(',');
+        }
+        out.append(json.units[i]);
+    }
+    out.append("]}");
+    return out;
+}
+
+SnapshotJson renderJson(const TelemetrySnapshot& snapshot)
+{
+    SnapshotJson json{
+        .all = {},
+        .aggregated = toJson(snapshot.aggregated),
+        .units = renderEach(snapshot.units),
+        .deviceStatus = toJson(snapshot.deviceStatus),
+        .energyTotals = toJson(snapshot.energyTotals),
+        .unitEnergyTotals = renderEach(snapshot.unitEnergyTotals)
+    };
+    json.all = renderAll(snapshot, json);
+    return json;
+}
+
+std::shared_ptr<const TelemetrySnapshot> initialSnapshot()
+{
+    TelemetrySnapshot snapshot;
+    snapshot.json = renderJson(snapshot);
+    appendMetrics(snapshot.metrics, snapshot);
+    return std::make_shared<const TelemetrySnapshot>(std::move(snapshot));
+}
+
+}
+
+SnapshotPublisher::SnapshotPublisher()
+: current{initialSnapshot()}
+{
+}
+
+std::shared_ptr<const TelemetrySnapshot> SnapshotPublisher::publish(TelemetrySnapshot snapshot)
+{
+    snapshot.version = nextVersion++;
+    snapshot.json = renderJson(snapshot);
+
+    // The text hardly changes in size from one cycle to the next, so it is rendered without growing the buffer
+    snapshot.metrics.reserve(latest()->metrics.size() + 256);
+    appendMetrics(snapshot.metrics, snapshot);
+    auto published{std::make_shared<const TelemetrySnapshot>(std::move(snapshot))};
+    current.store(published, std::memory_order_release);
+
+    // Taking the lock orders the store before a waiter checking the version, so the notification cannot get lost
+    {
+        std::lock_guard lock{waitMutex};
+    }
+    publishCondition.notify_all();
+    return published;
+}
+
+std::shared_ptr<const TelemetrySnapshot> SnapshotPublisher::latest() const
+{
+    return current.load(std::memory_order_acquire);
+}
+
+std::shared_ptr<const TelemetrySnapshot> SnapshotPublisher::waitForNewer(uint64_t version, std::chrono::steady_clock::duration timeout) const
+{
+    std::unique_lock lock{waitMutex};
+    publishCondition.wait_for(lock, timeout, [&]() { return closed || latest()->version > version; });
+    return latest();
+}
+
+void SnapshotPublisher::close()
+{
+    {
+        std::lock_guard lock{waitMutex};
+        closed = true;
+    }
+    publishCondition.notify_all();
+}
+
+}
@@ -0,0 +1,771 @@
+#include <solax/TimeSeriesStore.h>
+#include <solax/Crc.h>
+#include <solax/FileDescriptor.h>
+#include <solax/TelemetrySchema.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace solax
+{
+
+namespace
+{
+
+constexpr size_t PageSize{4096};
+constexpr uint32_t SegmentMagic{0x47535853};                 // "SXSG"
+constexpr uint32_t BlockMagic{0x4b425853};                   // "SXBK"
+constexpr uint16_t FormatVersion{2};                         // 1 stored the columns uncompressed
+
+// Lives in the first page of a segment file, the blocks follow on the next page
+struct SegmentHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t numValueColumns;
+    uint32_t blockSize;
+    uint32_t reserved;
+    uint32_t numSealedBlocks;                                // Full blocks, the next one may be partially filled
+    uint32_t crc;                                            // Over the whole header with crc = 0
+    int64_t minTime_ms;
+    int64_t maxTime_ms;
+};
+
+// Followed by the encoded samples, the time of the first one is minTime_ms
+struct BlockHeader
+{
+    uint32_t magic;
+    uint32_t numRows;
+    int64_t minTime_ms;
+    int64_t maxTime_ms;
+    uint32_t numBits;
+    uint32_t crc;                                            // Over the header with crc = 0 and the first numBits of the payload
+};
+
+constexpr size_t PayloadBits{(TimeSeriesStore::BlockSize - sizeof(BlockHeader)) * 8};
+
+static_assert(TimeSeriesStore::BlockSize % PageSize == 0);
+
+template<typename T>
+T load(const std::byte* data)
+{
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+template<typename T>
+void store(std::byte* data, const T& value)
+{
+    std::memcpy(data, &value, sizeof(T));
+}
+
+template<typename Header>
+uint32_t headerCrc(Header header)
+{
+    header.crc = 0;
+    return crc32(0, reinterpret_cast<const std::byte*>(&header), sizeof(header));
+}
+
+int64_t toMilliseconds(TimeSeriesStore::Clock::time_point time)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+}
+
+// Calls func(column, value) for every value of a sample in column order
+template<typename Sample, typename Func>
+void forEachValue(Sample& sample, Func&& func)
+{
+    size_t column{0};
+    auto const visit{[&](auto& power)
+    {
+        forEachField(aggregatedTelemetryFields, [&](const auto& field) { func(column++, power.*field.member); });
+    }};
+    visit(sample.aggregated);
+    for(auto& unit : sample.units)
+    {
+        visit(unit);
+    }
+}
+
+// One block of a mapped segment
+class Block
+{
+public:
+    explicit Block(std::byte* dataParam) : data{dataParam} {}
+
+    BlockHeader header() const { return load<BlockHeader>(data); }
+    void setHeader(const BlockHeader& header) { store(data, header); }
+
+    std::byte* payload() const { return data + sizeof(BlockHeader); }
+
+    uint32_t crc(const BlockHeader& header) const
+    {
+        // Bits past numBits in the last byte belong to samples written later
+        auto crc{crc32(headerCrc(header), payload(), header.numBits / 8)};
+        if(auto const numTailBits{header.numBits % 8}; numTailBits > 0)
+        {
+            auto const tail{static_cast<std::byte>(static_cast<uint8_t>(payload()[header.numBits / 8]) & (0xff00 >> numTailBits))};
+            crc = crc32(crc, &tail, 1);
+        }
+        return crc;
+    }
+
+    bool valid() const
+    {
+        auto const blockHeader{header()};
+        return blockHeader.magic == BlockMagic && blockHeader.numRows > 0 && blockHeader.numBits <= PayloadBits
+            && blockHeader.crc == crc(blockHeader);
+    }
+
+private:
+    std::byte* data;
+};
+
+size_t blockOffset(size_t block)
+{
+    return PageSize + block * TimeSeriesStore::BlockSize;
+}
+
+std::runtime_error storeError(const std::string& what, const std::filesystem::path& path)
+{
+    return std::runtime_error(what + " " + path.string() + ": " + std::strerror(errno));
+}
+
+}
+
+// A whole segment file mapped into memory
+class TimeSeriesStore::MappedFile
+{
+public:
+    // Creates the file if size is given, opens an existing one otherwise
+    MappedFile(const std::filesystem::path& pathParam, bool writable, size_t size = 0)
+    : path{pathParam}
+    , fd{::open(path.c_str(), writable ? (O_RDWR | O_CLOEXEC | (size > 0 ? O_CREAT | O_EXCL : 0)) : (O_RDONLY | O_CLOEXEC), 0644)}
+    {
+        if(!fd.valid())
+        {
+            throw storeError("Cannot open segment", path);
+        }
+
+        if(size > 0)
+        {
+            // Reserve the space up front, running out of it while writing through the mapping would raise SIGBUS
+            if(auto const error{::posix_fallocate(fd.get(), 0, static_cast<off_t>(size))}; error != 0)
+            {
+                errno = error;
+                throw storeError("Cannot allocate segment", path);
+            }
+        }
+
+        struct stat status;
+        if(::fstat(fd.get(), &status) != 0)
+        {
+            throw storeError("Cannot stat segment", path);
+        }
+        length = static_cast<size_t>(status.st_size);
+        if(length < PageSize + BlockSize)
+        {
+            throw std::runtime_error("Segment " + path.string() + " is truncated");
+        }
+
+        auto* mapping{::mmap(nullptr, length, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd.get(), 0)};
+        if(mapping == MAP_FAILED)
+        {
+            throw storeError("Cannot map segment", path);
+        }
+        bytes = static_cast<std::byte*>(mapping);
+    }
+
+    ~MappedFile()
+    {
+        ::munmap(bytes, length);
+    }
+
+    MappedFile(MappedFile const &) = delete;
+    MappedFile &operator=(MappedFile const &) = delete;
+    MappedFile(MappedFile &&) = delete;
+    MappedFile &operator=(MappedFile &&) = delete;
+
+    std::byte* data() const { return bytes; }
+    size_t numBlocks() const { return (length - PageSize) / BlockSize; }
+
+    // Waits until the given range reached the disk
+    void sync(size_t offset, size_t size)
+    {
+        auto const begin{offset / PageSize * PageSize};
+        if(::msync(bytes + begin, offset + size - begin, MS_SYNC) != 0)
+        {
+            throw storeError("Cannot write segment", path);
+        }
+    }
+
+private:
+    std::filesystem::path path;
+    FileDescriptor fd;
+    std::byte* bytes{nullptr};
+    size_t length{0};
+};
+
+
+namespace
+{
+
+// Bounds the memory taken by samples waiting for the flush interval
+constexpr size_t MaxPendingSamples{4096};
+
+// Worst case size of an encoded sample, a block is full once less is left
+constexpr size_t MaxSampleBits{MaxTimestampBits + MaxIntegerBits + 3 * (1 + HistorySample::MaxUnits) * MaxFloatBits};
+
+bool isFull(size_t numBits)
+{
+    return PayloadBits - numBits < MaxSampleBits;
+}
+
+template<typename State>
+State blockStartState(int64_t minTime_ms)
+{
+    State state{};
+    state.time.previous = minTime_ms;
+    return state;
+}
+
+template<typename State>
+void encodeSample(BitWriter& writer, State& state, const HistorySample& sample)
+{
+    encodeTimestamp(writer, state.time, toMilliseconds(sample.time));
+    encodeInteger(writer, state.numUnits, sample.numUnits);
+    forEachValue(sample, [&](size_t column, float value) { encodeFloat(writer, state.values[column], value); });
+}
+
+template<typename State>
+HistorySample decodeSample(BitReader& reader, State& state)
+{
+    HistorySample sample;
+    sample.time = TimeSeriesStore::Clock::time_point{std::chrono::milliseconds{decodeTimestamp(reader, state.time)}};
+    sample.numUnits = static_cast<uint8_t>(std::clamp<int64_t>(decodeInteger(reader, state.numUnits), 0, HistorySample::MaxUnits));
+    forEachValue(sample, [&](size_t column, float& value) { value = decodeFloat(reader, state.values[column]); });
+    return sample;
+}
+
+}
+
+TimeSeriesStore::TimeSeriesStore(const Config& configParam)
+: config{configParam}
+, lastTime_ms{std::numeric_limits<int64_t>::min()}
+{
+    config.segmentSize = std::max(config.segmentSize / BlockSize * BlockSize, BlockSize) + PageSize;
+
+    std::error_code error;
+    std::filesystem::create_directories(config.path, error);
+    if(error)
+    {
+        throw std::runtime_error("Cannot create history directory " + config.path + ": " + error.message());
+    }
+
+    rollups = std::make_unique<RollupIndex>(config.path);
+    openSegments();
+
+    // Rebuild the rollup buckets that were not complete when the daemon stopped
+    size_t numReplayed{0};
+    forEachSample(toMilliseconds(rollups->resumeTime()), std::numeric_limits<int64_t>::max(), [&](const HistorySample& sample)
+    {
+        rollups->add(sample);
+        numReplayed++;
+    });
+    if(numReplayed > 0)
+    {
+        std::cout << "Rebuilt rollups from " << numReplayed << " history sample(s)" << std::endl;
+    }
+    flushRollups();
+}
+
+TimeSeriesStore::~TimeSeriesStore()
+{
+    try
+    {
+        flush();
+    }
+    catch(const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+    }
+}
+
+void TimeSeriesStore::openSegments()
+{
+    std::vector<std::filesystem::path> paths;
+    for(const auto& entry : std::filesystem::directory_iterator{config.path})
+    {
+        if(entry.is_regular_file() && entry.path().extension() == ".seg")
+        {
+            paths.push_back(entry.path());
+        }
+    }
+    // Named after the time of their first sample, zero padded
+    std::ranges::sort(paths);
+
+    for(const auto& path : paths)
+    {
+        try
+        {
+            MappedFile file{path, false};
+            auto const header{load<SegmentHeader>(file.data())};
+            if(header.magic != SegmentMagic || header.version != FormatVersion || header.numValueColumns != NumValueColumns
+               || header.blockSize != BlockSize)
+            {
+                throw std::runtime_error("Segment " + path.string() + " has an unknown format");
+            }
+
+            // The header is rewritten whenever a block gets full, a torn write makes all blocks to be scanned
+            auto const headerValid{header.crc == headerCrc(header)};
+            Segment segment{
+                .path = path,
+                .minTime_ms = headerValid ? header.minTime_ms : std::numeric_limits<int64_t>::max(),
+                .maxTime_ms = headerValid ? header.maxTime_ms : std::numeric_limits<int64_t>::min(),
+                .numBlocks = headerValid ? std::min<uint32_t>(header.numSealedBlocks, static_cast<uint32_t>(file.numBlocks())) : 0
+            };
+
+            // Pick up the blocks filled since the header was written, up to the first torn or empty one
+            for(auto block{segment.numBlocks}; block < file.numBlocks(); ++block)
+            {
+                Block const view{file.data() + blockOffset(block)};
+                if(!view.valid())
+                {
+                    break;
+                }
+                auto const blockHeader{view.header()};
+                segment.minTime_ms = std::min(segment.minTime_ms, blockHeader.minTime_ms);
+                segment.maxTime_ms = std::max(segment.maxTime_ms, blockHeader.maxTime_ms);
+                segment.numBlocks = block + 1;
+                if(!isFull(blockHeader.numBits))
+                {
+                    break;
+                }
+            }
+
+            if(segment.numBlocks > 0)
+            {
+                segments.push_back(std::move(segment));
+            }
+            else
+            {
+                // Created right before the daemon stopped, holds nothing
+                std::filesystem::remove(path);
+            }
+        }
+        catch(const std::exception& e)
+        {
+            // Keep the file for inspection, the remaining history is still usable
+            std::cerr << "Ignoring history segment: " << e.what() << std::endl;
+        }
+    }
+
+    if(segments.empty())
+    {
+        return;
+    }
+
+    // Continue the last segment, a torn block at its end gets overwritten
+    auto& last{segments.back()};
+    active = std::make_unique<MappedFile>(last.path, true);
+    Block const lastBlock{active->data() + blockOffset(last.numBlocks - 1)};
+    auto const header{lastBlock.header()};
+    if(isFull(header.numBits))
+    {
+        activeBlock = last.numBlocks;
+    }
+    else
+    {
+        // Restore the predictors by decoding the samples of the partially filled block
+        activeBlock = last.numBlocks - 1;
+        activeRows = header.numRows;
+        activeBits = header.numBits;
+        activeState = blockStartState<EncoderState>(header.minTime_ms);
+        BitReader reader{lastBlock.payload(), header.numBits};
+        for(uint32_t row = 0; row < header.numRows; ++row)
+        {
+            decodeSample(reader, activeState);
+        }
+    }
+    lastTime_ms = last.maxTime_ms;
+    writeSegmentHeader();
+
+    std::cout << "Loaded " << segments.size() << " history segment(s)" << std::endl;
+}
+
+void TimeSeriesStore::add(const HistorySample& sample)
+{
+    std::lock_guard lock{mutex};
+
+    auto const time_ms{toMilliseconds(sample.time)};
+    if(time_ms <= lastTime_ms)
+    {
+        return;
+    }
+    lastTime_ms = time_ms;
+    pending.push_back(sample);
+    rollups->add(sample);
+
+    if(pending.size() >= MaxPendingSamples || sample.time - lastFlushTime >= config.flushInterval)
+    {
+        lastFlushTime = sample.time;
+        try
+        {
+            flushPending();
+        }
+        catch(const std::exception& e)
+        {
+            std::cerr << e.what() << " (dropped " << pending.size() << " history samples)" << std::endl;
+            pending.clear();
+        }
+        flushRollups();
+    }
+}
+
+void TimeSeriesStore::flush()
+{
+    std::lock_guard lock{mutex};
+    flushPending();
+    rollups->flush();
+}
+
+void TimeSeriesStore::flushRollups()
+{
+    try
+    {
+        rollups->flush();
+    }
+    catch(const std::exception& e)
+    {
+        std::cerr << e.what() << " (dropped history rollups)" << std::endl;
+    }
+}
+
+void TimeSeriesStore::flushPending()
+{
+    size_t next{0};
+    while(next < pending.size())
+    {
+        if(!active || activeBlock == active->numBlocks())
+        {
+            startSegment(toMilliseconds(pending[next].time));
+        }
+
+        Block block{active->data() + blockOffset(activeBlock)};
+        auto const minTime_ms{activeRows > 0 ? block.header().minTime_ms : toMilliseconds(pending[next].time)};
+        if(activeRows == 0)
+        {
+            activeBits = 0;
+            activeState = blockStartState<EncoderState>(minTime_ms);
+        }
+
+        // Encoded with a copy of the predictors, they only move on once the samples are on disk. After a failed
+        // sync the next flush overwrites the same bits, predicted from the samples the header covers.
+        auto state{activeState};
+        BitWriter writer{block.payload(), PayloadBits, activeBits};
+        auto const first{next};
+        while(next < pending.size() && !isFull(writer.bitsWritten()))
+        {
+            encodeSample(writer, state, pending[next++]);
+        }
+
+        // The samples have to reach the disk before the header that covers them
+        active->sync(blockOffset(activeBlock), BlockSize);
+        BlockHeader header{
+            .magic = BlockMagic,
+            .numRows = activeRows + static_cast<uint32_t>(next - first),
+            .minTime_ms = minTime_ms,
+            .maxTime_ms = toMilliseconds(pending[next - 1].time),
+            .numBits = static_cast<uint32_t>(writer.bitsWritten()),
+            .crc = 0
+        };
+        header.crc = block.crc(header);
+        block.setHeader(header);
+        active->sync(blockOffset(activeBlock), sizeof(BlockHeader));
+        activeRows = header.numRows;
+        activeBits = header.numBits;
+        activeState = state;
+
+        auto& segment{segments.back()};
+        segment.minTime_ms = std::min(segment.minTime_ms, header.minTime_ms);
+        segment.maxTime_ms = header.maxTime_ms;
+        segment.numBlocks = activeBlock + 1;
+
+        if(isFull(activeBits))
+        {
+            activeBlock++;
+            activeRows = 0;
+            activeBits = 0;
+            writeSegmentHeader();
+        }
+    }
+    pending.clear();
+}
+
+void TimeSeriesStore::startSegment(int64_t firstTime_ms)
+{
+    active.reset();
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016lld.seg", static_cast<long long>(firstTime_ms));
+    auto const path{std::filesystem::path{config.path} / name};
+
+    active = std::make_unique<MappedFile>(path, true, config.segmentSize);
+    segments.push_back({
+        .path = path,
+        .minTime_ms = std::numeric_limits<int64_t>::max(),
+        .maxTime_ms = std::numeric_limits<int64_t>::min(),
+        .numBlocks = 0
+    });
+    activeBlock = 0;
+    activeRows = 0;
+    writeSegmentHeader();
+
+    applyRetention(firstTime_ms);
+}
+
+void TimeSeriesStore::writeSegmentHeader()
+{
+    const auto& segment{segments.back()};
+    SegmentHeader header{
+        .magic = SegmentMagic,
+        .version = FormatVersion,
+        .numValueColumns = NumValueColumns,
+        .blockSize = BlockSize,
+        .reserved = 0,
+        .numSealedBlocks = activeBlock,
+        .crc = 0,
+        .minTime_ms = segment.minTime_ms,
+        .maxTime_ms = segment.maxTime_ms
+    };
+    header.crc = headerCrc(header);
+    store(active->data(), header);
+    active->sync(0, sizeof(header));
+}
+
+void TimeSeriesStore::applyRetention(int64_t now_ms)
+{
+    auto const oldest_ms{now_ms - std::chrono::duration_cast<std::chrono::milliseconds>(config.retention).count()};
+    while(segments.size() > 1 && segments.front().maxTime_ms < oldest_ms)
+    {
+        std::error_code error;
+        std::filesystem::remove(segments.front().path, error);
+        if(error)
+        {
+            std::cerr << "Cannot delete history segment " << segments.front().path.string() << ": " << error.message() << std::endl;
+        }
+        segments.erase(segments.begin());
+    }
+}
+
+template<typename Func>
+void TimeSeriesStore::forEachSample(int64_t since_ms, int64_t until_ms, Func&& func) const
+{
+    // Sealed blocks never change, only the list of them and the partially filled block are taken under the lock,
+    // so decoding months of samples does not hold up the acquisition loop
+    std::vector<Segment> sealed;
+    std::vector<std::byte> partialBlock;
+    std::vector<HistorySample> recent;
+    {
+        std::lock_guard lock{mutex};
+        for(const auto& segment : segments)
+        {
+            if(segment.maxTime_ms >= since_ms && segment.minTime_ms <= until_ms)
+            {
+                sealed.push_back(segment);
+            }
+        }
+        if(!sealed.empty() && sealed.back().path == segments.back().path)
+        {
+            sealed.back().numBlocks = activeBlock;
+            if(activeRows > 0)
+            {
+                auto const* block{active->data() + blockOffset(activeBlock)};
+                partialBlock.assign(block, block + BlockSize);
+            }
+        }
+        for(const auto& sample : pending)
+        {
+            auto const time_ms{toMilliseconds(sample.time)};
+            if(time_ms >= since_ms && time_ms <= until_ms)
+            {
+                recent.push_back(sample);
+            }
+        }
+    }
+
+    auto const decode{[&](Block const view, const std::filesystem::path& path, uint32_t block)
+    {
+        auto const header{view.header()};
+        if(header.maxTime_ms < since_ms || header.minTime_ms > until_ms)
+        {
+            return;
+        }
+
+        try
+        {
+            BitReader reader{view.payload(), std::min<size_t>(header.numBits, PayloadBits)};
+            auto state{blockStartState<EncoderState>(header.minTime_ms)};
+            for(uint32_t row = 0; row < header.numRows; ++row)
+            {
+                auto const sample{decodeSample(reader, state)};
+                auto const time_ms{toMilliseconds(sample.time)};
+                if(time_ms > until_ms)
+                {
+                    break;
+                }
+                if(time_ms >= since_ms)
+                {
+                    func(sample);
+                }
+            }
+        }
+        catch(const std::out_of_range& e)
+        {
+            // Damaged after it was indexed, skip the rest of the block
+            std::cerr << "Cannot decode block " << block << " of history segment " << path.string() << ": " << e.what() << std::endl;
+        }
+    }};
+
+    for(const auto& segment : sealed)
+    {
+        if(segment.numBlocks == 0)
+        {
+            continue;
+        }
+
+        // Mapped while they are read, a segment deleted by the retention meanwhile stays readable once it is mapped
+        std::unique_ptr<MappedFile> file;
+        try
+        {
+            file = std::make_unique<MappedFile>(segment.path, false);
+        }
+        catch(const std::runtime_error& e)
+        {
+            std::cerr << e.what() << std::endl;
+            continue;
+        }
+
+        for(uint32_t block = 0; block < std::min<size_t>(segment.numBlocks, file->numBlocks()); ++block)
+        {
+            decode(Block{file->data() + blockOffset(block)}, segment.path, block);
+        }
+    }
+
+    if(!partialBlock.empty())
+    {
+        decode(Block{partialBlock.data()}, sealed.back().path, sealed.back().numBlocks);
+    }
+
+    for(const auto& sample : recent)
+    {
+        func(sample);
+    }
+}
+
+std::vector<HistorySample> TimeSeriesStore::query(Clock::time_point since, Clock::time_point until, size_t maxSamples) const
+{
+    std::vector<HistorySample> result;
+    if(until < since)
+    {
+        return result;
+    }
+    maxSamples = maxSamples == 0 ? MaxQuerySamples : maxSamples;
+
+    // Samples are only averaged if there are too many of them. Blocks are decoded once, so the number of samples
+    // is not known up front, and the intervals span the requested range up to the newest sample.
+    std::optional<Downsampler> downsampler;
+    auto const newest_ms{[&]()
+    {
+        std::lock_guard lock{mutex};
+        return lastTime_ms;
+    }()};
+    auto const last{std::min(until, Clock::time_point{std::chrono::milliseconds{newest_ms}})};
+    forEachSample(toMilliseconds(since), toMilliseconds(until), [&](const HistorySample& sample)
+    {
+        if(downsampler)
+        {
+            downsampler->add(sample);
+            return;
+        }
+
+        result.push_back(sample);
+        if(result.size() > maxSamples)
+        {
+            downsampler.emplace(result.front().time, last, maxSamples);
+            for(const auto& collected : result)
+            {
+                downsampler->add(collected);
+            }
+            result.clear();
+            result.shrink_to_fit();
+        }
+    });
+
+    return downsampler ? downsampler->finish() : result;
+}
+
+RollupSeries TimeSeriesStore::queryRollups(Clock::time_point since, Clock::time_point until, std::chrono::seconds step) const
+{
+    if(step <= std::chrono::seconds::zero())
+    {
+        throw std::invalid_argument("step must be positive");
+    }
+    if(until < since)
+    {
+        return {step, {}, {}};
+    }
+    if(static_cast<size_t>((until - since) / step) >= MaxQuerySamples)
+    {
+        throw std::out_of_range("step is too small for the time range, at most " + std::to_string(MaxQuerySamples) + " buckets are returned");
+    }
+
+    if(auto const level{RollupIndex::levelFor(step)})
+    {
+        // The level files are read outside the lock, adding samples goes on meanwhile
+        std::optional<RollupIndex::LevelSnapshot> snapshot;
+        {
+            std::lock_guard lock{mutex};
+
+            // Finer levels only keep the recent buckets, older ones have to come from the samples if they still exist
+            auto const oldestRollup{rollups->oldest(*level)};
+            auto const samplesReachFurther{oldestRollup && since < *oldestRollup && !segments.empty()
+                && segments.front().minTime_ms < toMilliseconds(*oldestRollup)};
+            if(!samplesReachFurther)
+            {
+                snapshot = rollups->snapshot(*level);
+            }
+        }
+        if(snapshot)
+        {
+            return {step, RollupIndex::Levels[*level].name, snapshot->query(since, until, step)};
+        }
+    }
+
+    // Like the rollup levels, the buckets are complete even if they extend past since or until
+    RollupBuilder builder{step};
+    auto const first{RollupBuilder::bucketStart(since, step)};
+    auto const last{RollupBuilder::bucketStart(until, step) + step - std::chrono::milliseconds{1}};
+    forEachSample(toMilliseconds(first), toMilliseconds(last), [&](const HistorySample& sample)
+    {
+        builder.add(sample);
+    });
+    return {step, "raw", builder.finish()};
+}
+
+size_t TimeSeriesStore::numSegments() const
+{
+    std::lock_guard lock{mutex};
+    return segments.size();
+}
+
+}
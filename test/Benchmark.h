@@ -0,0 +1,115 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace solax::test
+{
+
+// Collects duration samples of one benchmark case and reports their distribution
+class Benchmark final
+{
+public:
+    Benchmark(std::string nameParam) : name{std::move(nameParam)} {}
+
+    void add(std::chrono::nanoseconds sample) { samples.push_back(sample); }
+
+    template<typename Func>
+    void measure(size_t iterations, Func&& func)
+    {
+        samples.reserve(samples.size() + iterations);
+        for(size_t i = 0; i < iterations; ++i)
+        {
+            auto const start{std::chrono::steady_clock::now()};
+            func();
+            add(std::chrono::steady_clock::now() - start);
+        }
+    }
+
+    struct Summary
+    {
+        size_t numSamples{0};
+        std::chrono::nanoseconds min{0};
+        std::chrono::nanoseconds mean{0};
+        std::chrono::nanoseconds p50{0};
+        std::chrono::nanoseconds p99{0};
+        std::chrono::nanoseconds max{0};
+    };
+
+    const std::string& benchmarkName() const { return name; }
+
+    Summary summarize()
+    {
+        if(samples.empty())
+        {
+            return {};
+        }
+
+        std::sort(samples.begin(), samples.end());
+        std::chrono::nanoseconds total{0};
+        for(const auto sample : samples)
+        {
+            total += sample;
+        }
+
+        return {
+            .numSamples = samples.size(),
+            .min = samples.front(),
+            .mean = total / static_cast<int64_t>(samples.size()),
+            .p50 = percentile(0.5),
+            .p99 = percentile(0.99),
+            .max = samples.back()
+        };
+    }
+
+    void report(std::FILE* out = stdout)
+    {
+        if(samples.empty())
+        {
+            std::fprintf(out, "%-40s no samples\n", name.c_str());
+            return;
+        }
+
+        auto const summary{summarize()};
+        std::fprintf(out, "%-40s n=%-6zu min=%10.3f  mean=%10.3f  p50=%10.3f  p99=%10.3f  max=%10.3f [us]\n",
+            name.c_str(), summary.numSamples,
+            toMicroseconds(summary.min),
+            toMicroseconds(summary.mean),
+            toMicroseconds(summary.p50),
+            toMicroseconds(summary.p99),
+            toMicroseconds(summary.max));
+    }
+
+    // One JSON object per benchmark, durations in microseconds
+    std::string json()
+    {
+        auto const summary{summarize()};
+        std::array<char, 512> buffer{};
+        std::snprintf(buffer.data(), buffer.size(),
+            "{\"name\":\"%s\",\"samples\":%zu,\"min_us\":%.3f,\"mean_us\":%.3f,\"p50_us\":%.3f,\"p99_us\":%.3f,\"max_us\":%.3f}",
+            name.c_str(), summary.numSamples,
+            toMicroseconds(summary.min),
+            toMicroseconds(summary.mean),
+            toMicroseconds(summary.p50),
+            toMicroseconds(summary.p99),
+            toMicroseconds(summary.max));
+        return buffer.data();
+    }
+
+private:
+    static double toMicroseconds(std::chrono::nanoseconds d) { return static_cast<double>(d.count()) / 1000.0; }
+
+    std::chrono::nanoseconds percentile(double p) const
+    {
+        auto const index{static_cast<size_t>(p * static_cast<double>(samples.size() - 1) + 0.5)};
+        return samples[index];
+    }
+
+    std::string name;
+    std::vector<std::chrono::nanoseconds> samples;
+};
+
+}
@@ -0,0 +1,254 @@
+#include "InverterSimulator.h"
+#include <solax/Crc.h>
+#include <array>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <poll.h>
+#include <pty.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace solax::test
+{
+
+namespace
+{
+
+void writeAll(int fd, const char* data, size_t size)
+{
+    while(size > 0)
+    {
+        auto const written{::write(fd, data, size)};
+        if(written < 0)
+        {
+            if(errno == EINTR || errno == EAGAIN)
+            {
+                continue;
+            }
+            return;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+}
+
+}
+
+InverterSimulator::InverterSimulator(const Config& configParam)
+: config{configParam}
+, random{configParam.seed}
+{
+    std::array<char, 128> name{};
+    if(::openpty(&masterFd, &slaveFd, name.data(), nullptr, nullptr) != 0)
+    {
+        throw std::runtime_error(std::string("openpty failed: ") + std::strerror(errno));
+    }
+    slavePath = name.data();
+
+    // The slave stays open for the lifetime of the simulator so the master does not see
+    // a hang-up while the adapter closes and reopens the device during probing.
+    termios tty{};
+    ::tcgetattr(slaveFd, &tty);
+    ::cfmakeraw(&tty);
+    ::tcsetattr(slaveFd, TCSANOW, &tty);
+
+    if(::pipe2(stopPipe, O_CLOEXEC) != 0)
+    {
+        ::close(masterFd);
+        ::close(slaveFd);
+        throw std::runtime_error(std::string("pipe failed: ") + std::strerror(errno));
+    }
+
+    worker = std::thread(&InverterSimulator::run, this);
+}
+
+InverterSimulator::~InverterSimulator()
+{
+    writeAll(stopPipe[1], "x", 1);
+    worker.join();
+    ::close(stopPipe[0]);
+    ::close(stopPipe[1]);
+    ::close(slaveFd);
+    ::close(masterFd);
+}
+
+std::string InverterSimulator::qpgsPayload(uint8_t machineIndex, uint8_t numParallelUnits)
+{
+    if(machineIndex < 1 || machineIndex > numParallelUnits)
+    {
+        return "0 00000000000000 L 00 000.0 00.00 000.0 00.00 0000 0000 000 00.0 000 000 000.0 000 00000 00000 000 00000000 0 0 000 000 00 00 000 000.0 00";
+    }
+
+    std::array<char, 160> buffer{};
+    auto const i{static_cast<int>(machineIndex)};
+    std::snprintf(buffer.data(), buffer.size(),
+        "1 9634230410110%d B 00 000.0 00.00 230.%d 50.01 %04d %04d 008 53.5 %03d 093 138.9 041 01496 01445 011 10100110 5 3 100 120 040 %02d 000 143.1 06",
+        i % 10, i % 10, 560 + i, 540 + i, 20 + i, 5 + i);
+    return buffer.data();
+}
+
+std::string InverterSimulator::statusPayload(std::string_view inquiry)
+{
+    if(inquiry == "QPIGS")
+    {
+        return "230.0 50.0 230.0 50.0 0575 0548 011 412 53.50 012 093 0045 09.8 138.9 53.55 00000 00110110 00 00 01361 010 0 00 0000 ";
+    }
+    if(inquiry == "QPIGS2")
+    {
+        return "10.1 143.1 01445 ";
+    }
+    if(inquiry == "QPIWS")
+    {
+        return "100000000001000000000000000000000000";
+    }
+    if(inquiry == "QMOD")
+    {
+        return "B";
+    }
+    return {};
+}
+
+void InverterSimulator::run()
+{
+    std::string command;
+    std::array<char, 64> readBuffer{};
+
+    while(true)
+    {
+        std::array<pollfd, 2> fds{{
+            {.fd = masterFd, .events = POLLIN, .revents = 0},
+            {.fd = stopPipe[0], .events = POLLIN, .revents = 0}
+        }};
+        if(::poll(fds.data(), fds.size(), -1) < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            return;
+        }
+        if(fds[1].revents != 0)
+        {
+            return;
+        }
+        if((fds[0].revents & POLLIN) == 0)
+        {
+            continue;
+        }
+
+        auto const numBytesRead{::read(masterFd, readBuffer.data(), readBuffer.size())};
+        if(numBytesRead <= 0)
+        {
+            continue;
+        }
+
+        for(ssize_t b = 0; b < numBytesRead; ++b)
+        {
+            const char c{readBuffer[static_cast<size_t>(b)]};
+            if(c == '\r')
+            {
+                handleCommand(command);
+                command.clear();
+            }
+            else if(c != '\n')
+            {
+                command.push_back(c);
+            }
+        }
+    }
+}
+
+void InverterSimulator::handleCommand(const std::string& command)
+{
+    commandsReceived++;
+
+    // Receiving the command occupies the line as well: start, 8 data and stop bit per byte
+    auto delay{config.responseDelay};
+    if(config.baudRate > 0)
+    {
+        delay += std::chrono::microseconds{(command.size() + 1) * 10'000'000 / config.baudRate};
+    }
+    if(config.jitter.count() > 0)
+    {
+        std::uniform_int_distribution<int64_t> jitterDistribution{0, config.jitter.count()};
+        delay += std::chrono::microseconds{jitterDistribution(random)};
+    }
+    std::this_thread::sleep_for(delay);
+
+    // Like the inverter, reject commands with a wrong CRC
+    if(command.size() < 2 || crc16(std::string_view{command}.substr(0, command.size() - 2)) !=
+        ((static_cast<uint8_t>(command[command.size() - 2]) << 8) | static_cast<uint8_t>(command.back())))
+    {
+        send("NAK");
+        return;
+    }
+
+    const std::string_view body{std::string_view{command}.substr(0, command.size() - 2)};
+    if(body.starts_with("QPGS") && body.size() > 4)
+    {
+        int machineIndex{0};
+        for(const auto c : body.substr(4))
+        {
+            machineIndex = machineIndex * 10 + (c - '0');
+        }
+        send(qpgsPayload(static_cast<uint8_t>(machineIndex), config.numParallelUnits));
+        return;
+    }
+
+    auto const payload{statusPayload(body)};
+    if(!payload.empty() && (config.supportsPv2 || body != "QPIGS2"))
+    {
+        send(payload);
+        return;
+    }
+
+    send("NAK");
+}
+
+void InverterSimulator::send(const std::string& payload)
+{
+    std::string frame{"(" + payload};
+    auto const crc{crc16(frame)};
+    frame.push_back(static_cast<char>(crc >> 8));
+    frame.push_back(static_cast<char>(crc & 0xff));
+    frame.push_back('\r');
+
+    responsesSent++;
+    if(config.loseEveryNthResponse > 0 && responsesSent % config.loseEveryNthResponse == 0)
+    {
+        return;
+    }
+    if(config.corruptEveryNthResponse > 0 && responsesSent % config.corruptEveryNthResponse == 0)
+    {
+        // Flip a payload bit the way a line error would
+        frame[frame.size() / 2] ^= 0x04;
+    }
+    if(config.delayEveryNthResponse > 0 && responsesSent % config.delayEveryNthResponse == 0)
+    {
+        // Arrives after the adapter gave up on it, the commands sent meanwhile are answered afterwards
+        std::this_thread::sleep_for(config.lateResponseDelay);
+    }
+
+    std::bernoulli_distribution dropByte{config.dropByteProbability};
+    auto const byteDuration{config.baudRate > 0 ? std::chrono::microseconds{10'000'000 / config.baudRate} : std::chrono::microseconds{0}};
+    auto nextByteTime{std::chrono::steady_clock::now()};
+
+    for(const auto c : frame)
+    {
+        if(byteDuration.count() > 0)
+        {
+            nextByteTime += byteDuration;
+            std::this_thread::sleep_until(nextByteTime);
+        }
+        if(config.dropByteProbability > 0.0 && dropByte(random))
+        {
+            continue;
+        }
+        writeAll(masterFd, &c, 1);
+    }
+}
+
+}
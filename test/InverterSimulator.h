@@ -0,0 +1,67 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace solax::test
+{
+
+// Emulates a CDP ES-6548 SOLAX inverter (or a stack of parallel units) behind a pseudo terminal.
+// Point SerialAdapter::Config::devicePaths at devicePath() to talk to it without hardware.
+class InverterSimulator final
+{
+public:
+    struct Config
+    {
+        uint8_t numParallelUnits{1};
+        uint32_t baudRate{2400};                             // Line speed used to pace responses, 0 disables pacing
+        std::chrono::microseconds responseDelay{0};          // Processing time of the inverter before it answers
+        std::chrono::microseconds jitter{0};                 // Additional uniformly distributed delay per response
+        double dropByteProbability{0.0};                     // Probability that a single response byte gets lost
+        uint32_t corruptEveryNthResponse{0};                 // Flips a bit in every nth response, 0 disables corruption
+        uint32_t loseEveryNthResponse{0};                    // Swallows every nth response completely, 0 disables losses
+        uint32_t delayEveryNthResponse{0};                   // Holds every nth response back by lateResponseDelay, 0 disables delays
+        std::chrono::microseconds lateResponseDelay{0};
+        bool supportsPv2{true};                              // Answers QPIGS2 like a 48V model, otherwise rejects it with NAK
+        uint32_t seed{42};
+    };
+
+    InverterSimulator(const Config& config);
+    ~InverterSimulator();
+
+    InverterSimulator(InverterSimulator const &) = delete;
+    InverterSimulator &operator=(InverterSimulator const &) = delete;
+    InverterSimulator(InverterSimulator &&) = delete;
+    InverterSimulator &operator=(InverterSimulator &&) = delete;
+
+    const std::string& devicePath() const { return slavePath; }
+
+    uint64_t numCommandsReceived() const { return commandsReceived; }
+
+    // Builds the QPGSn payload (without start byte, CRC and terminator) the simulator answers with
+    static std::string qpgsPayload(uint8_t machineIndex, uint8_t numParallelUnits);
+
+    // Payload of the single unit status inquiries QPIGS, QPIGS2, QPIWS and QMOD, empty for any other inquiry
+    static std::string statusPayload(std::string_view inquiry);
+
+private:
+    void run();
+    void handleCommand(const std::string& command);
+    void send(const std::string& payload);
+
+    Config config;
+    int masterFd{-1};
+    int slaveFd{-1};
+    int stopPipe[2]{-1, -1};
+    std::string slavePath;
+    std::mt19937 random;
+    std::atomic<uint64_t> commandsReceived{0};
+    uint64_t responsesSent{0};
+    std::thread worker;
+};
+
+}
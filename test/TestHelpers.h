@@ -0,0 +1,58 @@
+#pragma once
+#include <solax/TelemetryHistory.h>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <unistd.h>
+
+namespace solax::test
+{
+
+// Path below the temporary directory, unique per test process. Whatever was created there is removed on destruction.
+struct TemporaryPath
+{
+    explicit TemporaryPath(const std::string& name)
+    : path{std::filesystem::temp_directory_path() / (name + "_" + std::to_string(::getpid()))}
+    {
+        std::filesystem::remove_all(path);
+    }
+
+    ~TemporaryPath()
+    {
+        std::error_code error;
+        std::filesystem::remove_all(path, error);
+    }
+
+    TemporaryPath(TemporaryPath const &) = delete;
+    TemporaryPath &operator=(TemporaryPath const &) = delete;
+
+    std::filesystem::path path;
+};
+
+// Empty directory below the temporary directory, removed with its content on destruction
+struct TemporaryDirectory : TemporaryPath
+{
+    explicit TemporaryDirectory(const std::string& name)
+    : TemporaryPath{name}
+    {
+        std::filesystem::create_directories(path);
+    }
+};
+
+// Midnight UTC, far enough from the epoch that histories reaching back days stay positive
+inline auto const HistoryStart{TelemetryHistory::Clock::time_point{} + std::chrono::hours{24 * 365 * 50}};
+
+// Sample i of a synthetic history of two units, one sample every interval starting at HistoryStart.
+// Solar power rises with i, the battery discharges by the same amount.
+inline HistorySample historySample(int i, std::chrono::seconds interval = std::chrono::seconds{1})
+{
+    HistorySample result;
+    result.time = HistoryStart + interval * i;
+    result.aggregated = {.solarPower_W = static_cast<float>(i), .acPower_W = 500.0f, .batteryPower_W = -static_cast<float>(i)};
+    result.numUnits = 2;
+    result.units[0] = {.solarPower_W = 0.5f * static_cast<float>(i), .acPower_W = 250.0f, .batteryPower_W = 0.0f};
+    result.units[1] = {.solarPower_W = 0.5f * static_cast<float>(i), .acPower_W = 250.0f, .batteryPower_W = 1.5f};
+    return result;
+}
+
+}
@@ -0,0 +1,283 @@
+/**
+ * Benchmark suite of the acquisition and serving path, meant to catch regressions on the target before deploying.
+ *
+ * Usage: ./bench [--json <file>] [--iterations <n>] [--cycles <n>] [--baud-rate <baud>] [--port <port>]
+ *   Prints a human readable table and writes the results as JSON to <file> (default: bench.json).
+ *   --baud-rate paces the simulated inverter in the end-to-end cycle, 0 (default) measures the software overhead only.
+ *   --port selects the local port the REST service listens on while benchmarking, 0 picks a free one.
+ */
+
+#include <solax/ParallelTopology.h>
+#include <solax/RollingStatistics.h>
+#include <solax/SerialAdapter.h>
+#include <solax/Telemetry.h>
+#include <solax/TelemetryHistory.h>
+#include <solax/TimeSeriesStore.h>
+#include <solax/TelemetryJson.h>
+#include "RestService.h"
+#include "InverterSimulator.h"
+#include "Benchmark.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using namespace solax;
+
+namespace
+{
+
+struct Options
+{
+    std::string jsonPath{"bench.json"};
+    size_t iterations{100000};
+    size_t cycles{200};
+    uint32_t baudRate{0};
+    uint16_t port{0};
+};
+
+Options parseOptions(int argc, char* argv[])
+{
+    Options options;
+    for(int i = 1; i + 1 < argc; i += 2)
+    {
+        const std::string_view option{argv[i]};
+        const char* value{argv[i + 1]};
+        if(option == "--json")
+        {
+            options.jsonPath = value;
+        }
+        else if(option == "--iterations")
+        {
+            options.iterations = static_cast<size_t>(std::atoll(value));
+        }
+        else if(option == "--cycles")
+        {
+            options.cycles = static_cast<size_t>(std::atoll(value));
+        }
+        else if(option == "--baud-rate")
+        {
+            options.baudRate = static_cast<uint32_t>(std::atoi(value));
+        }
+        else if(option == "--port")
+        {
+            options.port = static_cast<uint16_t>(std::atoi(value));
+        }
+        else
+        {
+            std::fprintf(stderr, "Unknown option %s\n", argv[i]);
+            std::exit(1);
+        }
+    }
+    return options;
+}
+
+// QPGSn responses of a stack of parallel units as SerialAdapter::query returns them, CRC bytes included
+std::vector<std::string> qpgsResponses(uint8_t numParallelUnits)
+{
+    std::vector<std::string> responses;
+    for(uint8_t i = 1; i <= numParallelUnits; ++i)
+    {
+        responses.push_back(test::InverterSimulator::qpgsPayload(i, numParallelUnits) + "xx");
+    }
+    return responses;
+}
+
+// Keeps the optimizer from dropping the measured work
+template<typename T>
+void consume(const T& value)
+{
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    const auto options{parseOptions(argc, argv)};
+    std::vector<test::Benchmark> benchmarks;
+
+    auto const run{[&](std::string name, size_t iterations, auto&& func)
+    {
+        auto& benchmark{benchmarks.emplace_back(std::move(name))};
+        benchmark.measure(iterations, func);
+        benchmark.report();
+    }};
+
+    // Parsing
+    const auto qpgsResponse{qpgsResponses(1).front()};
+    const auto qpigsResponse{test::InverterSimulator::statusPayload("QPIGS") + "xx"};
+    run("parseRawTelemetry", options.iterations, [&]() { consume(parseRawTelemetry(qpgsResponse).value()); });
+    run("parseGeneralStatus", options.iterations, [&]() { consume(parseGeneralStatus(qpigsResponse).value()); });
+
+    // Aggregation over every supported stack size
+    for(uint8_t numUnits = 1; numUnits <= 9; ++numUnits)
+    {
+        std::vector<UnitTelemetry> units;
+        for(const auto& response : qpgsResponses(numUnits))
+        {
+            units.push_back(parseRawTelemetry(response).value());
+        }
+        run("aggregateTelemetry/" + std::to_string(numUnits), options.iterations, [&]() { consume(aggregateTelemetry(units)); });
+    }
+
+    // Serialization
+    const auto unit{parseRawTelemetry(qpgsResponse).value()};
+    const auto aggregated{aggregateTelemetry({unit})};
+    const DeviceStatus deviceStatus{
+        .general = parseGeneralStatus(qpigsResponse).value(),
+        .pv2 = parsePv2Status(test::InverterSimulator::statusPayload("QPIGS2") + "xx").value(),
+        .warnings = parseWarningStatus(test::InverterSimulator::statusPayload("QPIWS") + "xx").value(),
+        .mode = parseDeviceMode(test::InverterSimulator::statusPayload("QMOD") + "xx").value()
+    };
+    run("toJson/UnitTelemetry", options.iterations, [&]() { consume(toJson(unit)); });
+    run("toJson/AggregatedTelemetry", options.iterations, [&]() { consume(toJson(aggregated)); });
+    run("toJson/DeviceStatus", options.iterations, [&]() { consume(toJson(deviceStatus)); });
+
+    // Rolling statistics, one sample per second
+    TelemetryStatistics telemetryStatistics;
+    auto sampleTime{TelemetryStatistics::Clock::now()};
+    run("TelemetryStatistics::add", options.iterations, [&]()
+    {
+        sampleTime += std::chrono::seconds{1};
+        telemetryStatistics.add(sampleTime, aggregated);
+        telemetryStatistics.add(sampleTime, unit);
+    });
+
+    // History of an hour at one sample per second
+    TelemetryHistory telemetryHistory{{.capacity = 3600}};
+    const std::vector<UnitTelemetry> historyUnits{unit, unit};
+    auto historyTime{TelemetryHistory::Clock::now()};
+    run("TelemetryHistory::add", options.iterations, [&]()
+    {
+        historyTime += std::chrono::seconds{1};
+        telemetryHistory.add(historyTime, aggregated, historyUnits);
+    });
+
+    // On-disk history, written into a temporary directory
+    {
+        const auto storePath{std::filesystem::temp_directory_path() / "solax_bench_store"};
+        std::filesystem::remove_all(storePath);
+        {
+            TimeSeriesStore store{{.path = storePath.string()}};
+            const auto sample{makeHistorySample(TimeSeriesStore::Clock::now(), aggregated, historyUnits)};
+            auto storeSample{sample};
+            run("TimeSeriesStore::add", options.iterations, [&]()
+            {
+                storeSample.time += std::chrono::seconds{1};
+                store.add(storeSample);
+            });
+            store.flush();
+
+            const auto since{storeSample.time - std::chrono::hours{1}};
+            run("TimeSeriesStore::query/1h", options.iterations / 1000, [&]() { consume(store.query(since, storeSample.time)); });
+            run("TimeSeriesStore::query/all/100", options.iterations / 1000, [&]() { consume(store.query(sample.time, storeSample.time, 100)); });
+            run("TimeSeriesStore::queryRollups/1h", options.iterations / 100, [&]() { consume(store.queryRollups(sample.time, storeSample.time, std::chrono::hours{1})); });
+            run("TimeSeriesStore::queryRollups/15s", options.iterations / 1000, [&]() { consume(store.queryRollups(since, storeSample.time, std::chrono::seconds{15})); });
+        }
+        std::filesystem::remove_all(storePath);
+    }
+
+    // Serving, without the network round-trip
+    TelemetryErrorCounters errorCounters;
+    RestService restService{{.address = "127.0.0.1", .port = options.port}, telemetryStatistics, telemetryHistory, nullptr, errorCounters};
+    std::vector<UnitTelemetry> units;
+    for(const auto& response : qpgsResponses(2))
+    {
+        units.push_back(parseRawTelemetry(response).value());
+    }
+    // Counters of a few months, one entry per unit like the EnergyIntegrator reports them
+    const EnergyTotals unitEnergy{.solar_kWh = 1234.567, .load_kWh = 987.654, .batteryCharge_kWh = 321.098, .batteryDischarge_kWh = 298.765};
+    const std::vector<EnergyTotals> unitEnergyTotals(units.size(), unitEnergy);
+    const EnergyTotals energyTotals{
+        .solar_kWh = unitEnergy.solar_kWh * static_cast<double>(units.size()),
+        .load_kWh = unitEnergy.load_kWh * static_cast<double>(units.size()),
+        .batteryCharge_kWh = unitEnergy.batteryCharge_kWh * static_cast<double>(units.size()),
+        .batteryDischarge_kWh = unitEnergy.batteryDischarge_kWh * static_cast<double>(units.size())
+    };
+    restService.updateTelemetry(aggregateTelemetry(units), units, deviceStatus, energyTotals, unitEnergyTotals);
+
+    for(const auto* path : {"aggregated", "1", "all", "status", "energy", "invalid"})
+    {
+        const std::vector<utility::string_t> paths{path};
+        run(std::string{"respond/"} + path, options.iterations, [&]() { consume(restService.respond(paths)); });
+    }
+    {
+        const std::vector<utility::string_t> paths{"1", "energy"};
+        run("respond/1/energy", options.iterations, [&]() { consume(restService.respond(paths)); });
+    }
+    {
+        // Revalidation by a client that already has the latest snapshot
+        const std::vector<utility::string_t> paths{"aggregated"};
+        const auto etag{restService.respond(paths).etag};
+        run("respond/aggregated/304", options.iterations, [&]() { consume(restService.respond(paths, {}, etag)); });
+    }
+    {
+        const std::vector<utility::string_t> paths{"all"};
+        const RestService::QueryParameters queryParameters{{"fields", "solarPower_W,batteryVoltage_V"}};
+        run("respond/all/fields", options.iterations, [&]() { consume(restService.respond(paths, queryParameters)); });
+    }
+    run("respondMetrics", options.iterations, [&]() { consume(restService.respondMetrics()); });
+    {
+        const std::vector<utility::string_t> paths{"aggregated", "stats"};
+        const RestService::QueryParameters queryParameters{{"window", "1h"}};
+        run("respond/aggregated/stats", options.iterations, [&]() { consume(restService.respond(paths, queryParameters)); });
+    }
+    {
+        // The history lies in the future of the wall clock, ask for all of it
+        const std::vector<utility::string_t> paths{"history"};
+        const auto until{std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(historyTime.time_since_epoch()).count())};
+        for(const auto* points : {"0", "100"})
+        {
+            const RestService::QueryParameters queryParameters{{"until", until}, {"points", points}};
+            run(std::string{"respond/history/"} + points, options.iterations / 100, [&]() { consume(restService.respond(paths, queryParameters)); });
+        }
+    }
+
+    // End-to-end poll cycle against the simulated inverter: query, parse, aggregate, publish, serve
+    {
+        test::InverterSimulator::Config simulatorConfig;
+        simulatorConfig.numParallelUnits = 2;
+        simulatorConfig.baudRate = options.baudRate;
+        test::InverterSimulator simulator(simulatorConfig);
+
+        SerialAdapter::Config adapterConfig;
+        adapterConfig.devicePaths = {simulator.devicePath()};
+        SerialAdapter serialAdapter{adapterConfig};
+
+        std::vector<UnitTelemetry> unitTelemetries;
+        ParallelTopology topology{[&](uint8_t machineIndex) { return parseResponse(serialAdapter.readRawTelemetry(machineIndex), parseRawTelemetry); }};
+        topology.poll(unitTelemetries);
+
+        const std::vector<utility::string_t> paths{"aggregated"};
+        run("cycle/" + std::to_string(options.baudRate) + "baud", options.cycles, [&]()
+        {
+            topology.poll(unitTelemetries);
+            restService.updateTelemetry(aggregateTelemetry(unitTelemetries), unitTelemetries, deviceStatus, energyTotals, unitEnergyTotals);
+            consume(restService.respond(paths));
+        });
+    }
+
+    std::string json{"{\"benchmarks\":["};
+    for(auto& benchmark : benchmarks)
+    {
+        json += benchmark.json();
+        json += ',';
+    }
+    json.back() = ']';
+    json += "}\n";
+
+    std::FILE* out{std::fopen(options.jsonPath.c_str(), "w")};
+    if(out == nullptr)
+    {
+        std::fprintf(stderr, "Unable to open %s: %s\n", options.jsonPath.c_str(), std::strerror(errno));
+        return 1;
+    }
+    std::fputs(json.c_str(), out);
+    std::fclose(out);
+    return 0;
+}
@@ -0,0 +1,90 @@
+/**
+ * Microbenchmark of the QPGSn parser against the previous std::istringstream based implementation.
+ *
+ * Usage: ./bench_parse [iterations]
+ */
+
+#include <solax/Telemetry.h>
+#include "Benchmark.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <sstream>
+
+using namespace solax;
+
+namespace
+{
+
+std::atomic<uint64_t> numAllocations{0};
+
+const std::string_view solaxOutput = 
+"1 96342304101107 B 00 000.0 00.00 110.3 60.01 0569 0548 008 53.5 022 093 138.9 041 01496 01445 011 10100110 5 3 100 120 040 06 000 143.1 06\x8bk";
+
+// The parser as it was before switching to std::from_chars, kept as baseline
+UnitTelemetry legacyParseRawTelemetry(const std::string& rawTelemetry)
+{
+    UnitTelemetry ut;
+    std::string data = rawTelemetry;
+    if (data.size() >= 2) {
+        data = data.substr(0, data.size() - 2);
+    }
+
+    std::istringstream iss{data};
+    iss >> ut.parallelNum >> ut.serialNumber >> ut.workMode >> ut.faultCode
+        >> ut.gridVoltage_V >> ut.gridFrequency_Hz >> ut.acOutputVoltage_V >> ut.acOutputFrequency_Hz
+        >> ut.acOutputApparentPower_VA >> ut.acOutputActivePower_W >> ut.loadPercent
+        >> ut.batteryVoltage_V >> ut.batteryChargingCurrent_A >> ut.batteryCapacity_pct
+        >> ut.pv1InputVoltage_V >> ut.totalChargingCurrent_A >> ut.totalAcOutputApparentPower_VA
+        >> ut.totalOutputActivePower_W >> ut.totalAcOutputPercent >> ut.inverterStatus
+        >> ut.outputMode >> ut.chargerSourcePriority >> ut.maxChargerCurrent_A >> ut.maxChargerRange_A
+        >> ut.maxAcChargerCurrent_A >> ut.pv1InputCurrent_A >> ut.batteryDischargeCurrent_A
+        >> ut.pv2InputVoltage_V >> ut.pv2InputCurrent_A;
+    return ut;
+}
+
+template<typename Parser>
+void run(const char* name, size_t iterations, Parser&& parser)
+{
+    test::Benchmark benchmark{name};
+    int32_t checksum{0};
+    auto const allocationsBefore{numAllocations.load()};
+
+    benchmark.measure(iterations, [&]()
+    {
+        auto const ut{parser()};
+        checksum += ut.acOutputActivePower_W;
+    });
+
+    auto const allocations{numAllocations.load() - allocationsBefore};
+    benchmark.report();
+    std::cout << "    allocations per frame: " << static_cast<double>(allocations) / static_cast<double>(iterations)
+              << " (checksum " << checksum << ")" << std::endl;
+}
+
+}
+
+void* operator new(std::size_t size)
+{
+    numAllocations++;
+    if(void* ptr = std::malloc(size))
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+int main(int argc, char* argv[])
+{
+    const size_t iterations{argc > 1 ? static_cast<size_t>(std::atoll(argv[1])) : 100000};
+    const std::string frame{solaxOutput};
+
+    run("parseRawTelemetry (from_chars)", iterations, [&]() { return parseRawTelemetry(solaxOutput).value(); });
+    run("parseRawTelemetry (istringstream)", iterations, [&]() { return legacyParseRawTelemetry(frame); });
+    return 0;
+}
@@ -0,0 +1,62 @@
+/**
+ * Measures the serial acquisition path against the pseudo terminal inverter simulator.
+ *
+ * Usage: ./bench_serial_adapter [num_parallel_units] [baud_rate] [num_cycles]
+ *   baud_rate 0 disables line pacing to measure the software overhead only.
+ */
+
+#include <solax/SerialAdapter.h>
+#include <solax/Telemetry.h>
+#include <solax/ParallelTopology.h>
+#include "InverterSimulator.h"
+#include "Benchmark.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+
+using namespace solax;
+
+int main(int argc, char* argv[])
+{
+    test::InverterSimulator::Config simulatorConfig;
+    simulatorConfig.numParallelUnits = static_cast<uint8_t>(argc > 1 ? std::atoi(argv[1]) : 2);
+    simulatorConfig.baudRate = static_cast<uint32_t>(argc > 2 ? std::atoi(argv[2]) : 2400);
+    const int numCycles{argc > 3 ? std::atoi(argv[3]) : 10};
+
+    test::InverterSimulator simulator(simulatorConfig);
+
+    SerialAdapter::Config adapterConfig;
+    adapterConfig.devicePaths = {simulator.devicePath()};
+
+    std::cout << "Simulating " << static_cast<int>(simulatorConfig.numParallelUnits) << " unit(s) at "
+              << simulatorConfig.baudRate << " baud on " << simulator.devicePath() << std::endl;
+
+    test::Benchmark probe{"probe"};
+    std::optional<SerialAdapter> serialAdapter;
+    for(int i = 0; i < 3; ++i)
+    {
+        serialAdapter.reset();
+        auto const start{std::chrono::steady_clock::now()};
+        serialAdapter.emplace(adapterConfig);
+        probe.add(std::chrono::steady_clock::now() - start);
+    }
+
+    test::Benchmark roundTrip{"QPGS1 round-trip"};
+    roundTrip.measure(static_cast<size_t>(numCycles), [&]() { serialAdapter->readRawTelemetry(1); });
+
+    test::Benchmark cycle{"poll cycle"};
+    std::vector<UnitTelemetry> unitTelemetries;
+    ParallelTopology topology{[&](uint8_t machineIndex) { return parseResponse(serialAdapter->readRawTelemetry(machineIndex), parseRawTelemetry); }};
+    topology.poll(unitTelemetries);
+    cycle.measure(static_cast<size_t>(numCycles), [&]()
+    {
+        topology.poll(unitTelemetries);
+        aggregateTelemetry(unitTelemetries);
+    });
+
+    probe.report();
+    roundTrip.report();
+    cycle.report();
+    return 0;
+}
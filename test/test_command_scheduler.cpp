@@ -0,0 +1,119 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include <solax/CommandScheduler.h>
+
+#include <string>
+#include <vector>
+
+using namespace solax;
+using namespace std::chrono_literals;
+using Catch::Matchers::WithinAbs;
+
+namespace {
+
+// Simulated time which only advances while a command occupies the line
+struct FakeClock {
+    CommandScheduler::Clock::time_point now{};
+
+    CommandScheduler::TimeSource source() { return [this]() { return now; }; }
+};
+
+CommandScheduler::Command command(std::vector<std::string>& log, FakeClock& clock, std::string name,
+                                  std::chrono::milliseconds period, int32_t priority, std::chrono::milliseconds duration) {
+    return CommandScheduler::Command{
+        .name = name,
+        .period = period,
+        .priority = priority,
+        .lineBytes = static_cast<size_t>(duration.count()) * 240 / 1000, // 240 bytes per second at 2400 baud
+        .execute = [&log, &clock, name, duration]() {
+            log.push_back(name);
+            clock.now += duration;
+        }
+    };
+}
+
+} // anonymous namespace
+
+SCENARIO( "Commands share the serial line according to their rate and priority", "[solax::scheduler]" ) 
+{
+    FakeClock clock;
+    std::vector<std::string> log;
+    CommandScheduler scheduler{{.baudRate = 2400, .cycleInterval = 1000ms}, clock.source()};
+
+    SECTION("Per-cycle commands run every cycle, periodic ones at their rate")
+    {
+        scheduler.add(command(log, clock, "QPGSn", 0ms, 100, 400ms));
+        scheduler.add(command(log, clock, "QPIWS", 2000ms, 10, 100ms));
+
+        for(int cycle = 0; cycle < 6; ++cycle)
+        {
+            scheduler.runCycle();
+        }
+
+        CHECK( log == std::vector<std::string>{"QPGSn", "QPIWS", "QPGSn", "QPGSn", "QPGSn", "QPGSn", "QPGSn", "QPIWS"} );
+    }
+
+    SECTION("Higher priority commands are served first")
+    {
+        scheduler.add(command(log, clock, "QET", 60000ms, 1, 100ms));
+        scheduler.add(command(log, clock, "QPIWS", 5000ms, 10, 100ms));
+        scheduler.add(command(log, clock, "QPGSn", 0ms, 100, 100ms));
+
+        scheduler.runCycle();
+
+        CHECK( log == std::vector<std::string>{"QPGSn", "QPIWS", "QET"} );
+    }
+
+    SECTION("Periodic commands exceeding the cycle budget are deferred but do not starve")
+    {
+        scheduler.add(command(log, clock, "QPGSn", 0ms, 100, 900ms));
+        scheduler.add(command(log, clock, "QET", 1000ms, 1, 300ms));
+
+        scheduler.runCycle();
+        CHECK( log == std::vector<std::string>{"QPGSn"} );
+
+        scheduler.runCycle();
+        CHECK( log == std::vector<std::string>{"QPGSn", "QPGSn", "QET"} );
+
+        auto const statistics{scheduler.statistics()};
+        REQUIRE( statistics.size() == 2 );
+        CHECK( statistics[1].name == "QET" );
+        CHECK( statistics[1].executions == 1 );
+        CHECK( statistics[1].deferrals == 1 );
+    }
+
+    SECTION("Line utilization reports schedules that cannot fit")
+    {
+        scheduler.add(command(log, clock, "QPGSn", 0ms, 100, 600ms));
+        scheduler.add(command(log, clock, "QPIWS", 1000ms, 10, 200ms));
+        scheduler.runCycle();
+        CHECK_THAT( scheduler.lineUtilization(), WithinAbs(0.8, 0.001) );
+
+        scheduler.add(command(log, clock, "QET", 1000ms, 1, 400ms));
+        scheduler.runCycle();
+        CHECK( scheduler.lineUtilization() > 1.0 );
+    }
+
+    SECTION("Initial estimate is derived from the baud rate")
+    {
+        // 240 bytes at 2400 baud occupy the line for one second
+        scheduler.add({.name = "QPIGS", .period = 2000ms, .priority = 0, .lineBytes = 240, .execute = [](){}});
+        CHECK_THAT( scheduler.lineUtilization(), WithinAbs(0.5, 0.001) );
+    }
+
+    SECTION("A changed command size scales its estimate")
+    {
+        scheduler.add({.name = "QPGSn", .period = 0ms, .priority = 100, .lineBytes = 120, .execute = [](){}});
+        CHECK_THAT( scheduler.lineUtilization(), WithinAbs(0.5, 0.001) );
+        scheduler.setLineBytes("QPGSn", 180);
+        CHECK_THAT( scheduler.lineUtilization(), WithinAbs(0.75, 0.001) );
+
+        // A measured estimate is scaled the same way, the QPGSn stub takes no time at all
+        scheduler.add(command(log, clock, "QPIGS", 1000ms, 10, 200ms));
+        scheduler.runCycle();
+        CHECK_THAT( scheduler.lineUtilization(), WithinAbs(0.2, 0.001) );
+        scheduler.setLineBytes("QPIGS", 2 * 48);
+        CHECK_THAT( scheduler.lineUtilization(), WithinAbs(0.4, 0.001) );
+    }
+}
@@ -0,0 +1,69 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <solax/Crc.h>
+
+using namespace solax;
+
+SCENARIO( "Protocol CRC is calculated according to section 4.1", "[solax::crc]" ) 
+{
+    SECTION("Known inquiry commands")
+    {
+        CHECK( crc16("QPIGS") == 0xB7A9 );
+        CHECK( crc16("QMOD") == 0x49C1 );
+        CHECK( crc16("QPIWS") == 0xB4DA );
+    }
+
+    SECTION("NAK response carries the well known 'ss' CRC")
+    {
+        CHECK( crc16("(NAK") == 0x7373 );
+        CHECK( hasValidCrc("(NAKss") );
+    }
+
+    SECTION("Commands are framed with CRC and carriage return")
+    {
+        CHECK( frameCommand("QPIGS") == "QPIGS\xB7\xA9\r" );
+    }
+
+    SECTION("CRC bytes never collide with frame delimiters")
+    {
+        int numCollisions{0};
+        for(int i = 0; i < 4096; ++i)
+        {
+            auto const crc{crc16(std::to_string(i))};
+            for(const uint8_t crcByte : {static_cast<uint8_t>(crc >> 8), static_cast<uint8_t>(crc & 0xff)})
+            {
+                if(crcByte == '(' || crcByte == '\r' || crcByte == '\n')
+                {
+                    numCollisions++;
+                }
+            }
+        }
+        CHECK( numCollisions == 0 );
+    }
+
+    SECTION("Corrupted frames are rejected")
+    {
+        std::string frame{"(1 96342304101107 B 00"};
+        auto const crc{crc16(frame)};
+        frame.push_back(static_cast<char>(crc >> 8));
+        frame.push_back(static_cast<char>(crc & 0xff));
+        REQUIRE( hasValidCrc(frame) );
+
+        frame[5] = '7';
+        CHECK_FALSE( hasValidCrc(frame) );
+        CHECK_FALSE( hasValidCrc(frame.substr(0, frame.size() - 1)) );
+        CHECK_FALSE( hasValidCrc("") );
+    }
+}
+
+SCENARIO( "History files are checksummed with CRC-32", "[solax::crc]" )
+{
+    std::string_view const check{"123456789"};
+    auto const* data{reinterpret_cast<const std::byte*>(check.data())};
+
+    CHECK( crc32(0, data, check.size()) == 0xCBF43926 );
+    CHECK( crc32(0, data, 0) == 0 );
+
+    // Continuing from a previous crc equals a single pass
+    CHECK( crc32(crc32(0, data, 4), data + 4, check.size() - 4) == 0xCBF43926 );
+}
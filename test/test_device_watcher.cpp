@@ -0,0 +1,88 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <solax/DeviceWatcher.h>
+
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <thread>
+
+using namespace solax;
+using namespace std::chrono_literals;
+
+namespace {
+
+std::filesystem::path makeTemporaryDirectory() {
+    auto path{(std::filesystem::temp_directory_path() / "solax_watch_XXXXXX").string()};
+    REQUIRE(mkdtemp(path.data()) != nullptr);
+    return path;
+}
+
+} // anonymous namespace
+
+SCENARIO( "Reappearing serial devices are noticed right away", "[solax::hotplug]" ) 
+{
+    auto const directory{makeTemporaryDirectory()};
+    auto const devicePath{directory / "by-id" / "usb-serial"};
+
+    DeviceWatcher watcher{{devicePath.string()}};
+
+    SECTION("Waiting times out while nothing happens")
+    {
+        auto const start{std::chrono::steady_clock::now()};
+        CHECK_FALSE( watcher.waitForDevice(50ms) );
+        CHECK( std::chrono::steady_clock::now() - start >= 50ms );
+    }
+
+    SECTION("Creating the directory and the device node wakes the watcher")
+    {
+        auto wait{std::async(std::launch::async, [&]() { return watcher.waitForDevice(5s); })};
+        std::this_thread::sleep_for(50ms);
+        std::filesystem::create_directory(devicePath.parent_path());
+
+        auto const start{std::chrono::steady_clock::now()};
+        CHECK( wait.get() );
+        CHECK( std::chrono::steady_clock::now() - start < 1s );
+
+        wait = std::async(std::launch::async, [&]() { return watcher.waitForDevice(5s); });
+        std::this_thread::sleep_for(50ms);
+        std::ofstream{devicePath} << "";
+        CHECK( wait.get() );
+    }
+
+    SECTION("A device that appeared before waiting is noticed")
+    {
+        std::filesystem::create_directory(devicePath.parent_path());
+
+        auto const start{std::chrono::steady_clock::now()};
+        CHECK( watcher.waitForDevice(5s) );
+        CHECK( std::chrono::steady_clock::now() - start < 1s );
+    }
+
+    SECTION("A removed directory is watched again once it reappears")
+    {
+        std::filesystem::create_directory(devicePath.parent_path());
+        CHECK( watcher.waitForDevice(5s) );
+        CHECK_FALSE( watcher.waitForDevice(50ms) );
+
+        std::filesystem::remove(devicePath.parent_path());
+        std::filesystem::create_directory(devicePath.parent_path());
+        CHECK( watcher.waitForDevice(5s) );
+        CHECK_FALSE( watcher.waitForDevice(50ms) );
+
+        std::ofstream{devicePath} << "";
+        auto const start{std::chrono::steady_clock::now()};
+        CHECK( watcher.waitForDevice(5s) );
+        CHECK( std::chrono::steady_clock::now() - start < 1s );
+    }
+
+    SECTION("Unrelated files are ignored")
+    {
+        auto wait{std::async(std::launch::async, [&]() { return watcher.waitForDevice(200ms); })};
+        std::this_thread::sleep_for(50ms);
+        std::ofstream{directory / "unrelated"} << "";
+        CHECK_FALSE( wait.get() );
+    }
+
+    std::filesystem::remove_all(directory);
+}
@@ -0,0 +1,138 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include <solax/EnergyIntegrator.h>
+#include "TestHelpers.h"
+
+#include <filesystem>
+#include <fstream>
+
+using namespace solax;
+using namespace std::chrono_literals;
+using Catch::Matchers::WithinAbs;
+
+namespace
+{
+
+// A unit drawing the given battery power at 50 V, producing solarPower_W on PV1 and feeding acPower_W
+UnitTelemetry unit(const std::string& serialNumber, int32_t solarPower_W, int32_t acPower_W, int32_t batteryPower_W)
+{
+    UnitTelemetry telemetry;
+    telemetry.serialNumber = serialNumber;
+    telemetry.pv1InputVoltage_V = 100.0f;
+    telemetry.pv1InputCurrent_A = solarPower_W / 100;
+    telemetry.acOutputActivePower_W = acPower_W;
+    telemetry.batteryVoltage_V = 50.0f;
+    telemetry.batteryChargingCurrent_A = std::max(batteryPower_W, 0) / 50;
+    telemetry.batteryDischargeCurrent_A = std::max(-batteryPower_W, 0) / 50;
+    return telemetry;
+}
+
+}
+
+SCENARIO( "Sampled power is integrated into energy counters", "[solax::energy]" )
+{
+    test::TemporaryPath state{"solax_energy"};
+    EnergyIntegrator::Config config{.statePath = state.path.string(), .persistInterval = 3600s, .maxSampleGap = 10s};
+    auto const start{EnergyIntegrator::Clock::now()};
+
+    SECTION("Constant power over an hour")
+    {
+        EnergyIntegrator integrator{config};
+        for(int i = 0; i <= 3600; ++i)
+        {
+            integrator.add(start + std::chrono::seconds{i}, unit("A", 1000, 500, 0));
+        }
+
+        CHECK_THAT( integrator.total().solar_kWh, WithinAbs(1.0, 1e-9) );
+        CHECK_THAT( integrator.total().load_kWh, WithinAbs(0.5, 1e-9) );
+        CHECK_THAT( integrator.total().batteryCharge_kWh, WithinAbs(0.0, 1e-9) );
+    }
+
+    SECTION("A linear ramp is integrated exactly")
+    {
+        EnergyIntegrator integrator{config};
+        integrator.add(start, unit("A", 0, 0, 0));
+        integrator.add(start + 6s, unit("A", 6000, 0, 0));
+
+        // 3000 W on average for 6 s
+        CHECK_THAT( integrator.total().solar_kWh, WithinAbs(0.005, 1e-9) );
+    }
+
+    SECTION("Charge and discharge are split at the zero crossing")
+    {
+        EnergyIntegrator integrator{config};
+        integrator.add(start, unit("A", 0, 0, 1000));
+        integrator.add(start + 8s, unit("A", 0, 0, -3000));
+
+        // Charging with 1000 W falling to 0 W in 2 s, then discharging up to 3000 W in 6 s
+        CHECK_THAT( integrator.total().batteryCharge_kWh * 3600.0 * 1000.0, WithinAbs(1000.0, 1e-6) );
+        CHECK_THAT( integrator.total().batteryDischarge_kWh * 3600.0 * 1000.0, WithinAbs(9000.0, 1e-6) );
+    }
+
+    SECTION("Gaps without samples are not interpolated")
+    {
+        EnergyIntegrator integrator{config};
+        integrator.add(start, unit("A", 1000, 0, 0));
+        integrator.add(start + 60s, unit("A", 1000, 0, 0));
+        CHECK( integrator.total().solar_kWh == 0.0 );
+
+        integrator.add(start + 61s, unit("A", 1000, 0, 0));
+        CHECK( integrator.total().solar_kWh > 0.0 );
+    }
+
+    SECTION("Every unit is integrated on its own and totals survive a unit leaving")
+    {
+        EnergyIntegrator integrator{config};
+        integrator.add(start, unit("A", 3600, 0, 0));
+        integrator.add(start + 500ms, unit("B", 3600, 0, 0));
+        integrator.add(start + 1s, unit("A", 3600, 0, 0));
+        integrator.add(start + 1500ms, unit("B", 3600, 0, 0));
+
+        auto const units{integrator.unitTotals({unit("A", 0, 0, 0), unit("B", 0, 0, 0), unit("C", 0, 0, 0)})};
+        REQUIRE( units.size() == 3 );
+        CHECK_THAT( units[0].solar_kWh, WithinAbs(0.001, 1e-9) );
+        CHECK_THAT( units[1].solar_kWh, WithinAbs(0.001, 1e-9) );
+        CHECK( units[2].solar_kWh == 0.0 );
+
+        integrator.add(start + 2s, unit("A", 3600, 0, 0));
+        CHECK_THAT( integrator.total().solar_kWh, WithinAbs(0.003, 1e-9) );
+    }
+
+    SECTION("Counters are persisted across restarts")
+    {
+        {
+            EnergyIntegrator integrator{config};
+            integrator.add(start, unit("A", 3600, 0, 0));
+            integrator.add(start + 1s, unit("A", 3600, 0, 0));
+        }
+
+        EnergyIntegrator integrator{config};
+        CHECK_THAT( integrator.total().solar_kWh, WithinAbs(0.001, 1e-9) );
+
+        // The first sample after a restart starts a new trapezoid instead of bridging the downtime
+        integrator.add(start + 5s, unit("A", 3600, 0, 0));
+        CHECK_THAT( integrator.total().solar_kWh, WithinAbs(0.001, 1e-9) );
+    }
+
+    SECTION("Corrupted lines of the state file are skipped")
+    {
+        std::ofstream{state.path} << "A 0.1 garbage\nB 0.5 0 0 0\n0.1 0.2\n";
+        EnergyIntegrator integrator{config};
+        CHECK_THAT( integrator.total().solar_kWh, WithinAbs(0.5, 1e-9) );
+    }
+
+    SECTION("Units without a serial number are not persisted")
+    {
+        {
+            EnergyIntegrator integrator{config};
+            integrator.add(start, unit("", 3600, 0, 0));
+            integrator.add(start + 1s, unit("", 3600, 0, 0));
+            integrator.add(start, unit("A", 3600, 0, 0));
+            integrator.add(start + 1s, unit("A", 3600, 0, 0));
+        }
+
+        EnergyIntegrator integrator{config};
+        CHECK_THAT( integrator.total().solar_kWh, WithinAbs(0.001, 1e-9) );
+    }
+}
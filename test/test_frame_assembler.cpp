@@ -0,0 +1,81 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <solax/FrameAssembler.h>
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+
+using namespace solax;
+
+namespace {
+
+void feed(FrameAssembler& assembler, std::string_view bytes) {
+    while(!bytes.empty()) {
+        auto const area{assembler.writableArea()};
+        auto const numBytes{std::min(area.size(), bytes.size())};
+        std::copy_n(bytes.data(), numBytes, area.data());
+        assembler.commit(numBytes);
+        bytes.remove_prefix(numBytes);
+    }
+}
+
+} // anonymous namespace
+
+SCENARIO( "Response frames are assembled from the serial byte stream", "[solax::framing]" ) 
+{
+    FrameAssembler assembler;
+
+    SECTION("A frame arriving in pieces is handed out once complete")
+    {
+        feed(assembler, "(1 9634");
+        CHECK_FALSE( assembler.nextFrame() );
+
+        feed(assembler, "2304101107 B");
+        CHECK_FALSE( assembler.nextFrame() );
+
+        feed(assembler, " 00xy\r");
+        auto const frame{assembler.nextFrame()};
+        REQUIRE( frame );
+        CHECK( *frame == "(1 96342304101107 B 00xy" );
+        CHECK( assembler.numDiscardedBytes() == 0 );
+    }
+
+    SECTION("Garbage before a frame is skipped")
+    {
+        feed(assembler, "\n\x13garbage(NAKss\r");
+        auto const frame{assembler.nextFrame()};
+        REQUIRE( frame );
+        CHECK( *frame == "(NAKss" );
+        CHECK( assembler.numDiscardedBytes() == 9 );
+    }
+
+    SECTION("A frame that lost its terminator is dropped when the next one starts")
+    {
+        feed(assembler, "(1 963423(NAKss\r");
+        auto const frame{assembler.nextFrame()};
+        REQUIRE( frame );
+        CHECK( *frame == "(NAKss" );
+        CHECK( assembler.numDiscardedBytes() == 9 );
+    }
+
+    SECTION("Back to back frames are handed out one by one")
+    {
+        feed(assembler, "(A12\r(B34\r(C5");
+        CHECK( assembler.nextFrame() == "(A12" );
+        CHECK( assembler.nextFrame() == "(B34" );
+        CHECK_FALSE( assembler.nextFrame() );
+
+        feed(assembler, "6\r");
+        CHECK( assembler.nextFrame() == "(C56" );
+    }
+
+    SECTION("An endless frame does not exhaust the buffer")
+    {
+        feed(assembler, "(");
+        feed(assembler, std::string(FrameAssembler::Capacity * 2, '1'));
+        feed(assembler, "(NAKss\r");
+        CHECK( assembler.nextFrame() == "(NAKss" );
+        CHECK( assembler.numDiscardedBytes() > FrameAssembler::Capacity );
+    }
+}
@@ -0,0 +1,53 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <solax/LatencyTracker.h>
+
+using namespace solax;
+using namespace std::chrono_literals;
+
+SCENARIO( "Response timeouts adapt to the measured latency", "[solax::timeout]" ) 
+{
+    LatencyTracker tracker{{.safetyFactor = 1.5, .floor = 200ms, .ceiling = 5000ms, .minSamples = 8}};
+
+    SECTION("The ceiling applies until enough samples were collected")
+    {
+        CHECK_FALSE( tracker.percentile(0.99) );
+        for(int i = 0; i < 7; ++i)
+        {
+            tracker.add(600ms);
+        }
+        CHECK( tracker.timeout() == 5000ms );
+
+        tracker.add(600ms);
+        CHECK( tracker.timeout() == 900ms );
+    }
+
+    SECTION("The timeout follows the 99th percentile")
+    {
+        for(int i = 1; i <= 100; ++i)
+        {
+            tracker.add(std::chrono::milliseconds{i * 10});
+        }
+        // Only the most recent 64 samples (370 ms .. 1000 ms) are kept
+        CHECK( tracker.numSamples() == LatencyTracker::Capacity );
+        CHECK( tracker.percentile(0.0) == 370ms );
+        CHECK( tracker.percentile(0.5) == 680ms );
+        CHECK( tracker.percentile(0.99) == 1000ms );
+        CHECK( tracker.timeout() == 1500ms );
+    }
+
+    SECTION("The timeout is clamped to floor and ceiling")
+    {
+        for(int i = 0; i < 10; ++i)
+        {
+            tracker.add(1ms);
+        }
+        CHECK( tracker.timeout() == 200ms );
+
+        for(int i = 0; i < 10; ++i)
+        {
+            tracker.add(10s);
+        }
+        CHECK( tracker.timeout() == 5000ms );
+    }
+}
@@ -0,0 +1,127 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <solax/ParallelTopology.h>
+
+#include <string>
+#include <vector>
+
+using namespace solax;
+
+namespace {
+
+// Answers QPGSn like a stack of parallel units and records which machine indices were queried
+struct FakeInverter {
+    std::vector<std::string> serialNumbers;
+    std::vector<uint8_t> queries;
+    uint8_t corruptedIndex{0};
+
+    TelemetryResult<UnitTelemetry> query(uint8_t machineIndex) {
+        queries.push_back(machineIndex);
+        if(machineIndex == corruptedIndex) {
+            return std::unexpected(TelemetryError{.kind = TelemetryErrorKind::CorruptedResponse});
+        }
+        UnitTelemetry unit;
+        if(machineIndex >= 1 && machineIndex <= serialNumbers.size()) {
+            unit.parallelNum = 1;
+            unit.serialNumber = serialNumbers[machineIndex - 1u];
+        }
+        return unit;
+    }
+};
+
+} // anonymous namespace
+
+SCENARIO( "Parallel units are discovered once and then polled directly", "[solax::topology]" ) 
+{
+    FakeInverter inverter{.serialNumbers = {"96342304101101", "96342304101102"}, .queries = {}, .corruptedIndex = 0};
+    ParallelTopology topology{[&](uint8_t machineIndex) { return inverter.query(machineIndex); }};
+    std::vector<UnitTelemetry> unitTelemetries;
+
+    SECTION("The first poll sweeps until an empty slot, later polls only query known units")
+    {
+        topology.poll(unitTelemetries);
+        CHECK( unitTelemetries.size() == 2 );
+        CHECK( topology.numUnits() == 2 );
+        CHECK( inverter.queries == std::vector<uint8_t>{1, 2, 3} );
+
+        inverter.queries.clear();
+        topology.poll(unitTelemetries);
+        CHECK( unitTelemetries.size() == 2 );
+        CHECK( inverter.queries == std::vector<uint8_t>{1, 2} );
+    }
+
+    SECTION("A vanished unit triggers a rediscovery")
+    {
+        topology.poll(unitTelemetries);
+        inverter.serialNumbers.pop_back();
+        inverter.queries.clear();
+
+        topology.poll(unitTelemetries);
+        CHECK( unitTelemetries.size() == 1 );
+        CHECK( topology.numUnits() == 1 );
+        CHECK( inverter.queries == std::vector<uint8_t>{1, 2, 1, 2} );
+    }
+
+    SECTION("A replaced unit triggers a rediscovery")
+    {
+        topology.poll(unitTelemetries);
+        inverter.serialNumbers[0] = "96342304101109";
+
+        topology.poll(unitTelemetries);
+        REQUIRE( unitTelemetries.size() == 2 );
+        CHECK( unitTelemetries[0].serialNumber == "96342304101109" );
+    }
+
+    SECTION("An added unit is picked up by the topology check")
+    {
+        topology.poll(unitTelemetries);
+        inverter.serialNumbers.push_back("96342304101103");
+        inverter.queries.clear();
+
+        topology.checkForNewUnits();
+        CHECK( inverter.queries == std::vector<uint8_t>{3} );
+
+        topology.poll(unitTelemetries);
+        CHECK( unitTelemetries.size() == 3 );
+    }
+
+    SECTION("Invalidating forces a full sweep")
+    {
+        topology.poll(unitTelemetries);
+        topology.invalidate();
+        inverter.queries.clear();
+
+        topology.poll(unitTelemetries);
+        CHECK( inverter.queries == std::vector<uint8_t>{1, 2, 3} );
+    }
+
+    SECTION("A bad sample is reported without touching the known topology")
+    {
+        topology.poll(unitTelemetries);
+        inverter.corruptedIndex = 2;
+        inverter.queries.clear();
+
+        auto const result{topology.poll(unitTelemetries)};
+        REQUIRE_FALSE( result );
+        CHECK( result.error().kind == TelemetryErrorKind::CorruptedResponse );
+        CHECK( topology.numUnits() == 2 );
+
+        inverter.corruptedIndex = 0;
+        inverter.queries.clear();
+        CHECK( topology.poll(unitTelemetries) );
+        CHECK( unitTelemetries.size() == 2 );
+        CHECK( inverter.queries == std::vector<uint8_t>{1, 2} );
+    }
+
+    SECTION("A bad sample during discovery leads to a new sweep")
+    {
+        inverter.corruptedIndex = 2;
+        CHECK_FALSE( topology.poll(unitTelemetries) );
+        CHECK( topology.numUnits() == 0 );
+
+        inverter.corruptedIndex = 0;
+        inverter.queries.clear();
+        CHECK( topology.poll(unitTelemetries) );
+        CHECK( inverter.queries == std::vector<uint8_t>{1, 2, 3} );
+    }
+}
@@ -6,7 +6,7 @@
 #include <solax/Telemetry.h>
 
 const std::string_view solaxOutput = 
-"1 96342304101107 B 00 000.0 00.00 110.3 60.01 0569 0548 008 53.5 022 093 138.9 041 01496 01445 011 10100110 5 3 100 120 040 06 000 143.1 06�k";
+"1 96342304101107 B 00 000.0 00.00 110.3 60.01 0569 0548 008 53.5 022 093 138.9 041 01496 01445 011 10100110 5 3 100 120 040 06 000 143.1 06\x8bk";
 
 using namespace solax;
 using Catch::Matchers::WithinAbs;
@@ -19,7 +19,7 @@ SCENARIO( "QPGSn Telemetry can be parsed", "[solax::telemetry]" )
 
         WHEN( "parsing the telemetry" ) 
         {
-            auto const parsed = solax::parseRawTelemetry(telemetry);
+            auto const parsed = solax::parseRawTelemetry(telemetry).value();
 
             THEN( "Basic device info is parsed correctly" ) 
             {
@@ -74,3 +74,99 @@ SCENARIO( "QPGSn Telemetry can be parsed", "[solax::telemetry]" )
         }
     }
 }
+
+SCENARIO( "Damaged QPGSn telemetry is reported with the offending field", "[solax::telemetry]" ) 
+{
+    GIVEN( "a response that lost its second half" ) 
+    {
+        const std::string_view telemetry{"1 96342304101107 B 00 000.0 00.00 110.3 60.01 0569 xx"};
+
+        WHEN( "parsing the telemetry" ) 
+        {
+            auto const parsed = solax::parseRawTelemetry(telemetry);
+
+            THEN( "the first missing field is named" ) 
+            {
+                REQUIRE_FALSE( parsed );
+                CHECK( parsed.error().kind == TelemetryErrorKind::MissingField );
+                CHECK( parsed.error().fieldIndex == 9 );
+                CHECK( parsed.error().fieldName == "acOutputActivePower_W" );
+                CHECK( describe(parsed.error()) == "missing field 9 (acOutputActivePower_W)" );
+            }
+        }
+    }
+
+    GIVEN( "a response with a garbled field" ) 
+    {
+        std::string telemetry{solaxOutput};
+        telemetry.replace(telemetry.find("53.5"), 4, "5#.5");
+
+        WHEN( "parsing the telemetry" ) 
+        {
+            auto const parsed = solax::parseRawTelemetry(telemetry);
+
+            THEN( "the malformed field is named" ) 
+            {
+                REQUIRE_FALSE( parsed );
+                CHECK( parsed.error().kind == TelemetryErrorKind::MalformedField );
+                CHECK( parsed.error().fieldIndex == 11 );
+                CHECK( parsed.error().fieldName == "batteryVoltage_V" );
+            }
+        }
+    }
+
+    GIVEN( "a NAK" ) 
+    {
+        auto const parsed = solax::parseRawTelemetry("NAKss");
+        REQUIRE_FALSE( parsed );
+        CHECK( parsed.error().kind == TelemetryErrorKind::RejectedInquiry );
+    }
+}
+
+SCENARIO( "Single unit status inquiries can be parsed", "[solax::telemetry]" )
+{
+    SECTION("QPIGS")
+    {
+        auto const parsed = solax::parseGeneralStatus(
+            "230.1 49.9 229.8 50.0 0575 0548 011 412 53.50 012 093 0045 09.8 138.9 53.55 00003 00110110 00 00 01361 010 0 00 0000 \x8f\x2a").value();
+
+        CHECK_THAT( parsed.gridVoltage_V, WithinAbs(230.1, 0.01) );
+        CHECK_THAT( parsed.gridFrequency_Hz, WithinAbs(49.9, 0.01) );
+        CHECK( parsed.acOutputActivePower_W == 548 );
+        CHECK( parsed.busVoltage_V == 412 );
+        CHECK_THAT( parsed.batteryVoltage_V, WithinAbs(53.5, 0.01) );
+        CHECK( parsed.heatSinkTemperature_C == 45 );
+        CHECK_THAT( parsed.pv1InputCurrent_A, WithinAbs(9.8, 0.01) );
+        CHECK_THAT( parsed.pv1InputVoltage_V, WithinAbs(138.9, 0.01) );
+        CHECK( parsed.batteryDischargeCurrent_A == 3 );
+        CHECK( parsed.deviceStatus == "00110110" );
+        CHECK( parsed.pv1ChargingPower_W == 1361 );
+        CHECK( parsed.deviceStatus2 == "010" );
+    }
+
+    SECTION("QPIGS2")
+    {
+        auto const parsed = solax::parsePv2Status("10.1 143.1 01445 \x11\x22").value();
+
+        CHECK_THAT( parsed.pv2InputCurrent_A, WithinAbs(10.1, 0.01) );
+        CHECK_THAT( parsed.pv2InputVoltage_V, WithinAbs(143.1, 0.01) );
+        CHECK( parsed.pv2ChargingPower_W == 1445 );
+    }
+
+    SECTION("QPIWS")
+    {
+        auto const parsed = solax::parseWarningStatus("100000000001000000000000000000000000\x33\x44").value();
+        CHECK( parsed.warningBits == "100000000001000000000000000000000000" );
+    }
+
+    SECTION("QMOD")
+    {
+        CHECK( solax::parseDeviceMode("L\x55\x66")->mode == 'L' );
+    }
+
+    SECTION("Rejected inquiry")
+    {
+        CHECK( solax::isRejectedInquiry("NAKss") );
+        CHECK_FALSE( solax::isRejectedInquiry("L\x55\x66") );
+    }
+}
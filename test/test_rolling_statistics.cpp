@@ -0,0 +1,161 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include <solax/QuantileSketch.h>
+#include <solax/RollingStatistics.h>
+#include <solax/TelemetryJson.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using namespace solax;
+using namespace std::chrono_literals;
+using Catch::Matchers::WithinAbs;
+using Catch::Matchers::WithinRel;
+
+namespace
+{
+
+AggregatedTelemetry power(float solarPower_W, float acPower_W, float batteryPower_W)
+{
+    return {.solarPower_W = solarPower_W, .acPower_W = acPower_W, .batteryPower_W = batteryPower_W};
+}
+
+}
+
+SCENARIO( "Quantiles are approximated within the relative accuracy", "[solax::statistics]" )
+{
+    QuantileSketch sketch;
+    CHECK( !sketch.quantile(0.5).has_value() );
+
+    SECTION("Positive and negative values")
+    {
+        std::vector<float> values;
+        std::mt19937 random{42};
+        std::uniform_real_distribution<float> distribution{-5000.0f, 8000.0f};
+        for(int i = 0; i < 10000; ++i)
+        {
+            values.push_back(distribution(random));
+            sketch.add(values.back());
+        }
+        std::ranges::sort(values);
+
+        for(const double q : {0.0, 0.1, 0.5, 0.9, 0.99, 1.0})
+        {
+            auto const expected{values[static_cast<size_t>(q * static_cast<double>(values.size() - 1))]};
+            CHECK_THAT( *sketch.quantile(q), WithinRel(static_cast<double>(expected), QuantileSketch::RelativeAccuracy * 1.01) );
+        }
+    }
+
+    SECTION("Removed values are forgotten")
+    {
+        for(int i = 1; i <= 100; ++i)
+        {
+            sketch.add(static_cast<float>(i));
+        }
+        for(int i = 1; i <= 50; ++i)
+        {
+            sketch.remove(static_cast<float>(i));
+        }
+
+        CHECK( sketch.size() == 50 );
+        CHECK_THAT( *sketch.quantile(0.0), WithinRel(51.0f, 0.01f) );
+        CHECK_THAT( *sketch.quantile(1.0), WithinRel(100.0f, 0.01f) );
+    }
+
+    SECTION("Values close to zero")
+    {
+        sketch.add(0.0f);
+        sketch.add(0.01f);
+        sketch.add(-0.01f);
+        CHECK( *sketch.quantile(0.5) == 0.0f );
+    }
+}
+
+SCENARIO( "Power statistics follow a sliding window", "[solax::statistics]" )
+{
+    RollingStatistics statistics{60s};
+    auto const start{RollingStatistics::Clock::now()};
+
+    SECTION("An empty window has no statistics")
+    {
+        auto const summary{statistics.summarize()};
+        CHECK( statistics.numSamples() == 0 );
+        CHECK( std::isnan(summary[0].min) );
+        CHECK( std::isnan(summary[0].p50) );
+    }
+
+    SECTION("Summary of the samples within the window")
+    {
+        for(int i = 0; i < 60; ++i)
+        {
+            statistics.add(start + std::chrono::seconds{i}, power(static_cast<float>(i), 100.0f, static_cast<float>(i % 2 == 0 ? -200 : 200)));
+        }
+
+        auto const summary{statistics.summarize()};
+        CHECK( statistics.numSamples() == 60 );
+        CHECK( summary[0].min == 0.0f );
+        CHECK( summary[0].max == 59.0f );
+        CHECK_THAT( summary[0].mean, WithinAbs(29.5, 1e-4) );
+        CHECK_THAT( summary[0].stddev, WithinAbs(std::sqrt((60.0 * 60.0 - 1.0) / 12.0), 1e-3) );
+        CHECK_THAT( summary[0].p50, WithinRel(29.0f, 0.01f) );
+        CHECK( summary[1].min == 100.0f );
+        CHECK_THAT( summary[1].stddev, WithinAbs(0.0, 1e-3) );
+        CHECK( summary[2].min == -200.0f );
+        CHECK( summary[2].max == 200.0f );
+        CHECK_THAT( summary[2].mean, WithinAbs(0.0, 1e-3) );
+        CHECK_THAT( summary[2].stddev, WithinAbs(200.0, 1e-3) );
+    }
+
+    SECTION("Expired samples leave min, max and mean")
+    {
+        statistics.add(start, power(5000.0f, 0.0f, 0.0f));
+        statistics.add(start + 10s, power(-100.0f, 0.0f, 0.0f));
+        for(int i = 20; i < 80; ++i)
+        {
+            statistics.add(start + std::chrono::seconds{i}, power(1000.0f, 0.0f, 0.0f));
+        }
+
+        auto const summary{statistics.summarize()};
+        CHECK( statistics.numSamples() == 60 );
+        CHECK( summary[0].min == 1000.0f );
+        CHECK( summary[0].max == 1000.0f );
+        CHECK_THAT( summary[0].mean, WithinAbs(1000.0, 1e-3) );
+        CHECK_THAT( summary[0].p99, WithinRel(1000.0f, 0.01f) );
+
+        statistics.expire(start + 200s);
+        CHECK( statistics.numSamples() == 0 );
+    }
+}
+
+SCENARIO( "Statistics of aggregated and unit power are queried by window", "[solax::statistics]" )
+{
+    TelemetryStatistics statistics;
+    auto const start{TelemetryStatistics::Clock::now()};
+
+    UnitTelemetry unit;
+    unit.serialNumber = "92932004102443";
+    unit.acOutputActivePower_W = 300;
+
+    for(int i = 0; i < 600; ++i)
+    {
+        auto const sampleTime{start + std::chrono::seconds{i}};
+        statistics.add(sampleTime, power(static_cast<float>(i), 0.0f, 0.0f));
+        statistics.add(sampleTime, unit);
+    }
+    auto const now{start + 599s};
+
+    CHECK( statistics.aggregated("1m", now).numSamples == 60 );
+    CHECK( statistics.aggregated("5m", now).numSamples == 300 );
+    CHECK( statistics.aggregated("1h", now).numSamples == 600 );
+    CHECK( statistics.aggregated("5m", now).channels[0].min == 300.0f );
+    CHECK( statistics.unit("92932004102443", "1m", now).channels[1].mean == 300.0f );
+    CHECK( statistics.unit("unknown", "1m", now).numSamples == 0 );
+    CHECK_THROWS_AS( statistics.aggregated("2m", now), std::invalid_argument );
+
+    auto const json{toJson(statistics.aggregated("1m", now))};
+    CHECK( json.starts_with(R"({"window":"1m","window_s":60,"samples":60,"solarPower_W":{"min":540,"max":599,)") );
+}
@@ -0,0 +1,284 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include <solax/RollupIndex.h>
+#include <solax/TimeSeriesStore.h>
+#include "TestHelpers.h"
+
+#include <filesystem>
+#include <fstream>
+#include <atomic>
+#include <csignal>
+#include <stdexcept>
+#include <sys/resource.h>
+#include <thread>
+
+using namespace solax;
+using namespace std::chrono_literals;
+using Catch::Matchers::WithinRel;
+
+namespace
+{
+
+auto const start{test::HistoryStart};
+
+// One sample every 10 s
+HistorySample sample(int i)
+{
+    return test::historySample(i, 10s);
+}
+
+// The same buckets computed straight from the samples
+std::vector<Rollup> expectedRollups(const TimeSeriesStore& store, std::chrono::seconds step)
+{
+    RollupBuilder builder{step};
+    for(const auto& stored : store.query(start - 24h, start + 24h * 30))
+    {
+        builder.add(stored);
+    }
+    return builder.finish();
+}
+
+void checkEqual(const std::vector<Rollup>& rollups, const std::vector<Rollup>& expected)
+{
+    REQUIRE( rollups.size() == expected.size() );
+    for(size_t i = 0; i < rollups.size(); ++i)
+    {
+        CHECK( rollups[i].start == expected[i].start );
+        CHECK( rollups[i].count == expected[i].count );
+        for(size_t channel = 0; channel < NumPowerChannels; ++channel)
+        {
+            CHECK( rollups[i].channels[channel].min == expected[i].channels[channel].min );
+            CHECK( rollups[i].channels[channel].max == expected[i].channels[channel].max );
+            CHECK_THAT( rollups[i].channels[channel].sum, WithinRel(expected[i].channels[channel].sum, 1e-9) );
+        }
+    }
+}
+
+}
+
+TEST_CASE( "The coarsest level that divides the step is chosen", "[solax::rollup]" )
+{
+    CHECK( RollupIndex::levelFor(10s) == 0 );
+    CHECK( RollupIndex::levelFor(30s) == 0 );
+    CHECK( RollupIndex::levelFor(1min) == 1 );
+    CHECK( RollupIndex::levelFor(5min) == 1 );
+    CHECK( RollupIndex::levelFor(15min) == 2 );
+    CHECK( RollupIndex::levelFor(30min) == 2 );
+    CHECK( RollupIndex::levelFor(1h) == 3 );
+    CHECK( RollupIndex::levelFor(6h) == 3 );
+    CHECK( RollupIndex::levelFor(24h) == 4 );
+    CHECK( RollupIndex::levelFor(24h * 7) == 4 );
+
+    CHECK_FALSE( RollupIndex::levelFor(1s) );
+    CHECK_FALSE( RollupIndex::levelFor(15s) );
+}
+
+SCENARIO( "Long range queries are answered from the rollups", "[solax::rollup]" )
+{
+    test::TemporaryDirectory directory{"solax_rollup"};
+    TimeSeriesStore::Config config{.path = directory.path.string(), .retention = std::chrono::hours{24 * 365}, .flushInterval = 3600s};
+
+    // Two days and a bit
+    constexpr int NumSamples{2 * 8640 + 500};
+    {
+        TimeSeriesStore store{config};
+        for(int i = 0; i < NumSamples; ++i)
+        {
+            store.add(sample(i));
+        }
+
+        SECTION("Daily buckets")
+        {
+            auto const series{store.queryRollups(start, start + 24h * 3, 24h)};
+            CHECK( series.step == 24h );
+            CHECK( series.resolution == "1d" );
+            REQUIRE( series.rollups.size() == 3 );
+            CHECK( series.rollups[0].count == 8640 );
+            CHECK( series.rollups[2].count == 500 );
+            CHECK( series.rollups[0].channels[0].min == 0.0f );
+            CHECK( series.rollups[0].channels[0].max == 8639.0f );
+            CHECK( series.rollups[0].channels[2].min == -8639.0f );
+            checkEqual(series.rollups, expectedRollups(store, 24h));
+        }
+
+        SECTION("Steps that are a multiple of a level merge its buckets")
+        {
+            auto const series{store.queryRollups(start, start + 24h * 3, 2h)};
+            CHECK( series.resolution == "1h" );
+            CHECK( series.rollups.size() == 25 );
+            checkEqual(series.rollups, expectedRollups(store, 2h));
+        }
+
+        SECTION("Buckets overlapping the time range are complete")
+        {
+            auto const series{store.queryRollups(start + 90min, start + 150min, 1h)};
+            REQUIRE( series.rollups.size() == 2 );
+            CHECK( series.rollups[0].start == start + 1h );
+            CHECK( series.rollups[0].count == 360 );
+            CHECK( series.rollups[1].count == 360 );
+        }
+
+        SECTION("Steps finer than every level are built from the samples")
+        {
+            auto const series{store.queryRollups(start, start + 1h, 15s)};
+            CHECK( series.resolution == "raw" );
+            auto expected{expectedRollups(store, 15s)};
+            expected.resize(241);
+            checkEqual(series.rollups, expected);
+        }
+
+        SECTION("Invalid steps are rejected")
+        {
+            CHECK_THROWS_AS( store.queryRollups(start, start + 1h, 0s), std::invalid_argument );
+            CHECK_THROWS_AS( store.queryRollups(start, start + 24h * 365, 10s), std::out_of_range );
+            CHECK( store.queryRollups(start + 1h, start, 1h).rollups.empty() );
+        }
+    }
+
+    SECTION("Buckets that were not complete are rebuilt after a restart")
+    {
+        TimeSeriesStore store{config};
+        checkEqual(store.queryRollups(start, start + 24h * 3, 24h).rollups, expectedRollups(store, 24h));
+        checkEqual(store.queryRollups(start, start + 24h * 3, 1min).rollups, expectedRollups(store, 1min));
+    }
+
+    SECTION("A torn record is dropped and rebuilt")
+    {
+        std::ofstream{directory.path / "rollup_1h.bin", std::ios::app | std::ios::binary} << "torn";
+
+        TimeSeriesStore store{config};
+        CHECK( std::filesystem::file_size(directory.path / "rollup_1h.bin") % 64 == 0 );
+        checkEqual(store.queryRollups(start, start + 24h * 3, 1h).rollups, expectedRollups(store, 1h));
+    }
+
+    SECTION("Missing rollups are rebuilt from the samples")
+    {
+        for(const auto& level : RollupIndex::Levels)
+        {
+            std::filesystem::remove(directory.path / ("rollup_" + std::string{level.name} + ".bin"));
+        }
+
+        TimeSeriesStore store{config};
+        checkEqual(store.queryRollups(start, start + 24h * 3, 15min).rollups, expectedRollups(store, 15min));
+    }
+}
+
+SCENARIO( "Rollups are read while samples are added", "[solax::rollup]" )
+{
+    test::TemporaryDirectory directory{"solax_rollup"};
+    TimeSeriesStore::Config config{.path = directory.path.string(), .retention = std::chrono::hours{24 * 365}, .flushInterval = 600s};
+    TimeSeriesStore store{config};
+
+    // One day, the rollups are written every 10 minutes
+    constexpr int NumSamples{8640};
+    std::atomic_int numAdded{0};
+    std::atomic_size_t numIncomplete{0};
+
+    // The level files are read without blocking add()
+    std::thread reader{[&]()
+    {
+        while(numAdded < NumSamples)
+        {
+            auto const added{numAdded.load()};
+            auto const series{store.queryRollups(start, start + 24h, 10s)};
+            bool complete{series.resolution == "10s" && series.rollups.size() >= static_cast<size_t>(added)};
+            for(size_t i = 0; complete && i < series.rollups.size(); ++i)
+            {
+                complete = series.rollups[i].start == start + 10s * i && series.rollups[i].count == 1;
+            }
+            if(!complete)
+            {
+                numIncomplete++;
+            }
+        }
+    }};
+    for(int i = 0; i < NumSamples; ++i)
+    {
+        store.add(sample(i));
+        numAdded = i + 1;
+    }
+    reader.join();
+
+    CHECK( numIncomplete == 0 );
+    checkEqual(store.queryRollups(start, start + 24h, 10s).rollups, expectedRollups(store, 10s));
+}
+
+SCENARIO( "Fine levels only keep the recent buckets", "[solax::rollup]" )
+{
+    test::TemporaryDirectory directory{"solax_rollup"};
+    RollupIndex index{directory.path};
+
+    // Ten days at one sample every 10 s, flushed every hour
+    constexpr int NumSamples{10 * 8640};
+    for(int i = 0; i < NumSamples; ++i)
+    {
+        index.add(sample(i));
+        if(i % 360 == 0)
+        {
+            index.flush();
+        }
+    }
+    index.flush();
+
+    auto const last{sample(NumSamples - 1).time};
+    auto const retention{RollupIndex::Levels[0].retention};
+    REQUIRE( index.oldest(0) );
+    CHECK( *index.oldest(0) > start );
+    CHECK( *index.oldest(0) >= last - retention - retention / 4 - 1h );
+    CHECK( index.oldest(1) == start );
+    CHECK( index.oldest(4) == start );
+
+    // The remaining buckets are still found
+    auto const rollups{index.query(0, last - 1h, last, 10s)};
+    REQUIRE( rollups.size() == 361 );
+    CHECK( rollups.back().start == last );
+}
+
+SCENARIO( "Buckets of a failed write are written by the next flush", "[solax::rollup]" )
+{
+    test::TemporaryDirectory directory{"solax_rollup"};
+    RollupIndex index{directory.path};
+
+    for(int i = 0; i < 400; ++i)
+    {
+        index.add(sample(i));
+    }
+    index.flush();
+    for(int i = 400; i < 1080; ++i)
+    {
+        index.add(sample(i));
+    }
+
+    // Appending to the level files fails like on a full SD card
+    bool failed{false};
+    {
+        ::rlimit limit{};
+        ::getrlimit(RLIMIT_FSIZE, &limit);
+        auto const previousHandler{std::signal(SIGXFSZ, SIG_IGN)};
+        auto const previousLimit{limit.rlim_cur};
+        limit.rlim_cur = 0;
+        ::setrlimit(RLIMIT_FSIZE, &limit);
+        try
+        {
+            index.flush();
+        }
+        catch(const std::runtime_error&)
+        {
+            failed = true;
+        }
+        limit.rlim_cur = previousLimit;
+        ::setrlimit(RLIMIT_FSIZE, &limit);
+        std::signal(SIGXFSZ, previousHandler);
+    }
+    REQUIRE( failed );
+
+    index.flush();
+    CHECK( index.query(0, start, start + 3h, 10s).size() == 1080 );
+    CHECK( index.query(3, start, start + 3h, 1h).size() == 3 );
+
+    // All but the open buckets made it to the files
+    RollupIndex reopened{directory.path};
+    CHECK( reopened.query(0, start, start + 3h, 10s).size() == 1079 );
+    CHECK( reopened.query(3, start, start + 3h, 1h).size() == 2 );
+}
@@ -7,11 +7,17 @@
  * The test is tagged with [integration] so it can be filtered:
  *   ./test_serial_adapter "[integration]"     # run only integration tests
  *   ./test_serial_adapter "~[integration]"    # exclude integration tests
+ *
+ * Tests tagged with [simulator] run against the pseudo terminal inverter simulator
+ * and need no hardware.
  */
 
 #include <catch2/catch_test_macros.hpp>
 #include <solax/SerialAdapter.h>
+#include <solax/Telemetry.h>
+#include "InverterSimulator.h"
 
+#include <chrono>
 #include <iostream>
 #include <fstream>
 
@@ -65,7 +71,7 @@ TEST_CASE("SerialAdapter can read telemetry from real device", "[integration][se
     SECTION("Read telemetry from machine index 0") {
         try {
             solax::SerialAdapter adapter(config);
-            std::string telemetry = adapter.readRawTelemetry(0);
+            std::string telemetry{adapter.readRawTelemetry(0).value_or(std::string_view{})};
             
             INFO("Received telemetry: " << telemetry);
             REQUIRE(!telemetry.empty());
@@ -76,3 +82,254 @@ TEST_CASE("SerialAdapter can read telemetry from real device", "[integration][se
         }
     }
 }
+
+TEST_CASE("SerialAdapter detects the simulated inverter", "[simulator][serial][detection]") {
+
+    solax::test::InverterSimulator::Config simulatorConfig;
+    simulatorConfig.baudRate = 0;
+    solax::test::InverterSimulator simulator(simulatorConfig);
+
+    solax::SerialAdapter::Config config;
+    config.devicePaths = {"/dev/solax_does_not_exist", simulator.devicePath()};
+
+    REQUIRE_NOTHROW([&]() {
+        solax::SerialAdapter adapter(config);
+    }());
+}
+
+TEST_CASE("SerialAdapter probes all device paths in parallel", "[simulator][serial][detection]") {
+
+    solax::test::InverterSimulator::Config slowConfig;
+    slowConfig.baudRate = 0;
+    slowConfig.responseDelay = std::chrono::milliseconds{1500};
+    solax::test::InverterSimulator slowSimulator(slowConfig);
+
+    solax::test::InverterSimulator::Config fastConfig;
+    fastConfig.baudRate = 2400;
+    solax::test::InverterSimulator fastSimulator(fastConfig);
+
+    solax::SerialAdapter::Config config;
+    config.devicePaths = {slowSimulator.devicePath(), "/dev/solax_does_not_exist", fastSimulator.devicePath()};
+
+    auto const start{std::chrono::steady_clock::now()};
+    solax::SerialAdapter adapter(config);
+    auto const probeDuration{std::chrono::steady_clock::now() - start};
+
+    CHECK(adapter.devicePath() == fastSimulator.devicePath());
+    CHECK(probeDuration < std::chrono::milliseconds{1000});
+}
+
+TEST_CASE("SerialAdapter reads telemetry of all simulated parallel units", "[simulator][serial][telemetry]") {
+
+    solax::test::InverterSimulator::Config simulatorConfig;
+    simulatorConfig.numParallelUnits = 2;
+    simulatorConfig.baudRate = 0;
+    solax::test::InverterSimulator simulator(simulatorConfig);
+
+    solax::SerialAdapter::Config config;
+    config.devicePaths = {simulator.devicePath()};
+    solax::SerialAdapter adapter(config);
+
+    auto const first{solax::parseResponse(adapter.readRawTelemetry(1), solax::parseRawTelemetry).value()};
+    CHECK(first.parallelNum == 1);
+    CHECK(first.serialNumber == "96342304101101");
+    CHECK(first.acOutputActivePower_W == 541);
+
+    auto const second{solax::parseResponse(adapter.readRawTelemetry(2), solax::parseRawTelemetry).value()};
+    CHECK(second.parallelNum == 1);
+    CHECK(second.serialNumber == "96342304101102");
+
+    auto const missing{solax::parseResponse(adapter.readRawTelemetry(3), solax::parseRawTelemetry).value()};
+    CHECK(missing.parallelNum == 0);
+}
+
+TEST_CASE("SerialAdapter detects lost responses after an adaptive timeout", "[simulator][serial][timeout]") {
+
+    solax::test::InverterSimulator::Config simulatorConfig;
+    simulatorConfig.baudRate = 0;
+    simulatorConfig.loseEveryNthResponse = 20;
+    solax::test::InverterSimulator simulator(simulatorConfig);
+
+    solax::SerialAdapter::Config config;
+    config.devicePaths = {simulator.devicePath()};
+    solax::SerialAdapter adapter(config);
+
+    CHECK(adapter.responseTimeout("QPGS1") == config.responseTimeout.ceiling);
+
+    // Warm up the latency statistics, the probe was the first response
+    for(int i = 0; i < 18; ++i) {
+        CHECK(adapter.readRawTelemetry(1));
+    }
+    CHECK(adapter.responseTimeout("QPGS2") == config.responseTimeout.floor);
+
+    // The 20th response gets lost and is asked for again after the floor timeout instead of five seconds
+    auto const start{std::chrono::steady_clock::now()};
+    auto const raw{adapter.readRawTelemetry(1).value()};
+    auto const duration{std::chrono::steady_clock::now() - start};
+    CHECK(raw.starts_with(solax::test::InverterSimulator::qpgsPayload(1, 1)));
+    CHECK(duration >= config.responseTimeout.floor);
+    CHECK(duration < std::chrono::milliseconds{1000});
+}
+
+TEST_CASE("SerialAdapter does not stall the inquiry after a lost response", "[simulator][serial][timeout]") {
+
+    solax::test::InverterSimulator::Config simulatorConfig;
+    simulatorConfig.numParallelUnits = 2;
+    simulatorConfig.baudRate = 0;
+    simulatorConfig.loseEveryNthResponse = 20;
+    solax::test::InverterSimulator simulator(simulatorConfig);
+
+    solax::SerialAdapter::Config config;
+    config.devicePaths = {simulator.devicePath()};
+    solax::SerialAdapter adapter(config);
+
+    // Warm up the latency statistics, the probe was the first response
+    for(int i = 0; i < 9; ++i) {
+        CHECK(adapter.readRawTelemetry(1));
+        CHECK(adapter.readRawTelemetry(2));
+    }
+    REQUIRE(adapter.responseTimeout("QPGS1") == config.responseTimeout.floor);
+
+    // The 20th response gets lost and is asked for again, the answer to the retry settles it
+    CHECK(adapter.readRawTelemetry(1).value().starts_with(solax::test::InverterSimulator::qpgsPayload(1, 2)));
+
+    auto const start{std::chrono::steady_clock::now()};
+    auto const raw{adapter.readRawTelemetry(2).value()};
+    auto const duration{std::chrono::steady_clock::now() - start};
+    CHECK(raw.starts_with(solax::test::InverterSimulator::qpgsPayload(2, 2)));
+    CHECK(duration < config.responseTimeout.floor);
+}
+
+TEST_CASE("SerialAdapter keeps latency statistics per command", "[simulator][serial][timeout]") {
+
+    solax::test::InverterSimulator::Config simulatorConfig;
+    simulatorConfig.baudRate = 0;
+    solax::test::InverterSimulator simulator(simulatorConfig);
+
+    solax::SerialAdapter::Config config;
+    config.devicePaths = {simulator.devicePath()};
+    solax::SerialAdapter adapter(config);
+
+    for(int i = 0; i < 20; ++i) {
+        CHECK(adapter.query("QPIGS"));
+        CHECK(adapter.readRawTelemetry(1));
+    }
+    CHECK(adapter.responseTimeout("QPIGS") == config.responseTimeout.floor);
+    CHECK(adapter.responseTimeout("QPGS2") == config.responseTimeout.floor);
+
+    // QPIGS2 is a command of its own, not QPIGS for a second unit
+    CHECK(adapter.responseTimeout("QPIGS2") == config.responseTimeout.ceiling);
+}
+
+TEST_CASE("SerialAdapter does not take a late response for the answer to the next inquiry", "[simulator][serial][timeout]") {
+
+    solax::test::InverterSimulator::Config simulatorConfig;
+    simulatorConfig.numParallelUnits = 2;
+    simulatorConfig.baudRate = 0;
+    simulatorConfig.responseDelay = std::chrono::milliseconds{50};
+    simulatorConfig.delayEveryNthResponse = 20;
+    simulatorConfig.lateResponseDelay = std::chrono::milliseconds{400};
+    solax::test::InverterSimulator simulator(simulatorConfig);
+
+    solax::SerialAdapter::Config config;
+    config.devicePaths = {simulator.devicePath()};
+    solax::SerialAdapter adapter(config);
+
+    for(int i = 0; i < 18; ++i) {
+        CHECK(adapter.readRawTelemetry(1));
+    }
+    CHECK(adapter.responseTimeout("QPGS1") == config.responseTimeout.floor);
+
+    // The 20th response arrives after the floor timeout, the response to the repeated QPGS1 follows it
+    // only once the next inquiry has been sent
+    CHECK(adapter.readRawTelemetry(1).value().starts_with(solax::test::InverterSimulator::qpgsPayload(1, 2)));
+    CHECK(adapter.readRawTelemetry(2).value().starts_with(solax::test::InverterSimulator::qpgsPayload(2, 2)));
+    CHECK(adapter.readRawTelemetry(1).value().starts_with(solax::test::InverterSimulator::qpgsPayload(1, 2)));
+
+    // The responses of the status inquiries fit their shape as well
+    for(const auto* inquiry : {"QPIGS", "QPIGS2", "QPIWS", "QMOD"}) {
+        INFO(inquiry);
+        CHECK(adapter.query(inquiry).value().starts_with(solax::test::InverterSimulator::statusPayload(inquiry)));
+    }
+}
+
+TEST_CASE("SerialAdapter recovers by reopening the last working device", "[simulator][serial][reconnect]") {
+
+    solax::test::InverterSimulator::Config simulatorConfig;
+    simulatorConfig.baudRate = 0;
+    solax::test::InverterSimulator simulator(simulatorConfig);
+
+    solax::SerialAdapter::Config config;
+    config.devicePaths = {simulator.devicePath()};
+    solax::SerialAdapter adapter(config);
+
+    auto const commandsBefore{simulator.numCommandsReceived()};
+    adapter.reopen();
+    CHECK(simulator.numCommandsReceived() == commandsBefore);
+
+    auto const raw{adapter.readRawTelemetry(1).value()};
+    CHECK(raw.starts_with(solax::test::InverterSimulator::qpgsPayload(1, 1)));
+}
+
+TEST_CASE("SerialAdapter receives paced responses completely", "[simulator][serial][telemetry]") {
+
+    solax::test::InverterSimulator::Config simulatorConfig;
+    simulatorConfig.baudRate = 9600;
+    simulatorConfig.jitter = std::chrono::milliseconds{20};
+    solax::test::InverterSimulator simulator(simulatorConfig);
+
+    solax::SerialAdapter::Config config;
+    config.devicePaths = {simulator.devicePath()};
+    solax::SerialAdapter adapter(config);
+
+    for(int i = 0; i < 3; ++i) {
+        auto const raw{adapter.readRawTelemetry(1).value()};
+        CHECK(raw.substr(0, raw.size() - 2) == solax::test::InverterSimulator::qpgsPayload(1, 1));
+    }
+}
+
+TEST_CASE("SerialAdapter retries immediately on corrupted responses", "[simulator][serial][crc]") {
+
+    solax::test::InverterSimulator::Config simulatorConfig;
+    simulatorConfig.baudRate = 0;
+    simulatorConfig.corruptEveryNthResponse = 2;
+    solax::test::InverterSimulator simulator(simulatorConfig);
+
+    solax::SerialAdapter::Config config;
+    config.devicePaths = {simulator.devicePath()};
+    solax::SerialAdapter adapter(config);
+
+    // The probe consumed the first response, so every first QPGS attempt gets corrupted
+    auto const commandsBefore{simulator.numCommandsReceived()};
+    for(int i = 0; i < 3; ++i) {
+        auto const start{std::chrono::steady_clock::now()};
+        auto const raw{adapter.readRawTelemetry(1).value()};
+        CHECK(std::chrono::steady_clock::now() - start < std::chrono::milliseconds{500});
+        CHECK(raw.starts_with(solax::test::InverterSimulator::qpgsPayload(1, 1)));
+    }
+    CHECK(simulator.numCommandsReceived() - commandsBefore == 6);
+}
+
+TEST_CASE("SerialAdapter reads the single unit status inquiries", "[simulator][serial][telemetry]") {
+
+    solax::test::InverterSimulator::Config simulatorConfig;
+    simulatorConfig.baudRate = 0;
+    simulatorConfig.supportsPv2 = false;
+    solax::test::InverterSimulator simulator(simulatorConfig);
+
+    solax::SerialAdapter::Config config;
+    config.devicePaths = {simulator.devicePath()};
+    solax::SerialAdapter adapter(config);
+
+    auto const general{solax::parseResponse(adapter.query("QPIGS"), solax::parseGeneralStatus).value()};
+    CHECK(general.heatSinkTemperature_C == 45);
+    CHECK(general.busVoltage_V == 412);
+
+    CHECK(solax::parseResponse(adapter.query("QMOD"), solax::parseDeviceMode)->mode == 'B');
+    CHECK(solax::parseResponse(adapter.query("QPIWS"), solax::parseWarningStatus)->warningBits.size() == 36);
+
+    // Models without a second PV input reject QPIGS2
+    auto const pv2{solax::parseResponse(adapter.query("QPIGS2"), solax::parsePv2Status)};
+    REQUIRE_FALSE(pv2);
+    CHECK(pv2.error().kind == solax::TelemetryErrorKind::RejectedInquiry);
+}
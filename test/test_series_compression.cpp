@@ -0,0 +1,127 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <solax/SeriesCompression.h>
+
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+using namespace solax;
+
+SCENARIO( "Time series values survive compression bit exact", "[solax::compression]" )
+{
+    std::vector<std::byte> buffer(1 << 20);
+    BitWriter writer{buffer.data(), buffer.size() * 8};
+
+    SECTION("Timestamps")
+    {
+        const std::vector<int64_t> timestamps{1700000000000, 1700000001000, 1700000002000, 1700000003013, 1700000003990,
+                                              1700000004000, 1700000004200, 1700000007000, 1700003600000, 1800000000000,
+                                              1800000000001, 1800000000001};
+        TimestampState encoder{.previous = timestamps.front()};
+        for(auto const timestamp : timestamps)
+        {
+            encodeTimestamp(writer, encoder, timestamp);
+        }
+
+        BitReader reader{buffer.data(), writer.bitsWritten()};
+        TimestampState decoder{.previous = timestamps.front()};
+        for(auto const timestamp : timestamps)
+        {
+            CHECK( decodeTimestamp(reader, decoder) == timestamp );
+        }
+        CHECK( reader.atEnd() );
+    }
+
+    SECTION("Floats")
+    {
+        std::vector<float> values{0.0f, 0.0f, 617.5f, 617.5f, 620.0f, -1250.0f, -0.0f, 1e-30f, 3.4e38f,
+                                  std::numeric_limits<float>::infinity(), std::numeric_limits<float>::quiet_NaN(), 52.3f};
+        std::mt19937 random{7};
+        std::uniform_real_distribution<float> distribution{-10000.0f, 10000.0f};
+        for(int i = 0; i < 1000; ++i)
+        {
+            values.push_back(distribution(random));
+        }
+
+        FloatState encoder;
+        for(auto const value : values)
+        {
+            encodeFloat(writer, encoder, value);
+        }
+
+        BitReader reader{buffer.data(), writer.bitsWritten()};
+        FloatState decoder;
+        for(auto const value : values)
+        {
+            CHECK( std::bit_cast<uint32_t>(decodeFloat(reader, decoder)) == std::bit_cast<uint32_t>(value) );
+        }
+        CHECK( reader.atEnd() );
+    }
+
+    SECTION("Integers")
+    {
+        const std::vector<int64_t> values{0, 0, 2, 2, 1, -1, 300, -300000, std::numeric_limits<int64_t>::max(),
+                                          std::numeric_limits<int64_t>::min(), 0};
+        IntegerState encoder;
+        for(auto const value : values)
+        {
+            encodeInteger(writer, encoder, value);
+        }
+
+        BitReader reader{buffer.data(), writer.bitsWritten()};
+        IntegerState decoder;
+        for(auto const value : values)
+        {
+            CHECK( decodeInteger(reader, decoder) == value );
+        }
+        CHECK( reader.atEnd() );
+    }
+
+    SECTION("Garbage past the write position is overwritten")
+    {
+        std::ranges::fill(buffer, std::byte{0xff});
+        writer.write(0b101, 3);
+        writer.write(0, 9);
+        BitReader reader{buffer.data(), writer.bitsWritten()};
+        CHECK( reader.read(3) == 0b101 );
+        CHECK( reader.read(9) == 0 );
+        CHECK_THROWS_AS( reader.read(1), std::out_of_range );
+    }
+}
+
+TEST_CASE( "Slowly changing telemetry compresses well", "[solax::compression]" )
+{
+    std::vector<std::byte> buffer(1 << 20);
+    BitWriter writer{buffer.data(), buffer.size() * 8};
+
+    // A day of inverter power sampled about every second: AC load from integer watts, PV power as volts
+    // with one decimal times integer amps, several series idle at zero
+    std::mt19937 random{3};
+    std::normal_distribution<float> jitter{0.0f, 1.0f};
+    TimestampState time{.previous = 1700000000000};
+    std::vector<FloatState> series(30);
+    constexpr int NumSamples{86400};
+    int64_t timestamp{1700000000000};
+    for(int i = 0; i < NumSamples; ++i)
+    {
+        timestamp += 1000 + (i % 10 == 0 ? static_cast<int64_t>(jitter(random) * 20.0f) : 0);
+        encodeTimestamp(writer, time, timestamp);
+
+        auto const acPower{std::round(450.0f + 30.0f * std::sin(static_cast<float>(i) / 600.0f) + (i % 5 == 0 ? jitter(random) * 3.0f : 0.0f))};
+        auto const pvVoltage{std::round(2400.0f + jitter(random)) / 10.0f};
+        auto const pvCurrent{std::round(8.0f + 4.0f * std::sin(static_cast<float>(i) / 7200.0f))};
+        for(size_t column = 0; column < series.size(); ++column)
+        {
+            float const value{column % 3 == 0 && column < 9 ? pvVoltage * pvCurrent : column % 3 == 1 && column < 9 ? acPower : 0.0f};
+            encodeFloat(writer, series[column], value);
+        }
+    }
+
+    auto const bytesPerSample{static_cast<double>(writer.bitsWritten()) / 8.0 / NumSamples};
+    INFO( "Bytes per sample: " << bytesPerSample );
+    // About 130 bytes uncompressed
+    CHECK( bytesPerSample < 130.0 / 8.0 );
+}
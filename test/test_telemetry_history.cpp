@@ -0,0 +1,137 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include <solax/TelemetryHistory.h>
+#include <solax/TelemetryJson.h>
+
+#include <stdexcept>
+
+using namespace solax;
+using namespace std::chrono_literals;
+using Catch::Matchers::WithinAbs;
+
+namespace
+{
+
+UnitTelemetry unit(int32_t acPower_W)
+{
+    UnitTelemetry telemetry;
+    telemetry.acOutputActivePower_W = acPower_W;
+    return telemetry;
+}
+
+AggregatedTelemetry aggregated(float solarPower_W)
+{
+    return {.solarPower_W = solarPower_W, .acPower_W = 0.0f, .batteryPower_W = 0.0f};
+}
+
+}
+
+SCENARIO( "Recent samples are kept in a ring buffer", "[solax::history]" )
+{
+    TelemetryHistory history{{.capacity = 100}};
+    auto const start{TelemetryHistory::Clock::time_point{} + 1000s};
+    auto const all{[&](size_t maxSamples = 0) { return history.query(start - 1h, start + 1h, maxSamples); }};
+
+    CHECK( history.size() == 0 );
+    CHECK( all().empty() );
+
+    SECTION("Range queries")
+    {
+        for(int i = 0; i < 50; ++i)
+        {
+            history.add(start + std::chrono::seconds{i}, aggregated(static_cast<float>(i)), {unit(i), unit(2 * i)});
+        }
+
+        auto const samples{history.query(start + 10s, start + 19s)};
+        REQUIRE( samples.size() == 10 );
+        CHECK( samples.front().time == start + 10s );
+        CHECK( samples.back().time == start + 19s );
+        CHECK( samples.front().aggregated.solarPower_W == 10.0f );
+        CHECK( samples.front().numUnits == 2 );
+        CHECK( samples.front().units[1].acPower_W == 20.0f );
+
+        CHECK( history.query(start + 60s, start + 70s).empty() );
+        CHECK( history.query(start + 20s, start + 10s).empty() );
+    }
+
+    SECTION("The oldest samples are overwritten")
+    {
+        for(int i = 0; i < 250; ++i)
+        {
+            history.add(start + std::chrono::seconds{i}, aggregated(static_cast<float>(i)), {});
+        }
+
+        auto const samples{all()};
+        CHECK( history.size() == 100 );
+        REQUIRE( samples.size() == 100 );
+        CHECK( samples.front().time == start + 150s );
+        CHECK( samples.back().time == start + 249s );
+        CHECK( history.query(start + 100s, start + 150s).size() == 1 );
+    }
+
+    SECTION("Samples of a clock that stepped back are dropped")
+    {
+        for(int i = 0; i < 20; ++i)
+        {
+            history.add(start + std::chrono::seconds{i}, aggregated(static_cast<float>(i)), {});
+        }
+        history.add(start + 5s, aggregated(-1.0f), {});
+        history.add(start + 19s, aggregated(-1.0f), {});
+        history.add(start + 20s, aggregated(20.0f), {});
+
+        auto const samples{all()};
+        REQUIRE( samples.size() == 21 );
+        CHECK( samples.back().aggregated.solarPower_W == 20.0f );
+        auto const range{history.query(start + 5s, start + 6s)};
+        REQUIRE( range.size() == 2 );
+        CHECK( range.front().aggregated.solarPower_W == 5.0f );
+    }
+
+    SECTION("Downsampling averages intervals of equal duration")
+    {
+        for(int i = 0; i < 100; ++i)
+        {
+            // The second unit joins half way through
+            std::vector<UnitTelemetry> units{unit(100)};
+            if(i >= 50)
+            {
+                units.push_back(unit(300));
+            }
+            history.add(start + std::chrono::seconds{i}, aggregated(static_cast<float>(i)), units);
+        }
+
+        auto const samples{all(10)};
+        REQUIRE( samples.size() == 10 );
+        CHECK_THAT( samples.front().aggregated.solarPower_W, WithinAbs(4.5, 1e-4) );
+        CHECK( samples.front().time == start + 4500ms );
+        CHECK( samples.front().numUnits == 1 );
+        CHECK( samples.back().numUnits == 2 );
+        CHECK_THAT( samples.back().units[1].acPower_W, WithinAbs(300.0, 1e-4) );
+        CHECK( all(100).size() == 100 );
+    }
+
+    SECTION("Gaps leave no empty samples behind")
+    {
+        history.add(start, aggregated(1.0f), {});
+        history.add(start + 1s, aggregated(3.0f), {});
+        history.add(start + 100s, aggregated(5.0f), {});
+
+        auto const samples{all(2)};
+        REQUIRE( samples.size() == 2 );
+        CHECK( samples[0].aggregated.solarPower_W == 2.0f );
+        CHECK( samples[1].aggregated.solarPower_W == 5.0f );
+    }
+
+    SECTION("JSON")
+    {
+        history.add(start, aggregated(1.0f), {unit(7)});
+        CHECK( toJson(all()) == R"({"samples":[{"time_ms":1000000,"aggregated":{"solarPower_W":1,"acPower_W":0,"batteryPower_W":0},)"
+                                R"("units":[{"solarPower_W":0,"acPower_W":7,"batteryPower_W":0}]}]})" );
+    }
+}
+
+TEST_CASE( "A history without capacity is rejected", "[solax::history]" )
+{
+    CHECK_THROWS_AS( TelemetryHistory({.capacity = 0}), std::invalid_argument );
+}
@@ -0,0 +1,118 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <solax/TelemetryMetrics.h>
+#include <solax/TelemetrySchema.h>
+
+#include <set>
+#include <sstream>
+
+using namespace solax;
+
+namespace
+{
+
+TelemetrySnapshot twoUnitSnapshot()
+{
+    TelemetrySnapshot snapshot;
+    snapshot.version = 42;
+    snapshot.aggregated = {.solarPower_W = 1200.5f, .acPower_W = -300.0f, .batteryPower_W = 0.25f};
+    snapshot.units.resize(2);
+    snapshot.units[0].serialNumber = "92932004102443";
+    snapshot.units[0].batteryVoltage_V = 52.5f;
+    snapshot.units[0].inverterStatus = "00010110";
+    snapshot.units[1].serialNumber = "9293\"2004\\1";
+    snapshot.units[1].batteryVoltage_V = 52.4f;
+    snapshot.units[1].workMode = 'B';
+    return snapshot;
+}
+
+bool contains(const std::string& text, const std::string& line)
+{
+    return text.find(line + "\n") != std::string::npos;
+}
+
+}
+
+SCENARIO( "Metric names are derived from the schema", "[solax::metrics]" )
+{
+    CHECK( metricName("batteryVoltage_V", "V") == "battery_voltage_volts" );
+    CHECK( metricName("batteryCapacity_pct", "%") == "battery_capacity_percent" );
+    CHECK( metricName("loadPercent", "%") == "load_percent" );
+    CHECK( metricName("acOutputApparentPower_VA", "VA") == "ac_output_apparent_power_voltamperes" );
+    CHECK( metricName("pv1InputCurrent_A", "A") == "pv1_input_current_amperes" );
+    CHECK( metricName("gridFrequency_Hz", "Hz") == "grid_frequency_hertz" );
+    CHECK( metricName("faultCode", "") == "fault_code" );
+}
+
+SCENARIO( "Snapshots are rendered as Prometheus text", "[solax::metrics]" )
+{
+    std::string text;
+    appendMetrics(text, twoUnitSnapshot());
+
+    SECTION("Aggregate and cycle counter")
+    {
+        CHECK( contains(text, "# TYPE solax_telemetry_cycles_total counter") );
+        CHECK( contains(text, "solax_telemetry_cycles_total 42") );
+        CHECK( contains(text, "# TYPE solax_solar_power_watts gauge") );
+        CHECK( contains(text, "solax_solar_power_watts 1200.5") );
+        CHECK( contains(text, "solax_ac_power_watts -300") );
+        CHECK( contains(text, "solax_battery_power_watts 0.25") );
+        CHECK( contains(text, "solax_units 2") );
+    }
+
+    SECTION("Unit fields are labelled with unit and serial number")
+    {
+        CHECK( contains(text, "solax_unit_battery_voltage_volts{unit=\"1\",serial_number=\"92932004102443\"} 52.5") );
+        CHECK( contains(text, "solax_unit_battery_voltage_volts{unit=\"2\",serial_number=\"9293\\\"2004\\\\1\"} 52.4") );
+        CHECK( contains(text, "solax_unit_info{unit=\"1\",serial_number=\"92932004102443\",work_mode=\"P\",inverter_status=\"00010110\"} 1") );
+        CHECK( contains(text, "solax_unit_info{unit=\"2\",serial_number=\"9293\\\"2004\\\\1\",work_mode=\"B\",inverter_status=\"\"} 1") );
+    }
+
+    SECTION("Every numeric unit field is one metric family with a sample per unit")
+    {
+        std::set<std::string> families;
+        std::set<std::string> typed;
+        std::istringstream lines{text};
+        for(std::string line; std::getline(lines, line);)
+        {
+            if(line.starts_with("# TYPE "))
+            {
+                auto const name{line.substr(7, line.find(' ', 7) - 7)};
+                CHECK( typed.insert(name).second );
+            }
+            else if(!line.starts_with("#"))
+            {
+                auto const name{line.substr(0, line.find_first_of("{ "))};
+                CHECK( typed.contains(name) );
+                if(name.starts_with("solax_unit_") && name != "solax_unit_info")
+                {
+                    families.insert(name);
+                }
+            }
+        }
+
+        size_t numNumericFields{0};
+        forEachField(unitTelemetryFields, [&](const auto& field)
+        {
+            using Value = typename std::remove_cvref_t<decltype(field)>::MemberType;
+            numNumericFields += std::is_arithmetic_v<Value> && !std::is_same_v<Value, char> ? 1 : 0;
+        });
+        CHECK( families.size() == numNumericFields );
+        CHECK( families.contains("solax_unit_pv2_input_current_amperes") );
+    }
+}
+
+SCENARIO( "Error counters are rendered by kind", "[solax::metrics]" )
+{
+    TelemetryErrorCounters counters;
+    counters.count({.kind = TelemetryErrorKind::CorruptedResponse});
+    counters.count({.kind = TelemetryErrorKind::CorruptedResponse});
+    counters.count({.kind = TelemetryErrorKind::NoResponse});
+
+    std::string text;
+    appendMetrics(text, counters);
+    CHECK( contains(text, "# TYPE solax_telemetry_errors_total counter") );
+    CHECK( contains(text, "solax_telemetry_errors_total{kind=\"no_response\"} 1") );
+    CHECK( contains(text, "solax_telemetry_errors_total{kind=\"corrupted_response\"} 2") );
+    CHECK( contains(text, "solax_telemetry_errors_total{kind=\"malformed_field\"} 0") );
+}
@@ -0,0 +1,122 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <charconv>
+#include <limits>
+#include <set>
+#include <string>
+#include <tuple>
+
+#include <solax/Telemetry.h>
+#include <solax/TelemetryJson.h>
+#include <solax/TelemetrySchema.h>
+
+using namespace solax;
+
+namespace
+{
+
+// Gives every field a distinct, exactly representable value so a swapped or skipped field is detected
+void assignSample(int32_t& value, size_t index) { value = static_cast<int32_t>(100 + index); }
+void assignSample(float& value, size_t index) { value = static_cast<float>(index) + 0.5f; }
+void assignSample(char& value, size_t) { value = 'B'; }
+void assignSample(std::string& value, size_t index) { value = "9200000000000" + std::to_string(index % 10); }
+
+std::string renderField(int32_t value) { return std::to_string(value); }
+std::string renderField(char value) { return std::string(1, value); }
+std::string renderField(const std::string& value) { return value; }
+std::string renderField(float value)
+{
+    char buffer[32];
+    auto const [end, ec]{std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::fixed, 1)};
+    return std::string(buffer, end);
+}
+
+UnitTelemetry sampleTelemetry()
+{
+    UnitTelemetry telemetry;
+    size_t index{0};
+    forEachField(unitTelemetryFields, [&](const auto& field) { assignSample(telemetry.*field.member, index++); });
+    return telemetry;
+}
+
+// Builds a QPGSn response (without the leading '(') from the schema, followed by a 2 byte CRC placeholder
+std::string renderResponse(const UnitTelemetry& telemetry)
+{
+    std::string response;
+    forEachField(unitTelemetryFields, [&](const auto& field)
+    {
+        if (!response.empty())
+        {
+            response += ' ';
+        }
+        response += renderField(telemetry.*field.member);
+    });
+    return response + "xx";
+}
+
+}
+
+SCENARIO( "Telemetry schema describes every field once", "[solax::telemetry]" )
+{
+    CHECK(std::tuple_size_v<decltype(unitTelemetryFields)> == 29);
+    CHECK(std::tuple_size_v<decltype(aggregatedTelemetryFields)> == 3);
+
+    std::set<std::string_view> names;
+    forEachField(unitTelemetryFields, [&](const auto& field)
+    {
+        CHECK(names.insert(field.name).second);
+        CHECK(field.jsonKey == "\"" + std::string(field.name) + "\":");
+    });
+}
+
+SCENARIO( "Parser is generated from the schema", "[solax::telemetry]" )
+{
+    const auto expected{sampleTelemetry()};
+    const auto parsed{parseRawTelemetry(renderResponse(expected)).value()};
+
+    forEachField(unitTelemetryFields, [&](const auto& field)
+    {
+        INFO("Field: " << field.name);
+        CHECK(parsed.*field.member == expected.*field.member);
+    });
+}
+
+SCENARIO( "JSON serializer is generated from the schema", "[solax::telemetry]" )
+{
+    SECTION("Aggregated telemetry")
+    {
+        const AggregatedTelemetry telemetry{1200.5f, -300.0f, 0.25f};
+        CHECK(toJson(telemetry) == R"({"solarPower_W":1200.5,"acPower_W":-300,"batteryPower_W":0.25})");
+    }
+
+    SECTION("Unit telemetry lists every field in schema order")
+    {
+        const auto json{toJson(sampleTelemetry())};
+        REQUIRE(json.front() == '{');
+        REQUIRE(json.back() == '}');
+
+        size_t position{0};
+        forEachField(unitTelemetryFields, [&](const auto& field)
+        {
+            INFO("Field: " << field.name);
+            auto const keyPosition{json.find(field.jsonKey, position)};
+            REQUIRE(keyPosition != std::string::npos);
+            position = keyPosition + field.jsonKey.size();
+        });
+
+        CHECK(json.find(R"("workMode":"B")") != std::string::npos);
+        CHECK(json.find(R"("gridVoltage_V":4.5)") != std::string::npos);
+        CHECK(json.find(R"("acOutputApparentPower_VA":108)") != std::string::npos);
+    }
+
+    SECTION("Strings are escaped and non-finite numbers become null")
+    {
+        UnitTelemetry telemetry;
+        telemetry.serialNumber = "12\"34\\";
+        telemetry.gridVoltage_V = std::numeric_limits<float>::quiet_NaN();
+
+        const auto json{toJson(telemetry)};
+        CHECK(json.find(R"("serialNumber":"12\"34\\")") != std::string::npos);
+        CHECK(json.find(R"("gridVoltage_V":null)") != std::string::npos);
+    }
+}
@@ -0,0 +1,228 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <solax/TelemetryJson.h>
+#include <solax/TelemetryMetrics.h>
+#include <solax/TelemetrySnapshot.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace solax;
+
+namespace
+{
+
+// Every value of the snapshot is derived from the cycle, so a reader can tell data of different cycles apart
+TelemetrySnapshot cycleSnapshot(uint64_t cycle)
+{
+    TelemetrySnapshot snapshot;
+    snapshot.aggregated.solarPower_W = static_cast<float>(cycle);
+    snapshot.units.resize(cycle % 9 + 1);
+    for(auto& unit : snapshot.units)
+    {
+        unit.serialNumber = std::to_string(cycle);
+    }
+    snapshot.energyTotals.solar_kWh = static_cast<double>(cycle);
+    snapshot.unitEnergyTotals.resize(snapshot.units.size());
+    return snapshot;
+}
+
+}
+
+SCENARIO( "Snapshots are published with increasing versions", "[solax::snapshot]" )
+{
+    SnapshotPublisher publisher;
+
+    SECTION("An empty snapshot is served before the first cycle")
+    {
+        auto const snapshot{publisher.latest()};
+        REQUIRE( snapshot != nullptr );
+        CHECK( snapshot->version == 0 );
+        CHECK( snapshot->units.empty() );
+    }
+
+    SECTION("Every published snapshot gets the next version")
+    {
+        auto const first{publisher.publish(cycleSnapshot(1))};
+        auto const second{publisher.publish(cycleSnapshot(2))};
+        CHECK( first->version == 1 );
+        CHECK( second->version == 2 );
+        CHECK( publisher.latest() == second );
+
+        // A reader keeps its snapshot unchanged while newer ones are published
+        CHECK( first->units.size() == 2 );
+        CHECK( first->aggregated.solarPower_W == 1.0f );
+    }
+
+    SECTION("The JSON of a snapshot is rendered when it is published")
+    {
+        auto const initial{publisher.latest()};
+        CHECK( initial->json.aggregated == toJson(AggregatedTelemetry{}) );
+        CHECK( initial->json.units.empty() );
+        CHECK( initial->json.all == "{\"version\":0,\"aggregated\":" + initial->json.aggregated + ",\"units\":[]}" );
+
+        auto const snapshot{publisher.publish(cycleSnapshot(3))};
+        CHECK( snapshot->json.aggregated == toJson(snapshot->aggregated) );
+        CHECK( snapshot->json.deviceStatus == toJson(snapshot->deviceStatus) );
+        CHECK( snapshot->json.energyTotals == toJson(snapshot->energyTotals) );
+        REQUIRE( snapshot->json.units.size() == 4 );
+        CHECK( snapshot->json.units[3] == toJson(snapshot->units[3]) );
+        REQUIRE( snapshot->json.unitEnergyTotals.size() == 4 );
+        CHECK( snapshot->json.unitEnergyTotals[0] == toJson(snapshot->unitEnergyTotals[0]) );
+        CHECK( snapshot->json.all.starts_with("{\"version\":1,\"aggregated\":" + snapshot->json.aggregated + ",\"units\":[" + snapshot->json.units[0] + ",") );
+        CHECK( snapshot->json.all.ends_with(snapshot->json.units[3] + "]}") );
+    }
+
+    SECTION("The metrics of a snapshot are rendered when it is published")
+    {
+        CHECK( publisher.latest()->metrics.find("solax_telemetry_cycles_total 0\n") != std::string::npos );
+
+        auto const snapshot{publisher.publish(cycleSnapshot(3))};
+        std::string metrics;
+        appendMetrics(metrics, *snapshot);
+        CHECK( snapshot->metrics == metrics );
+        CHECK( snapshot->metrics.find("solax_telemetry_cycles_total 1\n") != std::string::npos );
+    }
+}
+
+SCENARIO( "Snapshots are rendered with the selected fields only", "[solax::snapshot]" )
+{
+    SnapshotPublisher publisher;
+    auto const snapshot{publisher.publish(cycleSnapshot(1))};
+
+    SECTION("Fields are picked from the aggregate and the units by name")
+    {
+        std::string json;
+        appendJson(json, *snapshot, parseFieldSelection("solarPower_W, serialNumber,,batteryVoltage_V"));
+        CHECK( json == R"({"version":1,"aggregated":{"solarPower_W":1},"units":[)"
+                       R"({"serialNumber":"1","batteryVoltage_V":0},)"
+                       R"({"serialNumber":"1","batteryVoltage_V":0}]})" );
+    }
+
+    SECTION("Selecting every field renders the same JSON as the snapshot")
+    {
+        FieldSelection all;
+        all.aggregated.set();
+        all.units.set();
+        std::string json;
+        appendJson(json, *snapshot, all);
+        CHECK( json == snapshot->json.all );
+    }
+
+    SECTION("An empty selection keeps the structure")
+    {
+        std::string json;
+        appendJson(json, *snapshot, parseFieldSelection(""));
+        CHECK( json == R"({"version":1,"aggregated":{},"units":[{},{}]})" );
+    }
+
+    SECTION("Unknown names are rejected")
+    {
+        CHECK_THROWS_AS( parseFieldSelection("solarPower_W,noSuchField"), std::invalid_argument );
+        CHECK_THROWS_AS( parseFieldSelection("solarpower_w"), std::invalid_argument );
+    }
+}
+
+SCENARIO( "Waiting threads are woken up by a new snapshot", "[solax::snapshot]" )
+{
+    using namespace std::chrono_literals;
+    SnapshotPublisher publisher;
+    publisher.publish(cycleSnapshot(1));
+
+    SECTION("A newer snapshot is returned right away")
+    {
+        CHECK( publisher.waitForNewer(0, 10s)->version == 1 );
+    }
+
+    SECTION("The latest snapshot is returned after the timeout")
+    {
+        auto const start{std::chrono::steady_clock::now()};
+        CHECK( publisher.waitForNewer(1, 20ms)->version == 1 );
+        CHECK( std::chrono::steady_clock::now() - start >= 20ms );
+    }
+
+    SECTION("Publishing wakes up the waiting thread")
+    {
+        uint64_t version{0};
+        std::thread waiter{[&]() { version = publisher.waitForNewer(1, 10s)->version; }};
+        std::this_thread::sleep_for(10ms);
+        auto const start{std::chrono::steady_clock::now()};
+        publisher.publish(cycleSnapshot(2));
+        waiter.join();
+        CHECK( version == 2 );
+        CHECK( std::chrono::steady_clock::now() - start < 5s );
+    }
+
+    SECTION("Closing wakes up the waiting thread for good")
+    {
+        uint64_t version{0};
+        std::thread waiter{[&]() { version = publisher.waitForNewer(1, 10s)->version; }};
+        std::this_thread::sleep_for(10ms);
+        auto const start{std::chrono::steady_clock::now()};
+        publisher.close();
+        waiter.join();
+        CHECK( version == 1 );
+        CHECK( publisher.waitForNewer(1, 10s)->version == 1 );
+        CHECK( std::chrono::steady_clock::now() - start < 5s );
+    }
+}
+
+SCENARIO( "Readers see consistent snapshots while they are published", "[solax::snapshot]" )
+{
+    SnapshotPublisher publisher;
+    constexpr uint64_t NumCycles{20000};
+    std::atomic_bool done{false};
+    std::atomic_size_t numInconsistent{0};
+    std::atomic_size_t numOutOfOrder{0};
+
+    std::vector<std::thread> readers;
+    for(int i = 0; i < 4; ++i)
+    {
+        readers.emplace_back([&]()
+        {
+            uint64_t lastVersion{0};
+            while(!done)
+            {
+                auto const snapshot{publisher.latest()};
+                if(snapshot->version < lastVersion)
+                {
+                    numOutOfOrder++;
+                }
+                lastVersion = snapshot->version;
+                if(snapshot->version == 0)
+                {
+                    continue;
+                }
+
+                auto const cycle{static_cast<uint64_t>(snapshot->aggregated.solarPower_W)};
+                bool consistent{cycle == snapshot->version && snapshot->units.size() == cycle % 9 + 1
+                    && snapshot->unitEnergyTotals.size() == snapshot->units.size()
+                    && snapshot->energyTotals.solar_kWh == static_cast<double>(cycle)};
+                for(const auto& unit : snapshot->units)
+                {
+                    consistent = consistent && unit.serialNumber == std::to_string(cycle);
+                }
+                if(!consistent)
+                {
+                    numInconsistent++;
+                }
+            }
+        });
+    }
+
+    for(uint64_t cycle = 1; cycle <= NumCycles; ++cycle)
+    {
+        publisher.publish(cycleSnapshot(cycle));
+    }
+    done = true;
+    for(auto& reader : readers)
+    {
+        reader.join();
+    }
+
+    CHECK( publisher.latest()->version == NumCycles );
+    CHECK( numInconsistent == 0 );
+    CHECK( numOutOfOrder == 0 );
+}
@@ -0,0 +1,216 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include <solax/TimeSeriesStore.h>
+#include "TestHelpers.h"
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+#include <thread>
+
+using namespace solax;
+using namespace std::chrono_literals;
+using Catch::Matchers::WithinAbs;
+
+namespace
+{
+
+auto const start{test::HistoryStart};
+
+HistorySample sample(int i)
+{
+    return test::historySample(i);
+}
+
+std::vector<std::filesystem::path> segmentFiles(const std::filesystem::path& directory)
+{
+    std::vector<std::filesystem::path> paths;
+    for(const auto& entry : std::filesystem::directory_iterator{directory})
+    {
+        if(entry.path().extension() == ".seg")
+        {
+            paths.push_back(entry.path());
+        }
+    }
+    std::ranges::sort(paths);
+    return paths;
+}
+
+}
+
+SCENARIO( "Samples are stored on disk and read back by time range", "[solax::store]" )
+{
+    test::TemporaryDirectory directory{"solax_store"};
+    TimeSeriesStore::Config config{.path = directory.path.string(), .segmentSize = 4 * TimeSeriesStore::BlockSize,
+                                   .retention = std::chrono::hours{24 * 365}, .flushInterval = 3600s};
+    auto const all{[](const TimeSeriesStore& store, size_t maxSamples = 0) { return store.query(start - 1h, start + 24h, maxSamples); }};
+
+    SECTION("Samples survive a restart")
+    {
+        {
+            TimeSeriesStore store{config};
+            for(int i = 0; i < 1000; ++i)
+            {
+                store.add(sample(i));
+            }
+
+            // Not flushed yet are served as well
+            CHECK( all(store).size() == 1000 );
+        }
+
+        TimeSeriesStore store{config};
+        auto const samples{all(store)};
+        REQUIRE( samples.size() == 1000 );
+        CHECK( samples.front().time == start );
+        CHECK( samples.back().time == start + 999s );
+        CHECK( samples[123].aggregated.solarPower_W == 123.0f );
+        CHECK( samples[123].aggregated.batteryPower_W == -123.0f );
+        CHECK( samples[123].numUnits == 2 );
+        CHECK( samples[123].units[1].batteryPower_W == 1.5f );
+        CHECK( samples[123].units[2].acPower_W == 0.0f );
+
+        auto const range{store.query(start + 500s, start + 509s)};
+        REQUIRE( range.size() == 10 );
+        CHECK( range.front().time == start + 500s );
+        CHECK( range.back().time == start + 509s );
+        CHECK( store.query(start + 2000s, start + 3000s).empty() );
+
+        // Appending continues where the last run stopped
+        store.add(sample(1000));
+        store.add(sample(500));
+        CHECK( all(store).size() == 1001 );
+    }
+
+    SECTION("Full segments roll over and old ones are deleted")
+    {
+        config.segmentSize = TimeSeriesStore::BlockSize;
+        config.retention = 1h;
+        TimeSeriesStore store{config};
+        for(int i = 0; i < 24 * 3600; ++i)
+        {
+            store.add(sample(i));
+        }
+        store.flush();
+
+        // A block per segment, segments beyond the last hour are gone
+        CHECK( store.numSegments() == segmentFiles(directory.path).size() );
+        CHECK( store.numSegments() <= 3 );
+        auto const samples{all(store)};
+        REQUIRE( !samples.empty() );
+        CHECK( samples.front().time >= start + 22h );
+        CHECK( samples.back().time == start + std::chrono::seconds{24 * 3600 - 1} );
+        CHECK( samples.back().aggregated.solarPower_W == static_cast<float>(24 * 3600 - 1) );
+    }
+
+    SECTION("A torn block at the end is dropped")
+    {
+        constexpr int NumSamples{20000};
+        {
+            TimeSeriesStore store{config};
+            for(int i = 0; i < NumSamples; ++i)
+            {
+                store.add(sample(i));
+            }
+        }
+
+        // Damage the payload of the last, partially filled block
+        auto const path{segmentFiles(directory.path).back()};
+        {
+            std::fstream file{path, std::ios::in | std::ios::out | std::ios::binary};
+            std::streamoff lastBlock{4096};
+            for(std::streamoff offset = 4096; ; offset += TimeSeriesStore::BlockSize)
+            {
+                char magic[4]{};
+                file.seekg(offset);
+                if(!file.read(magic, sizeof(magic)) || std::string_view(magic, 4) != "SXBK")
+                {
+                    break;
+                }
+                lastBlock = offset;
+            }
+            file.clear();
+            file.seekp(lastBlock + 40);
+            file.put('\x7f');
+        }
+
+        TimeSeriesStore store{config};
+        auto samples{all(store)};
+        REQUIRE( !samples.empty() );
+        CHECK( samples.size() < NumSamples );
+        CHECK( samples.back().time < start + std::chrono::seconds{NumSamples - 1} );
+
+        // The torn block gets overwritten
+        auto const numKept{samples.size()};
+        for(int i = NumSamples; i < NumSamples + 10; ++i)
+        {
+            store.add(sample(i));
+        }
+        store.flush();
+        CHECK( all(store).size() == numKept + 10 );
+    }
+
+    SECTION("Long ranges are downsampled")
+    {
+        TimeSeriesStore store{config};
+        for(int i = 0; i < 1000; ++i)
+        {
+            store.add(sample(i));
+        }
+
+        auto const samples{all(store, 10)};
+        REQUIRE( samples.size() == 10 );
+        CHECK_THAT( samples.front().aggregated.solarPower_W, WithinAbs(49.5, 1e-3) );
+        CHECK_THAT( samples.front().units[0].solarPower_W, WithinAbs(24.75, 1e-3) );
+    }
+
+    SECTION("Queries see every sample while samples are added and flushed")
+    {
+        config.segmentSize = TimeSeriesStore::BlockSize;
+        config.flushInterval = 10s;
+        TimeSeriesStore store{config};
+        constexpr int NumSamples{50000};
+        std::atomic_int numAdded{0};
+        std::atomic_size_t numIncomplete{0};
+
+        // Sealed blocks, the partially filled block and the pending samples are read without blocking add()
+        std::thread reader{[&]()
+        {
+            while(numAdded < NumSamples)
+            {
+                auto const added{numAdded.load()};
+                auto const samples{all(store)};
+                bool complete{samples.size() >= static_cast<size_t>(added)};
+                for(size_t i = 0; complete && i < samples.size(); ++i)
+                {
+                    complete = samples[i].time == start + std::chrono::seconds{i};
+                }
+                if(!complete)
+                {
+                    numIncomplete++;
+                }
+            }
+        }};
+        for(int i = 0; i < NumSamples; ++i)
+        {
+            store.add(sample(i));
+            numAdded = i + 1;
+        }
+        reader.join();
+
+        CHECK( numIncomplete == 0 );
+        CHECK( all(store).size() == NumSamples );
+    }
+
+    SECTION("Unknown files are ignored")
+    {
+        std::filesystem::create_directories(directory.path);
+        std::ofstream{directory.path / "0000000000000000.seg"} << "garbage";
+
+        TimeSeriesStore store{config};
+        store.add(sample(0));
+        store.flush();
+        CHECK( all(store).size() == 1 );
+    }
+}